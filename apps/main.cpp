@@ -10,6 +10,7 @@
 //#define GLFW_EXPOSE_NATIVE_WGL
 #include <GLFW/glfw3.h>
 #include <ControlDeck/nes.h>
+#include <ControlDeck/FramePacer.h>
 #include "shaderLoader.h"
 
 #include "imgui/imgui.h"
@@ -18,6 +19,9 @@
 
 bool pause = true;
 NES::NesControlDeck controlDeck;
+NES::FrameStats lastFrame;
+NES::FramePacer pacer;
+const double fastForwardFactor = 4.0;
 
 const unsigned int width = 256;
 const unsigned int height = 240;
@@ -30,6 +34,12 @@ static const int vertexShaderBinding = 0;
 static const int uvShaderBinding = 1;
 
 uint8_t test[3 * sizeof(uint8_t) * width * height]{ 1};
+
+// Both pattern tables side by side for the debug window, 16x16 tiles each
+const unsigned int patternTableWidth = 256;
+const unsigned int patternTableHeight = 128;
+GLuint patternTableTextureId;
+uint8_t patternTablePixels[3 * patternTableWidth * patternTableHeight]{};
 static const GLfloat tri[] = {
     -1.0f, -1.0f, 0.0f,
     1.0f, -1.0f, 0.0f,
@@ -94,6 +104,42 @@ void setupRenderSurface() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 }
 
+void setupPatternTableTexture() {
+    glGenTextures(1, &patternTableTextureId);
+    glBindTexture(GL_TEXTURE_2D, patternTableTextureId);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, patternTableWidth, patternTableHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, patternTablePixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+}
+
+// Draw the pattern tables in background palette 0.  Tiles come decoded from the PPU's cache, so only the ones the
+// game has written or banked in since the last frame go back through the mapper.
+void updatePatternTableTexture(NES::Ppu2C02 &ppu) {
+    NES::SystemColorPalette &palette = ppu.ppuMemory.colorPalette;
+    const NES::Pixel colors[4] = {
+        NES::CpuVariant::palette()[palette.universalBackgroundColor],
+        NES::CpuVariant::palette()[palette.backgroundPalettes[0].colorIndex[0]],
+        NES::CpuVariant::palette()[palette.backgroundPalettes[0].colorIndex[1]],
+        NES::CpuVariant::palette()[palette.backgroundPalettes[0].colorIndex[2]],
+    };
+    for (int table = 0; table < 2; table++) {
+        for (int tile = 0; tile < 256; tile++) {
+            for (int row = 0; row < 8; row++) {
+                const uint8_t *indices = ppu.getDecodedTileRow(table, tile, row);
+                unsigned int y = (tile / 16) * 8 + row;
+                uint8_t *out = &patternTablePixels[3 * (y * patternTableWidth + table * 128 + (tile % 16) * 8)];
+                for (int x = 0; x < 8; x++) {
+                    out[3 * x] = colors[indices[x]].r;
+                    out[3 * x + 1] = colors[indices[x]].g;
+                    out[3 * x + 2] = colors[indices[x]].b;
+                }
+            }
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, patternTableTextureId);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, patternTableWidth, patternTableHeight, GL_RGB, GL_UNSIGNED_BYTE, patternTablePixels);
+}
+
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (GLFW_PRESS == action) {
         switch (key) {
@@ -102,7 +148,16 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
             break;
         case GLFW_KEY_SPACE:
             pause = !pause;
+            break;
+        case GLFW_KEY_TAB:
+            // held down
+            pacer.setMode(NES::PacingMode::FastForward, fastForwardFactor);
+            break;
+        case GLFW_KEY_U:
+            pacer.setMode(pacer.getMode() == NES::PacingMode::Uncapped ? NES::PacingMode::RealTime : NES::PacingMode::Uncapped);
         }
+    } else if (GLFW_RELEASE == action && GLFW_KEY_TAB == key && pacer.getMode() == NES::PacingMode::FastForward) {
+        pacer.setMode(NES::PacingMode::RealTime);
     }
 }
 
@@ -142,7 +197,10 @@ void showDebugState(NES::DebugState &debugState, NES::NesControlDeck &controlDec
         ImGui::SetNextItemWidth(50);
         ImGui::InputScalar("Y", ImGuiDataType_U8, &debugState.registersBefore.y, 0, 0, "$%02X"); // y index
         ImGui::SetNextItemWidth(50);
-        ImGui::InputScalar("P", ImGuiDataType_U8, &debugState.registersBefore.statusRegister, 0, 0, "$%02X"); // processor Status
+        uint8_t pBefore = debugState.registersBefore.statusRegister;
+        if (ImGui::InputScalar("P", ImGuiDataType_U8, &pBefore, 0, 0, "$%02X")) { // processor Status
+            debugState.registersBefore.statusRegister = pBefore;
+        }
         ImGui::SetNextItemWidth(50);    
         ImGui::InputScalar("SP", ImGuiDataType_U8, &debugState.registersBefore.stackPointer, 0, 0, "$%02X"); // Stack pointer
         ImGui::NextColumn();
@@ -166,7 +224,10 @@ void showDebugState(NES::DebugState &debugState, NES::NesControlDeck &controlDec
         ImGui::SetNextItemWidth(50);
         ImGui::InputScalar("Y", ImGuiDataType_U8, &debugState.registersAfter.y, 0, 0, "$%02X"); // y index
         ImGui::SetNextItemWidth(50);
-        ImGui::InputScalar("P", ImGuiDataType_U8, &debugState.registersAfter.statusRegister, 0, 0, "$%02X"); // processor Status
+        uint8_t pAfter = debugState.registersAfter.statusRegister;
+        if (ImGui::InputScalar("P", ImGuiDataType_U8, &pAfter, 0, 0, "$%02X")) { // processor Status
+            debugState.registersAfter.statusRegister = pAfter;
+        }
         ImGui::SetNextItemWidth(50);    
         ImGui::InputScalar("SP", ImGuiDataType_U8, &debugState.registersAfter.stackPointer, 0, 0, "$%02X"); // Stack pointer
         ImGui::NextColumn();
@@ -198,11 +259,11 @@ void showDebugState(NES::DebugState &debugState, NES::NesControlDeck &controlDec
             (p&0x01) != 0);
 
         if (debugState.opCodeArgs.numArgs == 2) {
-            ImGui::Text("%s %02X %02X", NES::instructionString[ins], debugState.opCodeArgs.args[1], debugState.opCodeArgs.args[0]);
+            ImGui::Text("%s %02X %02X", NES::instructionNames[ins], debugState.opCodeArgs.args[1], debugState.opCodeArgs.args[0]);
         } else if (debugState.opCodeArgs.numArgs == 1) {
-            ImGui::Text("%s %02X %02X", NES::instructionString[ins], debugState.opCodeArgs.args[1]);
+            ImGui::Text("%s %02X %02X", NES::instructionNames[ins], debugState.opCodeArgs.args[1]);
         } else {
-            ImGui::Text("%s", NES::instructionString[ins]);
+            ImGui::Text("%s", NES::instructionNames[ins]);
         }
         ImGui::Columns(1);
         ImGui::Separator();
@@ -212,7 +273,10 @@ void showDebugState(NES::DebugState &debugState, NES::NesControlDeck &controlDec
         }
         ImGui::SameLine();
         if (ImGui::Button("Run")) {
-            debugState = nesLoop(controlDeck, 320000);
+            // a second's worth of frames
+            for (int i = 0; i < 60; i++) {
+                lastFrame = runFrame(controlDeck);
+            }
         }
         ImGui::SameLine();
         if (ImGui::Button("Pause")) {
@@ -223,6 +287,15 @@ void showDebugState(NES::DebugState &debugState, NES::NesControlDeck &controlDec
         }
         ImGui::SameLine();
         ImGui::SetNextItemWidth(50);
+        const NES::IdleLoopStats &idleLoops = controlDeck.cpu.idleLoopStats;
+        ImGui::Text("Idle loops: %u found, %llu of %llu cycles skipped", idleLoops.loopsDetected,
+            (unsigned long long)idleLoops.cyclesSkipped, (unsigned long long)controlDeck.cpu.getCycle());
+        ImGui::Text("Frame %llu: %u cycles, %llu instructions%s", (unsigned long long)lastFrame.frame, lastFrame.cycles,
+            (unsigned long long)lastFrame.instructions, lastFrame.lag ? ", lag" : "");
+        const char *modes[] = { "real time", "fast-forward", "uncapped" };
+        ImGui::Text("Speed: %.1f%% (%s, %.4f Hz)", pacer.getSpeed(), modes[(int)pacer.getMode()],
+            NES::FramePacer::getFrameRate() * pacer.getFastForwardFactor());
+        ImGui::Image((void *)(intptr_t)patternTableTextureId, ImVec2(patternTableWidth * 2, patternTableHeight * 2));
         ImGui::End();
 }
 
@@ -273,7 +346,7 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
             return -1;
     }
 
-	glfwSwapInterval(1);	//vsync
+	glfwSwapInterval(0);	// paced by FramePacer, not vsync
     glEnable(GL_CULL_FACE);
     glfwSetKeyCallback(window, keyCallback);
     glfwSetErrorCallback(errorCallback);
@@ -285,6 +358,12 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 
     char *fname = "C:\\nes\\smb.nes";
     initNes(fname, controlDeck);
+    // idle loop skipping needs the block cache and only kicks in once the trace is turned off
+    controlDeck.cpu.blockCacheEnabled = true;
+    controlDeck.cpu.idleLoopSkipEnabled = true;
+    // the PPU catches up in batches, which draw whole scan lines at a time where nothing is written mid-line
+    controlDeck.cpu.ppuBatchingEnabled = true;
+    controlDeck.cpu.lazyPpuEnabled = true;
 
     unsigned int iterations = 0;
     setupRenderSurface();
@@ -305,6 +384,7 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
     ImGui::StyleColorsClassic();
     ImGui_ImplGlfw_InitForOpenGL(debugWindow, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
+    setupPatternTableTexture();
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
     bool showDemoWindow = true;
 
@@ -316,7 +396,7 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
         // temporary hack to play around with
 
         if(!pause) {
-            debugState = nesLoop(controlDeck, 200);
+            lastFrame = runFrame(controlDeck);
         }
 
 
@@ -338,6 +418,7 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 
 		// Render the pattern tables
 		glfwMakeContextCurrent(debugWindow);
+        updatePatternTableTexture(controlDeck.ppu);
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -357,10 +438,18 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
         glClear(GL_COLOR_BUFFER_BIT);
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 		glfwSwapBuffers(debugWindow);
+
+        if (!pause) {
+            pacer.pace();
+        }
     }
 
 
 
+    const NES::IdleLoopStats &idleLoops = controlDeck.cpu.idleLoopStats;
+    printf("%s: %u idle loops, %u fast-forwards, %llu of %llu cpu cycles skipped\n", fname, idleLoops.loopsDetected,
+        idleLoops.fastForwards, (unsigned long long)idleLoops.cyclesSkipped, (unsigned long long)controlDeck.cpu.getCycle());
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
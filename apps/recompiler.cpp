@@ -0,0 +1,51 @@
+#ifdef _MSC_VER
+// Disable warnings for fopen
+#pragma warning(disable:4996)
+#endif
+
+#include <cstdio>
+#include <ControlDeck/ines.h>
+#include <ControlDeck/CPU/StaticRecompiler.h>
+
+/**
+*   Offline recompiler for NROM games.  Walks the program from the reset, NMI and IRQ vectors and writes a C++ file
+*   to compile in alongside libControlDeck.  Assign the generated function to NesControlDeck::recompiled.code.
+*
+*   usage: ControlDeckRecompiler <rom.nes> <output.cpp> [function name]
+*/
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <rom.nes> <output.cpp> [function name]\n", argv[0]);
+        return 1;
+    }
+    const char *functionName = argc > 3 ? argv[3] : "recompiledProgram";
+
+    NES::Cartridge cart{};
+    NES::loadINesFile(argv[1], &cart);
+    if (dynamic_cast<NES::NRom *>(cart.mmc) == nullptr) {
+        fprintf(stderr, "%s: only NROM (mapper 0) games have fixed PRG banks\n", argv[1]);
+        return 1;
+    }
+
+    NES::Cpu2a03 cpu;
+    cpu.cartridge = &cart;
+
+    NES::ControlFlowGraph graph;
+    graph.build(cpu);
+
+    FILE *out = fopen(argv[2], "w");
+    if (out == nullptr) {
+        fprintf(stderr, "Unable to open %s\n", argv[2]);
+        return 1;
+    }
+    NES::writeRecompiledSource(graph, out, functionName, argv[1]);
+    fclose(out);
+
+    printf("%s: %u instructions in %u blocks from %u entry points\n", argv[2],
+        (unsigned)graph.instructions.size(), (unsigned)graph.blockStarts.size(), (unsigned)graph.entryPoints.size());
+    for (uint16_t address : graph.indirectJumps) {
+        printf("  indirect jump at $%04x runs on the interpreter if it leaves the recompiled code\n", address);
+    }
+    printf("declare with: uint32_t %s(NES::Cpu2a03 &cpu, uint32_t maxInstructions);\n", functionName);
+    return 0;
+}
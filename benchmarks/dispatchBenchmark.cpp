@@ -0,0 +1,135 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "../tests/CPU/FixedRomMmc.h"
+
+/**
+*   Compares instruction dispatch through the op code table (handleAddressingMode + OpCode::handler)
+*   against the compile time specialized handlers (Cpu2a03::fusedDispatchEnabled), with and without the block cache,
+*   with superinstructions (Cpu2a03::superInstructionsEnabled) and against Cpu2a03::runCycles running the same number
+*   of cpu cycles.
+*
+*   usage: ControlDeckDispatchBenchmark [instructions]
+*/
+
+using namespace NES;
+
+// Mix of loads, stores, read-modify-write, shifts, compares and branches run forever
+static const uint8_t benchmarkProgram[] = {
+    0xa2, 0x00,         // $8000 LDX #$00
+    0xa0, 0x10,         // $8002 LDY #$10
+    0x8a,               // $8004 TXA
+    0x49, 0x5a,         // $8005 EOR #$5a
+    0x9d, 0x00, 0x02,   // $8007 STA $0200,X
+    0x0a,               // $800a ASL A
+    0x2a,               // $800b ROL A
+    0x4a,               // $800c LSR A
+    0x29, 0x3f,         // $800d AND #$3f
+    0x09, 0x40,         // $800f ORA #$40
+    0x85, 0x10,         // $8011 STA $10
+    0xe6, 0x11,         // $8013 INC $11
+    0xa5, 0x11,         // $8015 LDA $11
+    0xc9, 0x50,         // $8017 CMP #$50
+    0x24, 0x10,         // $8019 BIT $10
+    0xbd, 0x00, 0x02,   // $801b LDA $0200,X
+    0x91, 0x20,         // $801e STA ($20),Y
+    0x48,               // $8020 PHA
+    0x68,               // $8021 PLA
+    0x88,               // $8022 DEY
+    0xe8,               // $8023 INX
+    0xd0, 0xde,         // $8024 BNE $8004
+    0x4c, 0x00, 0x80,   // $8026 JMP $8000
+};
+
+struct BenchmarkResult {
+    double nanoseconds{ 0 };
+    uint8_t acc{ 0 };
+    uint32_t cycles{ 0 };
+};
+
+enum BenchmarkMode {
+    TableDispatch,
+    FusedDispatch,
+    TableDispatchBlockCache,
+    FusedDispatchBlockCache,
+    SuperInstructions,
+    RunCycles,
+    NumBenchmarkModes
+};
+
+// instructions for the processInstruction modes, cpu cycles for RunCycles
+static BenchmarkResult run(Cartridge &cart, uint32_t count, BenchmarkMode mode) {
+    Ppu2C02 ppu;
+    ppu.disabled = true;
+    Cpu2a03 cpu;
+    setUpFixedRom(cpu, ppu, cart);
+    cpu.ram.ram[0x20] = 0x00;
+    cpu.ram.ram[0x21] = 0x03;
+    cpu.fusedDispatchEnabled = mode == FusedDispatch || mode == FusedDispatchBlockCache;
+    cpu.blockCacheEnabled = mode == TableDispatchBlockCache || mode == FusedDispatchBlockCache || mode == SuperInstructions;
+    cpu.superInstructionsEnabled = mode == SuperInstructions;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (mode == RunCycles) {
+        cpu.runCycles(count);
+    } else {
+        // superinstructions retire more than one instruction per call
+        uint32_t i = 0;
+        while (i < count) {
+            i += cpu.processInstruction().instructionCount;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    BenchmarkResult result;
+    result.nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    result.acc = cpu.registers.acc;
+    result.cycles = cpu.getCycle();
+    return result;
+}
+
+int main(int argc, char **argv) {
+    uint32_t instructions = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 20000000;
+
+    FixedRomMmc mmc;
+    memcpy(mmc.rom, benchmarkProgram, sizeof(benchmarkProgram));
+    Cartridge cart{};
+    cart.mmc = &mmc;
+
+    printf("%u instructions, %s\n", instructions, CpuVariant::name());
+    printf("%-28s %10s %10s %8s\n", "dispatch", "ns/instr", "MIPS", "speedup");
+
+    const char *names[] = { "op code table", "fused", "op code table + block cache", "fused + block cache", "superinstructions", "runCycles" };
+    double baseline = 0;
+    uint8_t expectedAcc = 0;
+    uint32_t expectedCycles = 0;
+    for (int i = 0; i < NumBenchmarkModes; i++) {
+        BenchmarkMode mode = (BenchmarkMode)i;
+        // runCycles is given the cycles the same number of instructions took
+        uint32_t count = mode == RunCycles ? expectedCycles : instructions;
+        // warm up, then take the best of a few runs
+        run(cart, count / 10, mode);
+        BenchmarkResult best = run(cart, count, mode);
+        for (int repeat = 0; repeat < 2; repeat++) {
+            BenchmarkResult result = run(cart, count, mode);
+            if (result.nanoseconds < best.nanoseconds) {
+                best = result;
+            }
+        }
+
+        if (i == 0) {
+            baseline = best.nanoseconds;
+            expectedAcc = best.acc;
+            expectedCycles = best.cycles;
+        } else if (best.acc != expectedAcc) {
+            printf("%s: final accumulator %02x doesn't match %02x\n", names[i], best.acc, expectedAcc);
+            return 1;
+        }
+        printf("%-28s %10.2f %10.1f %7.2fx\n", names[i], best.nanoseconds / instructions,
+            instructions / (best.nanoseconds / 1000.0), baseline / best.nanoseconds);
+    }
+    return 0;
+}
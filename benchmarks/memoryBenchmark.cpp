@@ -0,0 +1,132 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ControlDeck/CPU/cpu2A03.h>
+
+/**
+*   Compares the zero page and stack accessors (Cpu2a03::doZeroPageOperation) against the same bus cycles through
+*   doMemoryOperation's address decoding.
+*
+*   usage: ControlDeckMemoryBenchmark [accesses]
+*/
+
+using namespace NES;
+
+typedef uint32_t(*AccessLoopFnPtr)(Cpu2a03 &cpu, uint32_t count);
+
+static uint32_t zeroPageReadGeneric(Cpu2a03 &cpu, uint32_t count) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += cpu.readFromAddress((uint16_t)(i & 0xff));
+    }
+    return sum;
+}
+
+static uint32_t zeroPageReadFast(Cpu2a03 &cpu, uint32_t count) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += cpu.readFromZeroPage((uint16_t)(i & 0xff));
+    }
+    return sum;
+}
+
+static uint32_t zeroPageWriteGeneric(Cpu2a03 &cpu, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        cpu.systemBus.addressBus = (uint16_t)(i & 0xff);
+        cpu.systemBus.dataBus = (uint8_t)i;
+        cpu.systemBus.read = false;
+        cpu.doMemoryOperation();
+    }
+    return cpu.ram.ram[0x7f];
+}
+
+static uint32_t zeroPageWriteFast(Cpu2a03 &cpu, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        cpu.systemBus.addressBus = (uint16_t)(i & 0xff);
+        cpu.systemBus.dataBus = (uint8_t)i;
+        cpu.systemBus.read = false;
+        cpu.doZeroPageOperation();
+    }
+    return cpu.ram.ram[0x7f];
+}
+
+// push then pop, count / 2 times
+static uint32_t stackGeneric(Cpu2a03 &cpu, uint32_t count) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; i += 2) {
+        cpu.systemBus.dataBus = (uint8_t)i;
+        cpu.pushStackSetup();
+        cpu.doMemoryOperation();
+        cpu.popStackSetup();
+        cpu.doMemoryOperation();
+        sum += cpu.systemBus.dataBus;
+    }
+    return sum;
+}
+
+static uint32_t stackFast(Cpu2a03 &cpu, uint32_t count) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; i += 2) {
+        cpu.systemBus.dataBus = (uint8_t)i;
+        cpu.pushDataBusToStack();
+        cpu.popStackToDataBus();
+        sum += cpu.systemBus.dataBus;
+    }
+    return sum;
+}
+
+struct AccessBenchmark {
+    const char *name;
+    AccessLoopFnPtr generic;
+    AccessLoopFnPtr fast;
+};
+
+static double run(AccessLoopFnPtr loop, uint32_t count, uint32_t &result) {
+    Ppu2C02 ppu;
+    ppu.disabled = true;
+    Cpu2a03 cpu;
+    cpu.ppu = &ppu;
+    cpu.registers.stackPointer = 0xfd;
+    for (size_t i = 0; i < SystemRam::systemRAMBytes; i++) {
+        cpu.ram.ram[i] = (uint8_t)(i * 7);
+    }
+
+    // warm up, then take the best of a few runs
+    loop(cpu, count / 10);
+    double best = 0;
+    for (int repeat = 0; repeat < 3; repeat++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        result = loop(cpu, count);
+        auto end = std::chrono::high_resolution_clock::now();
+        double nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        if (repeat == 0 || nanoseconds < best) {
+            best = nanoseconds;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    uint32_t accesses = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 50000000;
+
+    const AccessBenchmark benchmarks[] = {
+        { "zero page read", &zeroPageReadGeneric, &zeroPageReadFast },
+        { "zero page write", &zeroPageWriteGeneric, &zeroPageWriteFast },
+        { "stack push + pop", &stackGeneric, &stackFast },
+    };
+
+    printf("%u bus accesses\n", accesses);
+    printf("%-20s %14s %14s %8s\n", "access", "generic ns", "zero page ns", "speedup");
+    for (const AccessBenchmark &benchmark : benchmarks) {
+        uint32_t genericResult = 0;
+        uint32_t fastResult = 0;
+        double generic = run(benchmark.generic, accesses, genericResult);
+        double fast = run(benchmark.fast, accesses, fastResult);
+        if (genericResult != fastResult) {
+            printf("%s: result %u doesn't match %u\n", benchmark.name, fastResult, genericResult);
+            return 1;
+        }
+        printf("%-20s %14.2f %14.2f %7.2fx\n", benchmark.name, generic / accesses, fast / accesses, generic / fast);
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "../tests/CPU/FixedRomMmc.h"
+
+/**
+*   Compares running the PPU inline with every bus cycle (three doPpuCycle calls per synchronizeProcessors) against
+*   Cpu2a03::ppuBatchingEnabled, where the PPU catches up in batches at instruction boundaries and PPU accesses, and
+*   against Cpu2a03::lazyPpuEnabled on top of that, where it only catches up at PPU accesses and the NMI deadline.
+*   All run the same frames with rendering and the vblank NMI on, and the final CPU and PPU state has to match.
+*
+*   usage: ControlDeckPpuSyncBenchmark [frames]
+*/
+
+using namespace NES;
+
+// Rendering and NMI on, then busy work in RAM while polling the status register
+static const uint8_t frameProgram[] = {
+    0xa9, 0x1e,         // $8000 LDA #$1e
+    0x8d, 0x01, 0x20,   // $8002 STA $2001
+    0xa9, 0x80,         // $8005 LDA #$80
+    0x8d, 0x00, 0x20,   // $8007 STA $2000
+    0xa2, 0x00,         // $800a LDX #$00
+    0xb5, 0x30,         // $800c LDA $30,X
+    0x69, 0x03,         // $800e ADC #$03
+    0x95, 0x30,         // $8010 STA $30,X
+    0xe8,               // $8012 INX
+    0xe0, 0x40,         // $8013 CPX #$40
+    0xd0, 0xf5,         // $8015 BNE $800c
+    0x2c, 0x02, 0x20,   // $8017 BIT $2002
+    0x4c, 0x0a, 0x80,   // $801a JMP $800a
+};
+
+// NMI handler at $8040
+static const uint8_t nmiHandler[] = {
+    0xe6, 0x11,         // $8040 INC $11
+    0x40,               // $8042 RTI
+};
+
+const uint32_t cpuCyclesPerFrame = 29781;
+
+struct BenchmarkResult {
+    double nanoseconds{ 0 };
+    uint32_t cycles{ 0 };
+    uint32_t ppuCycles{ 0 };
+    uint8_t nmis{ 0 };
+    uint8_t acc{ 0 };
+    uint16_t programCounter{ 0 };
+};
+
+static BenchmarkResult run(Cartridge &cart, uint32_t frames, bool batched, bool lazy, bool runCycles) {
+    Ppu2C02 ppu;
+    Cpu2a03 cpu;
+    setUpFixedRom(cpu, ppu, cart);
+    cpu.ppuBatchingEnabled = batched;
+    cpu.lazyPpuEnabled = lazy;
+
+    uint32_t budget = frames * cpuCyclesPerFrame;
+    auto start = std::chrono::high_resolution_clock::now();
+    if (runCycles) {
+        cpu.runCycles(budget);
+    } else {
+        while (cpu.getCycle() < budget) {
+            cpu.processInstruction();
+        }
+    }
+    cpu.catchUpPpu();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    BenchmarkResult result;
+    result.nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    result.cycles = cpu.getCycle();
+    result.ppuCycles = ppu.getCycle();
+    result.nmis = cpu.ram.ram[0x11];
+    result.acc = cpu.registers.acc;
+    result.programCounter = cpu.registers.programCounter;
+    return result;
+}
+
+static BenchmarkResult best(Cartridge &cart, uint32_t frames, bool batched, bool lazy, bool runCycles) {
+    // warm up, then take the best of a few runs
+    run(cart, 1, batched, lazy, runCycles);
+    BenchmarkResult best = run(cart, frames, batched, lazy, runCycles);
+    for (int repeat = 0; repeat < 2; repeat++) {
+        BenchmarkResult result = run(cart, frames, batched, lazy, runCycles);
+        if (result.nanoseconds < best.nanoseconds) {
+            best = result;
+        }
+    }
+    return best;
+}
+
+static bool sameState(const BenchmarkResult &a, const BenchmarkResult &b) {
+    return a.cycles == b.cycles && a.ppuCycles == b.ppuCycles && a.nmis == b.nmis && a.acc == b.acc &&
+        a.programCounter == b.programCounter;
+}
+
+int main(int argc, char **argv) {
+    uint32_t frames = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 300;
+
+    FixedRomMmc mmc;
+    memcpy(mmc.rom, frameProgram, sizeof(frameProgram));
+    memcpy(&mmc.rom[0x40], nmiHandler, sizeof(nmiHandler));
+    mmc.setVector(0xfffa, 0x8040);
+    Cartridge cart{};
+    cart.mmc = &mmc;
+
+    printf("%u frames, %s\n", frames, CpuVariant::name());
+    printf("%-18s %12s %12s %8s %12s %8s %6s\n", "loop", "inline ms", "batched ms", "speedup", "lazy ms", "speedup", "match");
+    const char *names[] = { "processInstruction", "runCycles" };
+    bool allMatch = true;
+    for (int i = 0; i < 2; i++) {
+        BenchmarkResult inlinePpu = best(cart, frames, false, false, i == 1);
+        BenchmarkResult batched = best(cart, frames, true, false, i == 1);
+        BenchmarkResult lazy = best(cart, frames, true, true, i == 1);
+        bool match = sameState(inlinePpu, batched) && sameState(inlinePpu, lazy);
+        allMatch = allMatch && match;
+        printf("%-18s %12.2f %12.2f %7.2fx %12.2f %7.2fx %6s\n", names[i], inlinePpu.nanoseconds / 1000000.0,
+            batched.nanoseconds / 1000000.0, inlinePpu.nanoseconds / batched.nanoseconds, lazy.nanoseconds / 1000000.0,
+            inlinePpu.nanoseconds / lazy.nanoseconds, match ? "yes" : "NO");
+    }
+    return allMatch ? 0 : 1;
+}
@@ -2,7 +2,7 @@
 #include <cstdint>
 
 namespace NES {
-    enum AddressingMode {
+    enum AddressingMode : uint8_t {
         Undefined = 0,
         Implicit,
         Accumulator,
@@ -0,0 +1,118 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "AddressingMode.h"
+
+namespace NES {
+    class Cpu2a03;
+    struct OpCode;
+    struct OpCodeArgs;
+
+    // Addressing mode step resolved at decode time so execution skips the handleAddressingMode switch.
+    typedef void (Cpu2a03::*AddressingStepFnPtr)(OpCodeArgs &args);
+
+    struct DecodedInstruction;
+    /**
+    *   Runs a recognized sequence of decoded instructions as one operation (see Cpu2a03::findSuperInstructions).
+    *   Sets instructionCount to the number of instructions retired and returns the cycles taken.
+    */
+    typedef uint8_t(*SuperInstructionFnPtr)(Cpu2a03 &cpu, const DecodedInstruction *sequence, uint8_t &instructionCount);
+
+    /**
+    *   Single instruction decoded out of PRG-ROM (or RAM) with its operand bytes already fetched.
+    *   Operands are still "read" during execution to charge the PPU for the bus cycles, but the memory mapper is skipped.
+    */
+    struct DecodedInstruction {
+        const OpCode *opCode{ nullptr };
+        AddressingStepFnPtr addressingStep{ nullptr };
+        uint16_t address{ 0 };      // address of the op code
+        uint8_t operands[2]{};
+        // Set on the first instruction of a sequence which can run as one operation
+        SuperInstructionFnPtr superInstruction{ nullptr };
+        // Set on the first instruction of a block which loops back to itself without side effects (see
+        // Cpu2a03::findIdleLoop).  Number of instructions in the loop.
+        uint8_t idleLoopLength{ 0 };
+    };
+
+    /**
+    *   Straight-line run of decoded instructions ending at the first instruction that can change the program counter
+    *   (branch, jump, return, interrupt).
+    */
+    struct CachedBlock {
+        static const size_t maxInstructions = 16;
+
+        bool valid{ false };
+        uint16_t startAddress{ 0 };
+        uint16_t endAddress{ 0 };   // one past the last byte of the last instruction
+        uint32_t bankState{ 0 };    // mapper PRG bank state at decode time
+        uint8_t numInstructions{ 0 };
+        DecodedInstruction instructions[maxInstructions];
+    };
+
+    /**
+    *   Direct mapped cache of decoded blocks keyed by start address and mapper bank state.
+    *
+    *   Entries are dropped when the mapper bank state changes or when a write lands on a page of system RAM which
+    *   holds decoded code.  Only system RAM ($0000-$1fff) and PRG-ROM ($8000-$ffff) are cached since reads from
+    *   the other regions can have side effects.
+    */
+    class BlockCache {
+    public:
+        static const size_t numEntries = 1024;
+        static const size_t ramPageSize = 256;
+        static const size_t numRamPages = 2048 / ramPageSize;
+
+        static bool isCacheableAddress(uint16_t address) {
+            return address < 0x2000 || address >= 0x8000;
+        }
+
+        /**
+        *   Decoded instruction at address.  Continues through the block currently being executed when the program
+        *   counter is still inside it, otherwise looks up a block starting at address.
+        *   Returns nullptr on a miss.  The caller is expected to decode a new block with allocate()/commit().
+        */
+        const DecodedInstruction *next(uint16_t address, uint32_t bankState);
+
+        // Entry to decode a new block into.  The previous occupant (if any) is dropped.
+        CachedBlock *allocate(uint16_t address, uint32_t bankState);
+        // Mark a decoded block as ready for use
+        void commit(CachedBlock *block);
+
+        // Drop every block decoded from the page of system RAM containing ramAddress ($0000-$07ff)
+        void invalidateRamPage(size_t ramAddress);
+        inline bool isRamCodePage(size_t ramAddress) const {
+            return ramCodePages[ramAddress / ramPageSize];
+        }
+        // Per page flags for generated code which writes RAM without going through the memory mapper
+        const bool *getRamCodePages() const {
+            return ramCodePages;
+        }
+
+        // Move the execution cursor past instructions run together with the one last returned by next()
+        void skip(uint8_t count) {
+            activeInstruction += count;
+        }
+
+        // Drop everything, used on mapper bank switches.
+        void flush();
+
+        // stats
+        uint32_t hits{ 0 };
+        uint32_t misses{ 0 };
+        uint32_t invalidations{ 0 };
+        uint32_t superInstructions{ 0 };
+    private:
+        static size_t entryIndex(uint16_t address) {
+            return (address ^ (address >> 10)) & (numEntries - 1);
+        }
+
+        // allocated on first use so CPUs which never enable the cache stay small
+        std::vector<CachedBlock> entries;
+        bool ramCodePages[numRamPages]{};
+
+        // Execution cursor (stored as indices so copies of the cache stay self-contained)
+        int activeEntry{ -1 };
+        uint8_t activeInstruction{ 0 };
+    };
+}
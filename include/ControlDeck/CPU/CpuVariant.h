@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include "../PPU/ColorPalette.h"
+
+namespace NES {
+    /**
+    *   Compile time description of the CPU, and the region timing that goes with it, the core is built for.  Cpu2a03
+    *   and Ppu2C02 read everything which differs between variants from CpuVariant, so features a variant doesn't have
+    *   are constant false and compile out and there are no runtime checks on the region.
+    *
+    *   decimalMode:    ADC/SBC honour the D flag (BCD arithmetic).  The 2A03/2A07 have the flag but not the adder.
+    *   ppuClocks/cpuClocks:    PPU cycles run per CPU cycle as a fraction.  3/1 on NTSC, 16/5 (3.2) on PAL.
+    *   masterClocksPerCpuCycle/masterClocksPerPpuCycle:    both dividers off the master crystal (21.48MHz NTSC,
+    *       26.6MHz PAL and Dendy), the time base Scheduler deadlines are in.
+    *   scanLines/vblankScanLine:   PPU frame length and the first vertical blank scan line, counted from the
+    *       pre-render line as 0 like Ppu2C02 does.  262/242 on NTSC, 312/242 on PAL (70 vblank lines), 312/292 on
+    *       Dendy (50 more post-render lines, then NTSC's 20 vblank lines).
+    *   palette:    RGB for the 64 PPU colour indices.
+    *
+    *   Selected with the CONTROLDECK_CPU_VARIANT cmake option, which defines one of CONTROLDECK_CPU_VARIANT_2A03,
+    *   CONTROLDECK_CPU_VARIANT_2A07, CONTROLDECK_CPU_VARIANT_UA6538 or CONTROLDECK_CPU_VARIANT_6502.
+    */
+    struct Ricoh2A03 {
+        static const bool decimalMode = false;
+        static const uint32_t ppuClocks = 3;
+        static const uint32_t cpuClocks = 1;
+        static const uint32_t masterClocksPerCpuCycle = 12;
+        static const uint32_t masterClocksPerPpuCycle = 4;
+        static const uint32_t clockHz = 1789773;
+        static const uint16_t scanLines = 262;
+        static const uint16_t vblankScanLine = 242;
+        static const Pixel *palette() { return colorPaletteNtsc; }
+        static const char *name() { return "2A03 (NTSC)"; }
+    };
+
+    struct Ricoh2A07 {
+        static const bool decimalMode = false;
+        static const uint32_t ppuClocks = 16;
+        static const uint32_t cpuClocks = 5;
+        static const uint32_t masterClocksPerCpuCycle = 16;
+        static const uint32_t masterClocksPerPpuCycle = 5;
+        static const uint32_t clockHz = 1662607;
+        static const uint16_t scanLines = 312;
+        static const uint16_t vblankScanLine = 242;
+        static const Pixel *palette() { return colorPalettePal; }
+        static const char *name() { return "2A07 (PAL)"; }
+    };
+
+    // Dendy famiclone: the PAL crystal and frame length, but 3 PPU cycles per CPU cycle and vblank as long as NTSC's
+    struct Ua6538 {
+        static const bool decimalMode = false;
+        static const uint32_t ppuClocks = 3;
+        static const uint32_t cpuClocks = 1;
+        static const uint32_t masterClocksPerCpuCycle = 15;
+        static const uint32_t masterClocksPerPpuCycle = 5;
+        static const uint32_t clockHz = 1773448;
+        static const uint16_t scanLines = 312;
+        static const uint16_t vblankScanLine = 292;
+        static const Pixel *palette() { return colorPalettePal; }
+        static const char *name() { return "UA6538 (Dendy)"; }
+    };
+
+    // Generic NMOS 6502 with decimal mode, clocked like the NTSC 2A03 so it runs against the same bus and PPU
+    struct Nmos6502 {
+        static const bool decimalMode = true;
+        static const uint32_t ppuClocks = 3;
+        static const uint32_t cpuClocks = 1;
+        static const uint32_t masterClocksPerCpuCycle = 12;
+        static const uint32_t masterClocksPerPpuCycle = 4;
+        static const uint32_t clockHz = 1789773;
+        static const uint16_t scanLines = 262;
+        static const uint16_t vblankScanLine = 242;
+        static const Pixel *palette() { return colorPaletteNtsc; }
+        static const char *name() { return "NMOS 6502"; }
+    };
+
+#if defined(CONTROLDECK_CPU_VARIANT_6502)
+    typedef Nmos6502 CpuVariant;
+#elif defined(CONTROLDECK_CPU_VARIANT_2A07)
+    typedef Ricoh2A07 CpuVariant;
+#elif defined(CONTROLDECK_CPU_VARIANT_UA6538)
+    typedef Ua6538 CpuVariant;
+#else
+    typedef Ricoh2A03 CpuVariant;
+#endif
+
+    static_assert(CpuVariant::masterClocksPerCpuCycle * CpuVariant::cpuClocks == CpuVariant::masterClocksPerPpuCycle * CpuVariant::ppuClocks,
+        "master clock dividers don't match ppuClocks/cpuClocks");
+    static_assert(CpuVariant::vblankScanLine > 241 && CpuVariant::vblankScanLine < CpuVariant::scanLines,
+        "vertical blank has to start after the post-render scan line and end before the pre-render one");
+
+    // PPU cycles covering cpuCycles bus cycles, rounded up
+    inline uint32_t ppuCyclesForCpuCycles(uint32_t cpuCycles) {
+        return (cpuCycles * CpuVariant::ppuClocks + CpuVariant::cpuClocks - 1) / CpuVariant::cpuClocks;
+    }
+
+    // CPU bus cycles running ppuCycles PPU cycles, rounded up.  Can be a cycle short with PAL's clock phase.
+    inline uint32_t cpuCyclesForPpuCycles(uint32_t ppuCycles) {
+        return (ppuCycles * CpuVariant::cpuClocks + CpuVariant::ppuClocks - 1) / CpuVariant::ppuClocks;
+    }
+}
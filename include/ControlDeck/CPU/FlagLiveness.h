@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace NES {
+    class Cpu2a03;
+
+    /**
+    *   Which of N, Z, C and V each instruction in PRG-ROM has to produce, found by walking the program from the
+    *   interrupt vectors (see ControlFlowGraph) and working back from the instructions which read flags (branches,
+    *   ADC/SBC/ROL/ROR, PHP/BRK pushing P).  A flag is dead after an instruction when every path from it overwrites
+    *   the flag before reading it.
+    *
+    *   Conservative wherever the program can't be followed: RTS, RTI, BRK, unresolved indirect jumps and jumps out of
+    *   the walked code make every flag live, and flags read by the NMI and IRQ handlers are live everywhere since an
+    *   interrupt can be taken between any two instructions.  Handlers which dig the pushed P out of the stack without
+    *   PLP/RTI aren't accounted for.
+    *
+    *   One bitmap per PRG bank layout (MemoryManagementController::prgBankState), analysed the first time the layout
+    *   is seen; past maxBankStates the least recently used layout is dropped.  Addresses outside PRG-ROM (code in RAM)
+    *   always report every flag live.
+    */
+    class FlagLiveness {
+    public:
+        static const uint8_t allFlags = 0xff;
+        static const size_t prgRomSize = 0x8000;
+        // bank layouts kept before the least recently used one is dropped
+        static const size_t maxBankStates = 16;
+
+        FlagLiveness() = default;
+        // Copies look the bitmap for their bank layout up again rather than pointing into the original's map
+        FlagLiveness(const FlagLiveness &other);
+        FlagLiveness &operator=(const FlagLiveness &other);
+
+        // Flags (ProcessorStatus bits) the instruction at address has to produce
+        uint8_t getLiveFlags(Cpu2a03 &cpu, uint16_t address);
+
+        /**
+        *   Analyse the PRG-ROM mapped in right now.  liveFlags is indexed by address - $8000 and holds the flags live
+        *   after the instruction starting there, allFlags for addresses which weren't reached.
+        */
+        static void analyse(Cpu2a03 &cpu, std::vector<uint8_t> &liveFlags);
+
+        // Drop every bitmap
+        void flush();
+
+        // stats
+        uint32_t analyses{ 0 };
+    private:
+        struct BankLiveFlags {
+            std::vector<uint8_t> liveFlags;
+            // lookups when this layout was last switched to
+            uint64_t lastUsed{ 0 };
+        };
+        std::map<uint32_t, BankLiveFlags> bankLiveFlags;
+        // Bitmap for the bank layout in use, owned by bankLiveFlags
+        const std::vector<uint8_t> *current{ nullptr };
+        uint32_t currentBankState{ 0 };
+        uint64_t bankSwitches{ 0 };
+    };
+}
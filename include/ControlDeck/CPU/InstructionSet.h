@@ -1,9 +1,10 @@
 #pragma once
+#include <cstdint>
 
 namespace NES {
     // Sourced from http://e-tradition.net/bytes/6502/6502_instruction_set.html and
     // http://web.archive.org/web/20020820122913/http://www.obelisk.demon.co.uk/6502/reference.html#EOR
-    enum Instruction {
+    enum Instruction : uint8_t {
         // Load store a single byte between memory and registers
         LDA,    // Load accumulator        N,Z
         LDX,    // Load x register        N,Z
@@ -85,86 +86,6 @@ namespace NES {
         UNK,    // Unknown (not a real instruction)
     };
 
-    static const char* instructionString[] = {
-       "LDA",    
-       "LDX",    
-       "LDY",    
-       "STA",    
-       "STX",    
-       "STY",    
-
-                
-       "TAX",    
-       "TAY",    
-       "TXA",    
-       "TYA",    
-
-                
-       "TSX",    
-       "TXS",    
-       "PHA",    
-       "PHP",    
-       "PLA",    
-       "PLP",    
-
-                
-       "AND",
-       "EOR",    
-       "ORA",    
-       "BIT",    
-
-                
-       "ADC",    
-       "SBC",    
-       "CMP",    
-       "CPX",    
-       "CPY",    
-
-                
-       "INC",    
-       "INX",    
-       "INY",    
-       "DEC",    
-       "DEX",    
-       "DEY",    
-
-                
-       "ASL",    
-       "LSR",    
-       "ROL",    
-       "ROR",    
-
-                
-       "JMP",
-       "JSR",    
-       "RTS",    
-
-                
-       "BCC",    
-       "BCS",    
-       "BEQ",    
-       "BMI",    
-       "BNE",    
-       "BPL",    
-       "BVC",    
-       "BVS",    
-
-                
-       "CLC",    
-       "CLD",    
-       "CLI",    
-       "CLV",    
-       "SEC",    
-       "SED",    
-       "SEI",    
-
-                
-       "BRK",    
-       "NOP",
-       "RTI",    
-
-       "UNK"
-    };
-
+    // for debug printing, indexed by Instruction
     extern const char* instructionNames[];
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+#include "SystemComponents.h"
+
+namespace NES {
+    // Devices which can hold the shared IRQ line low.  Each is a bit in InterruptController::getIrqSources.
+    enum IrqSource : uint8_t {
+        IRQ_APU_FRAME_COUNTER = 1 << 0,
+        IRQ_DMC = 1 << 1,
+        IRQ_MAPPER = 1 << 2,
+        IRQ_EXTERNAL = 1 << 3,  // setIrq/clearIrq without a device (tests, debugging)
+    };
+
+    /**
+    *   Interrupt lines into the CPU.
+    *
+    *   NMI is edge triggered: the PPU drives the line (vblank && PPUCTRL bit 7) and a low to high transition latches
+    *   an NMI which stays pending until the CPU takes it, whatever the line does in between.
+    *
+    *   IRQ is level triggered and wired-or: any number of sources (APU frame counter, DMC, mapper) can assert it and
+    *   it stays pending until every one of them has released it.  Taking the IRQ doesn't acknowledge it, the device
+    *   has to be told by the handler (e.g. reading $4015, writing a mapper register).  Masked by the I flag.
+    *
+    *   Devices only touch the controller when a line changes, and everything pending is one bit in a byte, so the CPU
+    *   checks for work with isPending between instructions and nothing else.
+    *   See: http://wiki.nesdev.com/w/index.php/CPU_interrupts
+    */
+    class InterruptController {
+    public:
+        void setNmiLine(bool active) {
+            if (active && !nmiLine) {
+                pending |= PENDING_NMI;
+            }
+            nmiLine = active;
+        }
+
+        // Latch an NMI without a line, same as an edge
+        void raiseNmi() {
+            pending |= PENDING_NMI;
+        }
+
+        void assertIrq(IrqSource source) {
+            irqSources |= source;
+            pending |= PENDING_IRQ;
+        }
+
+        void releaseIrq(IrqSource source) {
+            irqSources &= ~source;
+            if (irqSources == 0) {
+                pending &= ~PENDING_IRQ;
+            }
+        }
+
+        void raiseReset() {
+            pending |= PENDING_RESET;
+        }
+
+        bool isPending() const {
+            return pending != 0;
+        }
+
+        bool isNmiPending() const {
+            return (pending & PENDING_NMI) != 0;
+        }
+
+        uint8_t getIrqSources() const {
+            return irqSources;
+        }
+
+        /**
+        *   Interrupt the CPU takes at this instruction boundary, INT_NONE if there isn't one (nothing pending or only
+        *   a masked IRQ).  Reset, then NMI, then IRQ.  Reset and NMI are cleared by being taken.
+        */
+        InterruptType acknowledge(bool interruptDisable) {
+            if (pending & PENDING_RESET) {
+                pending &= ~PENDING_RESET;
+                return InterruptType::INT_RESET;
+            }
+            if (pending & PENDING_NMI) {
+                pending &= ~PENDING_NMI;
+                return InterruptType::INT_NMI;
+            }
+            if ((pending & PENDING_IRQ) && !interruptDisable) {
+                return InterruptType::INT_IRQ;
+            }
+            return InterruptType::INT_NONE;
+        }
+
+    private:
+        enum : uint8_t {
+            PENDING_IRQ = 1 << 0,
+            PENDING_NMI = 1 << 1,
+            PENDING_RESET = 1 << 2,
+        };
+
+        uint8_t pending{ 0 };
+        uint8_t irqSources{ 0 };
+        bool nmiLine{ false };
+    };
+}
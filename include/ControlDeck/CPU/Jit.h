@@ -0,0 +1,170 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "cpu2A03.h"
+
+namespace NES {
+    /**
+    *   State shared between the recompiled code and the rest of the emulator.  Offsets into this struct are baked into
+    *   the generated code so the layout is fixed (plain uint32_t fields only up to ram).
+    *
+    *   A, X, Y and P are copied in at block entry and kept in host registers while the block runs.
+    */
+    struct JitContext {
+        uint32_t a{ 0 };
+        uint32_t x{ 0 };
+        uint32_t y{ 0 };
+        uint32_t p{ 0 };
+        uint32_t sp{ 0 };
+        uint32_t pc{ 0 };                   // set by the block on exit
+
+        uint32_t pendingBusCycles{ 0 };     // bus cycles executed since the PPU was last caught up
+        uint32_t cycles{ 0 };               // cpu cycles executed by the block
+        uint32_t instructions{ 0 };         // instructions retired by the block
+
+        uint8_t *ram{ nullptr };
+        const bool *ramCodePages{ nullptr };    // block cache pages holding decoded code, see BlockCache
+        Cpu2a03 *cpu{ nullptr };
+
+        // N and Z bits of the status register for every 8 bit result
+        uint8_t nzFlags[256];
+    };
+
+    typedef void(*JitBlockFnPtr)(JitContext *ctx);
+
+    struct JitBlock {
+        uint16_t startAddress{ 0 };
+        uint32_t bankState{ 0 };
+        uint16_t executions{ 0 };       // interpreter visits while waiting to become hot
+        bool compiled{ false };
+        JitBlockFnPtr code{ nullptr };  // nullptr after a compile if the first instruction isn't supported
+        uint32_t maxBusCycles{ 0 };     // worst case bus cycles (PPU catch-up) for the whole block
+    };
+
+    /**
+    *   Stands in for the cartridge's mapper in the JIT's differential mode, so nothing reaches the mapper twice.  While
+    *   a block runs (record) every access is passed on to the mapper and logged.  The interpreter's run of the same
+    *   instructions (replay) is given the logged reads and has its writes checked against the log, rather than
+    *   making them again.
+    *
+    *   Reads the block didn't make through the mapper (code, and PRG-ROM operands folded in when it was compiled)
+    *   come from the PRG pages mapped before the block, or from the mapper for one which maps no pages.  A block ends
+    *   after any write outside RAM, so those are the banks it ran from.  CHR reads are passed on in both; CHR writes are
+    *   only made while recording.
+    */
+    class JitMapperLog : public MemoryManagementController {
+    public:
+        struct Access {
+            uint16_t address;
+            uint8_t data;
+            bool read;
+        };
+
+        // Stand in for cart's mapper while a block runs
+        void record(Cartridge &cart);
+        // Give cart its mapper back and get replayCartridge ready for the interpreter
+        void stopRecording();
+        // The replay made the same mapper accesses as the block, in the same order
+        bool replayMatches() const { return !replayMismatch && replayed == log.size(); }
+
+        void doMemoryOperation(SystemBus &bus, Cartridge &cart) override;
+        uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override;
+        void mapPrgPages(Cartridge &cart) override;
+
+        // The cartridge being recorded with this in place of its mapper, for the interpreter's CPU and PPU
+        Cartridge replayCartridge{};
+
+    private:
+        // Follow the mapper's bank state and pages, which an access may have changed
+        void takeMapping();
+
+        Cartridge *cart{ nullptr };
+        MemoryManagementController *mapper{ nullptr };
+        bool recording{ false };
+        std::vector<Access> log;
+        size_t replayed{ 0 };
+        bool replayMismatch{ false };
+        // the mapper's PRG pages before the block
+        uint8_t *blockReadPages[MemoryPage::pageCount]{};
+        uint8_t *blockWritePages[MemoryPage::pageCount]{};
+    };
+
+    /**
+    *   Optional x86-64 dynamic recompiler for code running out of PRG-ROM.
+    *
+    *   Blocks which are entered often enough are translated to native code with A/X/Y/P held in host registers.
+    *   RAM accesses are done directly, PRG-ROM reads with fixed addresses are folded in as constants (blocks are tagged
+    *   with the mapper bank state) and everything else goes through Cpu2a03::doMemoryOperation after the PPU is caught
+    *   up.  A block is only entered if it can't run past the next PPU cycle which could raise an NMI, and ends after any
+    *   I/O access so the interpreter sees interrupts and DMA at the same instruction boundaries as it would on its own.
+    *
+    *   Anything else (unsupported instructions, DMA, interrupts, code in RAM, non x86-64 hosts) runs on the interpreter.
+    *
+    *   In differential mode every block is also run on a copy of the CPU/PPU through processInstruction and the results
+    *   compared, with the mapper accesses replayed from a JitMapperLog.  On a mismatch the interpreter's CPU and PPU
+    *   state is kept (the mapper keeps what the block did to it), the mismatch is counted (differentialMismatches,
+    *   lastMismatchAddress) and logged to the CPU's debugOutputFile if it has one.
+    */
+    class Jit {
+    public:
+        static const size_t numBlocks = 4096;
+        static const size_t codeBufferSize = 4 * 1024 * 1024;
+        static const uint32_t maxBlockInstructions = 32;
+        // interpreter visits before a block is compiled
+        static const uint16_t hotThreshold = 8;
+
+        Jit(Cpu2a03 &cpu);
+        ~Jit();
+        Jit(const Jit &) = delete;
+        Jit &operator=(const Jit &) = delete;
+
+        // True if native code can be generated on this host
+        static bool isSupported();
+
+        /**
+        *   Run a compiled block at the program counter if there is one (and it fits before the next PPU NMI event),
+        *   otherwise a single instruction on the interpreter.
+        *   Returns the interpreter debug state, or for a compiled block the registers before and after it ran.
+        */
+        DebugState step();
+
+        // Drop all generated code
+        void flush();
+
+        bool enabled{ true };
+        bool differential{ false };
+
+        // stats
+        uint32_t lastInstructionCount{ 0 };  // instructions retired by the last step
+        uint64_t instructionsExecuted{ 0 };
+        uint64_t jitInstructions{ 0 };
+        uint32_t blocksCompiled{ 0 };
+        uint32_t blocksRun{ 0 };
+        uint32_t deadlineFallbacks{ 0 };
+        uint32_t differentialMismatches{ 0 };
+        uint16_t lastMismatchAddress{ 0 };
+
+    private:
+        JitBlock *findBlock(uint16_t address, uint32_t bankState);
+        void compile(JitBlock &block);
+        DebugState runBlock(JitBlock &block);
+        // Run the same instructions on the interpreter starting from a snapshot taken before the block, replaying the
+        // mapper accesses from mapperLog if they were logged
+        void checkAgainstInterpreter(uint32_t instructions, bool loggedMapper);
+
+        Cpu2a03 &cpu;
+        JitContext context{};
+        std::vector<JitBlock> blocks;
+        uint32_t bankState{ 0 };
+        // differential mode's copy of the CPU/PPU, made once and reloaded before each block
+        std::unique_ptr<Cpu2a03> reference;
+        std::unique_ptr<Ppu2C02> referencePpu;
+        JitMapperLog mapperLog;
+
+        // executable memory for generated code
+        uint8_t *codeBuffer{ nullptr };
+        size_t codeUsed{ 0 };
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace NES {
+    // Things Cpu2a03::runCycles has to stop for at an instruction boundary, see Scheduler
+    enum class SchedulerEvent : uint8_t {
+        RunEnd,     // the runCycles budget is used up
+        Nmi,        // the PPU can change the NMI line (vblank set or cleared)
+        Dma,        // OAM DMA was started, it takes the bus at the next boundary
+        Poll,       // something the other deadlines don't predict can have changed the interrupt lines (PPU and mapper
+                    // register writes, an IRQ held while masked): look again at the next boundary
+        Count
+    };
+
+    /**
+    *   Deadlines on the master clock (CpuVariant::masterClocksPerCpuCycle/masterClocksPerPpuCycle), kept in a min-heap
+    *   so the earliest is always at hand.  At most one deadline per event, scheduling an event again moves it.
+    *
+    *   Timestamps are 64 bit so a session can run for as long as it likes; at 21.48MHz that's tens of thousands of
+    *   years before they wrap.
+    */
+    class Scheduler {
+    public:
+        static const uint64_t never = UINT64_MAX;
+
+        void schedule(SchedulerEvent event, uint64_t time);
+        void cancel(SchedulerEvent event);
+        // never if event isn't scheduled
+        uint64_t getDeadline(SchedulerEvent event) const;
+        // Earliest deadline, never if nothing is scheduled
+        uint64_t getNextDeadline() const {
+            return size == 0 ? never : heap[0].time;
+        }
+        // Take the earliest event off the heap if it's due at time, SchedulerEvent::Count otherwise
+        SchedulerEvent popDue(uint64_t time);
+
+    private:
+        static const size_t eventCount = (size_t)SchedulerEvent::Count;
+        static const uint8_t notScheduled = 0xff;
+
+        struct Deadline {
+            uint64_t time;
+            SchedulerEvent event;
+        };
+
+        void place(uint8_t index, const Deadline &deadline);
+        // Restore the heap order after the deadline at index changed
+        void update(uint8_t index);
+
+        Deadline heap[eventCount]{};
+        // heap index of each event, notScheduled if it isn't
+        uint8_t positions[eventCount]{ notScheduled, notScheduled, notScheduled, notScheduled };
+        uint8_t size{ 0 };
+    };
+}
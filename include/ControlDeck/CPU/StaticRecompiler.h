@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <set>
+#include <vector>
+#include "cpu2A03.h"
+
+namespace NES {
+    /**
+    *   Instruction found in PRG-ROM while walking the program, with its operand bytes.
+    */
+    struct RecompiledInstruction {
+        uint16_t address{ 0 };
+        uint8_t opCode{ 0 };
+        uint8_t operands[2]{};
+        uint8_t length{ 1 };        // op code + operand bytes
+    };
+
+    /**
+    *   Control flow graph of a program with fixed PRG banks (NROM).
+    *
+    *   Built by following the reset, NMI and IRQ vectors through branches, JMP and JSR (including the return address).
+    *   Walking stops at RTS/RTI/BRK and unknown op codes.  JMP indirect through a pointer in PRG-ROM is followed,
+    *   pointers anywhere else can't be resolved ahead of time and are recorded in indirectJumps.
+    *
+    *   Only PRG-ROM ($8000-$ffff) is walked.  Code copied to RAM and computed jumps (jump tables through RTS, RAM
+    *   pointers) are left to the interpreter.
+    */
+    class ControlFlowGraph {
+    public:
+        void build(Cpu2a03 &cpu);
+
+        bool contains(uint16_t address) const {
+            return instructions.count(address) != 0;
+        }
+
+        std::map<uint16_t, RecompiledInstruction> instructions;
+        // branch/jump targets and fall through addresses after a branch
+        std::set<uint16_t> blockStarts;
+        // reset, NMI and IRQ handlers
+        std::vector<uint16_t> entryPoints;
+        // address of every JMP ($xxxx) whose target wasn't known when walking
+        std::vector<uint16_t> indirectJumps;
+    };
+
+    /**
+    *   Signature of the generated code.  Runs instructions starting at the program counter until maxInstructions have
+    *   been executed, the program counter leaves the code found in the graph, or an interrupt or DMA is pending.
+    *   Returns the number of instructions executed (0 if the program counter wasn't in the graph).
+    */
+    typedef uint32_t(*RecompiledFnPtr)(Cpu2a03 &cpu, uint32_t maxInstructions);
+
+    /**
+    *   Write a C++ translation unit defining functionName as a RecompiledFnPtr for the program in graph.
+    *
+    *   Each instruction becomes a case of a switch on the program counter calling Cpu2a03::executeFusedOpCode for its op
+    *   code with the operands as constants, so the addressing mode and instruction handler are fixed at compile time.
+    *   Cases fall straight through to the next instruction wherever control flow allows.
+    *   The generated code only depends on the public headers and links against libControlDeck.
+    */
+    void writeRecompiledSource(const ControlFlowGraph &graph, FILE *out, const char *functionName, const char *romName = nullptr);
+
+    // True if the next instruction can run from recompiled code, false if the interpreter has to handle DMA or an interrupt
+    inline bool canRunRecompiled(const Cpu2a03 &cpu) {
+        return !cpu.dmaData.isActive && !cpu.interrupts.isPending();
+    }
+
+    /**
+    *   Runs a recompiled program, handing over to the interpreter for anything the generated code can't run.
+    */
+    class RecompiledProgram {
+    public:
+        // instructions run per step before returning to the caller
+        static const uint32_t defaultMaxInstructions = 64;
+
+        RecompiledProgram(Cpu2a03 &cpu) : cpu(cpu) {}
+
+        /**
+        *   Run recompiled code at the program counter, or a single instruction on the interpreter if there is none.
+        *   Returns the interpreter debug state, or for recompiled code the registers before and after it ran.
+        */
+        DebugState step();
+
+        RecompiledFnPtr code{ nullptr };
+        uint32_t maxInstructions{ defaultMaxInstructions };
+
+        // stats
+        uint32_t lastInstructionCount{ 0 };  // instructions retired by the last step
+        uint64_t instructionsExecuted{ 0 };
+        uint64_t recompiledInstructions{ 0 };
+        uint64_t interpreterFallbacks{ 0 };
+    private:
+        Cpu2a03 &cpu;
+    };
+}
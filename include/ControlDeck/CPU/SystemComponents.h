@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 namespace NES {
     // Bit location of processor status flags 
@@ -26,6 +27,46 @@ namespace NES {
         INT_BRK
     };
 
+    /**
+    *   Processor status register (P) with N and Z evaluated lazily.
+    *
+    *   Nearly every instruction sets N and Z from its result but few of those results are ever looked at before the
+    *   next instruction overwrites them.  Instead of a read-modify-write of the flag byte, the last byte each flag was
+    *   set from is kept and the flags are only built when P is read (flagSet, PHP/BRK/interrupt pushes, debug output).
+    *
+    *   Reads and writes through uint8_t work as they did when P was a plain byte.
+    */
+    struct StatusRegister {
+        static const uint8_t lazyFlagsMask = (1 << ProcessorStatus::NegativeFlag) | (1 << ProcessorStatus::ZeroFlag);
+
+        inline uint8_t value() const {
+            return (bits & ~lazyFlagsMask) | (zeroResult == 0 ? (1 << ProcessorStatus::ZeroFlag) : 0) | (negativeResult & 0x80);
+        }
+
+        inline operator uint8_t() const {
+            return value();
+        }
+
+        inline StatusRegister &operator=(uint8_t val) {
+            bits = val;
+            zeroResult = (val & (1 << ProcessorStatus::ZeroFlag)) != 0 ? 0 : 1;
+            negativeResult = val;
+            return *this;
+        }
+
+        inline StatusRegister &operator|=(uint8_t val) {
+            return *this = value() | val;
+        }
+
+        inline StatusRegister &operator&=(uint8_t val) {
+            return *this = value() & val;
+        }
+
+        uint8_t bits{ 0 };             // every flag except N and Z
+        uint8_t zeroResult{ 1 };       // Z is set if this is 0
+        uint8_t negativeResult{ 0 };   // N is bit 7 of this
+    };
+
     // Sources:  http://nesdev.com/NESDoc.pdf
     struct Registers {
         // Reference: http://e-tradition.net/bytes/6502/6502_instruction_set.html for flags altered by a given instruction
@@ -50,31 +91,49 @@ namespace NES {
         // Status register utils
         // program counter low byte
         inline bool flagSet(ProcessorStatus flag) {
-            return (statusRegister & (1 << flag)) != 0;
+            switch (flag) {
+            case ProcessorStatus::ZeroFlag:
+                return statusRegister.zeroResult == 0;
+            case ProcessorStatus::NegativeFlag:
+                return (statusRegister.negativeResult & 0x80) != 0;
+            default:
+                return (statusRegister.bits & (1 << flag)) != 0;
+            }
         }
 
         inline void setFlag(ProcessorStatus flag) {
-            statusRegister |= (1 << flag);
+            switch (flag) {
+            case ProcessorStatus::ZeroFlag:
+                statusRegister.zeroResult = 0;
+                break;
+            case ProcessorStatus::NegativeFlag:
+                statusRegister.negativeResult = 0x80;
+                break;
+            default:
+                statusRegister.bits |= (1 << flag);
+            }
         }
 
         inline void clearFlag(ProcessorStatus flag) {
-            statusRegister &= ~(1 << flag);
+            switch (flag) {
+            case ProcessorStatus::ZeroFlag:
+                statusRegister.zeroResult = 1;
+                break;
+            case ProcessorStatus::NegativeFlag:
+                statusRegister.negativeResult = 0;
+                break;
+            default:
+                statusRegister.bits &= ~(1 << flag);
+            }
         }
 
+        // N and Z are only recorded here, see StatusRegister
         inline void setFlagIfNegative(uint8_t val) {
-            if ((val & 0x80) != 0) {
-                setFlag(ProcessorStatus::NegativeFlag);
-            } else {
-                clearFlag(ProcessorStatus::NegativeFlag);
-            }
+            statusRegister.negativeResult = val;
         }
 
         inline void setFlagIfZero(uint8_t val) {
-            if (val == 0) {
-                setFlag(ProcessorStatus::ZeroFlag);
-            } else {
-                clearFlag(ProcessorStatus::ZeroFlag);
-            }
+            statusRegister.zeroResult = val;
         }
 
         inline bool willAddOverflow(uint8_t val) {
@@ -99,6 +158,7 @@ namespace NES {
         }
 
         void statusToString(char out[8]) {
+            uint8_t statusRegister = this->statusRegister;
             // Rearranged s/t bit 0(carry) is out[7] to read l to r
             out[0] = 'n' - (((statusRegister & 0x80) > 0) * 32);
             out[1] = 'v' - (((statusRegister & 0x40) > 0) * 32);
@@ -128,12 +188,9 @@ namespace NES {
         uint8_t stackPointer;
 
         // Program status flag register  (Commonly referred to as P)
-        uint8_t statusRegister;
+        StatusRegister statusRegister;
 
         uint16_t programCounter;
-
-        // interrupts needing to be processed.
-        InterruptType interruptStatus;
     };
 
     /**
@@ -179,6 +236,27 @@ namespace NES {
         uint8_t ram[systemRAMBytes]{ 0 };
     };
 
+    // What sits behind a page of CPU address space, see Cpu2a03::memoryPages
+    enum class MemoryPageHandler : uint8_t {
+        SystemRam,      // $0000-$1fff  2kb of RAM and its mirrors
+        PpuRegisters,   // $2000-$3fff  8 registers, mirrored
+        IoRegisters,    // $4000-$43ff  APU and I/O registers up to $401f, cartridge space after
+        Cartridge,      // $4400-$ffff  the mapper, or straight to PRG-ROM/RAM through read/write
+    };
+
+    // 1kb of CPU address space
+    struct MemoryPage {
+        static const uint8_t pageBits = 10;
+        static const uint16_t pageMask = (1 << pageBits) - 1;
+        static const size_t pageCount = 0x10000 >> pageBits;
+
+        // The page's bytes where the mapper has put it straight onto PRG-ROM or PRG-RAM, nullptr where the access goes
+        // through handler
+        uint8_t *read{ nullptr };
+        uint8_t *write{ nullptr };
+        MemoryPageHandler handler{ MemoryPageHandler::Cartridge };
+    };
+
     struct DMAData {
         void activate(uint8_t baseDmaAddress) {
             baseAddress = baseDmaAddress;
@@ -1,7 +1,13 @@
 #pragma once
+#include <array>
 #include "AddressingMode.h"
 #include "SystemComponents.h"
 #include "InstructionSet.h"
+#include "BlockCache.h"
+#include "FlagLiveness.h"
+#include "InterruptController.h"
+#include "Scheduler.h"
+#include "CpuVariant.h"
 #include "../cartridge.h"
 #include "../PPU/PPU2C02.h"
 
@@ -13,24 +19,34 @@ namespace NES {
     class Cpu2a03;
     struct OpCode;
     typedef uint8_t(*InstructionFnPtr)(const OpCode &opCode, Cpu2a03 &cpu);
+    struct OpCodeArgs;
+    // Addressing mode and instruction handler for one op code in a single call.  Returns the branch cycles.
+    typedef uint8_t(*FusedOpCodeFnPtr)(Cpu2a03 &cpu, OpCodeArgs &args);
 
+    /**
+    *   Op code table entry.  Packed into 4 bytes so the whole table is 1KB.  The handler is looked up by instruction in
+    *   InstructionSet::instructionHandlers, and names for debug output are in instructionNames/addressingModeNames.
+    */
     struct OpCode {
         // Op code reference
-        const uint8_t opCode;
+        uint8_t opCode;
 
         // Bytes to read for instruction data
-        const uint8_t bytes;
+        uint8_t bytes : 2;
 
         // All instructions are at least 2 cycles long.  First cycle is always to increment and select the program counter as the next address to appear on the bus
-        const uint8_t cycles;
+        uint8_t cycles : 3;
         // Additional cycles added for page boundaries.
         // 0,1,2 1 for page boundary crossed, 2 for branch sending to different page
-        const uint8_t pageCycles;
+        uint8_t pageCycles : 2;
+
+        Instruction instruction;
+        AddressingMode addressingMode;
 
-        const Instruction instruction;
-        const AddressingMode addressingMode;
-        const InstructionFnPtr instructionHandler;
+        InstructionFnPtr handler() const;
     };
+    static_assert(sizeof(OpCode) == 4, "OpCode table entries should stay packed");
+
     // debug info about arguments for an op code
     struct OpCodeArgs {
         uint8_t pagingCycles{ 0 };
@@ -65,6 +81,8 @@ namespace NES {
         DMAData dmaBefore;
         DMAData dmaAfter;
         bool isDma{ false };
+        // More than one when a superinstruction ran or an idle loop was skipped
+        uint32_t instructionCount{ 1 };
         void print(FILE * debugOut);
         inline uint8_t getCyclesExecuted() { return addressingCycles + branchCycles + opCode->cycles; }
     };
@@ -72,6 +90,14 @@ namespace NES {
 
 
 
+    // Idle loop fast-forward counters
+    struct IdleLoopStats {
+        uint32_t loopsDetected{ 0 };    // decoded blocks recognized as idle loops
+        uint32_t fastForwards{ 0 };     // times iterations were skipped
+        uint64_t iterationsSkipped{ 0 };
+        uint64_t cyclesSkipped{ 0 };    // cpu cycles
+    };
+
     /**
     * NTSC 6502 CPU 
     */
@@ -85,10 +111,56 @@ namespace NES {
             }
         }
         DebugState processInstruction();
+        /**
+        *   Execute an instruction whose op code and operands are already known (recompiled code).  Same bus activity
+        *   and timing as processInstruction without the reads through the memory mapper for the op code and operands.
+        *   Interrupts and DMA are not checked.  Returns the cycles taken.
+        */
+        uint8_t executeInstruction(const OpCode &opCode, uint8_t operand0 = 0, uint8_t operand1 = 0);
+        /**
+        *   executeInstruction for an op code known when the calling code is compiled (what the static recompiler emits).
+        *   Runs the op code's fusedOpCode specialization, so the addressing mode and instruction handler are resolved
+        *   at compile time instead of looked up through the op code table.  Instantiated for all 256 op codes.
+        */
+        template<uint8_t op>
+        uint8_t executeFusedOpCode(uint8_t operand0 = 0, uint8_t operand1 = 0);
+        /**
+        *   Run instructions until at least budget cpu cycles have passed.  Returns the cycles actually run.
+        *
+        *   Same bus activity and timing as calling processInstruction in a loop, but A, X, Y, SP, PC and P are kept in
+        *   locals and only written back to registers around DMA, interrupts, instructions left to the op code handlers
+        *   and when the budget runs out.  No DebugState is built.  With debug set this is a processInstruction loop
+        *   so the trace keeps working.
+        *
+        *   Instructions run back to back up to the next scheduler deadline (the end of the budget, the PPU's next
+        *   vblank edge, a DMA or register write which needs a look) instead of checking DMA and the interrupt lines
+        *   between every two.
+        *
+        *   systemBus isn't kept up to date for system RAM accesses.
+        */
+        uint32_t runCycles(uint32_t budget);
+        // cpu cycles executed since power up
+        uint64_t getCycle() const {
+            return cycle;
+        }
+        // master clock ticks since power up, the Scheduler's time base
+        uint64_t getMasterClock() const {
+            return cycle * CpuVariant::masterClocksPerCpuCycle;
+        }
+        // Instructions retired by processInstruction and runCycles (not by Jit or RecompiledProgram code)
+        uint64_t instructionsExecuted{ 0 };
+        // $4016/$4017 reads, a frame without any is a lag frame
+        uint64_t controllerReads{ 0 };
 
         //Map memory from the CPU address space, to RAM, PPU, APU, and cartridge components.
         unsigned int doMemoryOperation();
         uint8_t readFromAddress(uint16_t addr);
+        /**
+        *   doMemoryOperation for the zero page and stack page ($0000-$01ff).  Those are always system RAM so the
+        *   address decoding is skipped.  The PPU still runs for the bus cycle.
+        */
+        void doZeroPageOperation();
+        uint8_t readFromZeroPage(uint16_t addr);
 
         /**
         *    Handler for instruction based parameter fetching and calculation of addresses.  Each instruction has an
@@ -107,7 +179,8 @@ namespace NES {
         
         // hardware interrupt signals
         void reset();
-        void setIrq();
+        void setIrq(IrqSource source = IRQ_EXTERNAL);
+        void clearIrq(IrqSource source = IRQ_EXTERNAL);
         void setNmi();
 
         void interrupt(InterruptType interruptType);
@@ -118,29 +191,192 @@ namespace NES {
         void popStackToDataBusWithFlags();
         void popStackToDataBus();
         void pushDataBusToStack();
+        // Run the PPU for one cpu bus cycle, or owe it the cycles with ppuBatchingEnabled
         void synchronizeProcessors();
+        // Run the PPU cycles owed since the last catch up
+        void catchUpPpu();
 
         SystemRam ram{};
         SystemBus systemBus{};
         Registers registers{};
         DMAData dmaData{};
+        // NMI/IRQ/reset lines, checked between instructions.  The PPU's NMI output (Ppu2C02::interrupts) points here.
+        InterruptController interrupts{};
+        // Deadlines runCycles stops at, see SchedulerEvent
+        Scheduler scheduler{};
         Ppu2C02 *ppu{ nullptr };
         Cartridge *cartridge{ nullptr };
         bool debug{ false };
         FILE * debugOutputFile {nullptr};
+
+        // Execute out of pre-decoded blocks instead of fetching and decoding every instruction from the bus.
+        bool blockCacheEnabled{ false };
+        BlockCache blockCache{};
+
+        // Dispatch through op code handlers specialized at compile time for their instruction and addressing mode
+        // instead of handleAddressingMode and OpCode::handler.
+        bool fusedDispatchEnabled{ false };
+
+        // Run common instruction sequences recognized when a block is decoded (vblank polls, delay loops, counters,
+        // compare and branch) as one operation.  Only used with blockCacheEnabled and without debug.
+        // processInstruction can then retire more than one instruction, see DebugState::instructionCount.
+        bool superInstructionsEnabled{ false };
+
+        /**
+        *   Skip ahead over loops which only wait on the PPU status register or on RAM the NMI handler writes
+        *   (JMP *, LDA $2002 / BPL, LDA zp / BEQ ...).  After a real iteration of such a loop the next ones would read
+        *   the same values until the PPU raises or clears vblank, so they are replaced by running the PPU up to that
+        *   point in one go.  Only used with blockCacheEnabled and without debug.
+        */
+        bool idleLoopSkipEnabled{ false };
+        IdleLoopStats idleLoopStats{};
+
+        /**
+        *   Run the PPU in batches instead of interleaving it with every bus cycle.  synchronizeProcessors only counts
+        *   the PPU cycles owed and the PPU catches up before anything which can see or change its state: PPU register
+        *   and OAM DMA accesses, mapper writes, and every instruction boundary (where interrupts are checked).  The
+        *   result is the same as running it inline, see PpuBatchingTest.
+        */
+        bool ppuBatchingEnabled{ false };
+
+        /**
+        *   With ppuBatchingEnabled, don't catch the PPU up at every instruction boundary either, only at the
+        *   scheduler's deadlines: once it gets close enough to raise or clear vblank (and the NMI), and while DMA or an
+        *   interrupt is waiting.  PPU register and OAM DMA accesses and mapper writes still catch it up first.  The PPU
+        *   lags behind the CPU in between, so anything looking at it from outside (a frontend taking the frame) calls
+        *   catchUpPpu first.  See PpuBatchingTest.
+        */
+        bool lazyPpuEnabled{ false };
+
+        /**
+        *   Skip computing C and V in ADC/SBC, compares, shifts and BIT when every path from the instruction overwrites
+        *   them before they are read (see FlagLiveness).  Code in RAM computes every flag.  Only used without debug,
+        *   dead flags are left stale so P can differ from a run without it.
+        */
+        bool flagLivenessEnabled{ false };
+
+        /**
+        *   Run an OAM DMA ($4014) in one processInstruction call instead of one call per cycle: the source page is
+        *   copied straight into OAM, the 513/514 cycles are charged at once and the PPU catches up in one batch.
+        *   Falls back to the per-cycle transfer when the source page isn't RAM or PRG-ROM, or when the PPU would
+        *   reach a scan line which touches OAM before the transfer ends.
+        */
+        bool bulkOamDmaEnabled{ false };
+        FlagLiveness flagLiveness{};
+        // Flags (ProcessorStatus bits) the instruction being executed has to produce
+        uint8_t liveFlags{ FlagLiveness::allFlags };
+        inline bool isFlagLive(ProcessorStatus flag) const {
+            return (liveFlags & (1 << flag)) != 0;
+        }
+
+        // Side effect free read used when decoding.  Only valid for BlockCache::isCacheableAddress addresses.
+        uint8_t peekCodeByte(uint16_t address);
+        // Mapper PRG bank layout (see MemoryManagementController::prgBankState), 0 without a cartridge
+        uint32_t getPrgBankState();
+        // Take the cartridge's PRG pages into memoryPages.  Done on the first cartridge access; call it again after
+        // swapping cartridge or its mapper.
+        void mapCartridge();
     protected:
-        uint32_t cycle{ 0 };
+        // cpu cycle counter is advanced directly when running recompiled code
+        friend class Jit;
+
+        uint64_t cycle{ 0 };
+        // Cycle of the scheduler's earliest deadline, rounded up to a whole cpu cycle
+        uint64_t nextEventCycle{ 0 };
+        void scheduleEvent(SchedulerEvent event, uint64_t time);
+        void cancelEvent(SchedulerEvent event);
+        // Catch the PPU up and reschedule the NMI and poll deadlines from where it and the interrupt lines are now
+        void scheduleInterruptChecks();
+        // Handle the deadlines due by now.  true if that's the end of the runCycles budget.
+        bool runDueEvents();
+        // Fractional PPU cycles carried between cpu cycles when CpuVariant doesn't run a whole number per cycle (PAL)
+        uint32_t ppuClockPhase{ 0 };
+        uint32_t pendingPpuCycles{ 0 };
+        // The whole OAM DMA transfer when bulkOamDmaEnabled allows it.  Returns the cycles taken, 0 if the transfer has
+        // to run cycle by cycle.
+        uint32_t runBulkOamDma();
         void waitForNextInstruction();
         // Run cycles of PPU corresponding to a single cpu instruction having occurred
         
 
+        /**
+        *   CPU address space in 1kb pages, looked up by doMemoryOperation instead of comparing the address against each
+        *   region.  Cartridge pages the mapper maps straight onto PRG-ROM/RAM are read and written through their
+        *   pointers; everything else goes to the page's handler.
+        */
+        std::array<MemoryPage, MemoryPage::pageCount> memoryPages{ getDefaultMemoryPages() };
+        // Mapper memoryPages was last filled in from
+        MemoryManagementController *mappedMmc{ nullptr };
+        static std::array<MemoryPage, MemoryPage::pageCount> getDefaultMemoryPages();
+        // Copy the mapper's prgReadPages/prgWritePages into memoryPages
+        void copyCartridgePages();
+
         void systemRamHandler(SystemBus &systemBus);
         void ppuRegisterHandler(SystemBus &systemBus);
         void ioRegisterHandler(SystemBus &systemBus);
+        void cartridgeHandler(SystemBus &systemBus);
 
         // Fetch next op code or handle interrupt
         const OpCode *fetchOpCode();
 
+        ///////////////////////////////////////////////////////////////////////
+        // Block cache
+        
+        // Decoded instruction at the program counter, decoding a new block on a miss.  nullptr if the instruction 
+        // must go through the regular fetch/decode path (uncacheable address or a bank switch just happened).
+        const DecodedInstruction *fetchDecodedInstruction();
+        CachedBlock *decodeBlock(uint16_t address, uint32_t bankState);
+        void fetchDecodedOpCode(const DecodedInstruction &decoded);
+        OpCodeArgs handleDecodedAddressingMode(const DecodedInstruction &decoded);
+        static AddressingStepFnPtr getAddressingStep(AddressingMode addressingMode);
+        // Operand byte at PC + index.  Served from the decoded instruction when executing out of the block cache.
+        uint8_t readOperand(uint8_t index);
+
+        ///////////////////////////////////////////////////////////////////////
+        // Fused op code handlers
+
+        // handleAddressingMode with the mode known at compile time
+        template<AddressingMode addressingMode>
+        void fetchOperands(OpCodeArgs &args);
+        template<Instruction instruction, AddressingMode addressingMode>
+        static uint8_t fusedOpCode(Cpu2a03 &cpu, OpCodeArgs &args);
+        // fusedOpCode instantiation for every entry of InstructionSet::opCodes
+        static const FusedOpCodeFnPtr fusedOpCodes[256];
+
+        ///////////////////////////////////////////////////////////////////////
+        // Superinstructions
+
+        // Tag the first instruction of each recognized sequence in a freshly decoded block
+        static void findSuperInstructions(CachedBlock &block);
+        // One decoded instruction through its fused handler.  Returns the cycles taken.
+        template<Instruction instruction, AddressingMode addressingMode>
+        uint8_t runDecodedInstruction(const DecodedInstruction &decoded);
+        // Op code fetch for the next instruction of a sequence run in one go (superinstructions, idle loops).
+        // false if DMA or an NMI is due first.
+        bool continueSequence(const DecodedInstruction &decoded);
+        template<Instruction instruction0, AddressingMode addressingMode0, Instruction instruction1, AddressingMode addressingMode1>
+        static uint8_t superInstructionPair(Cpu2a03 &cpu, const DecodedInstruction *sequence, uint8_t &instructionCount);
+        template<Instruction instruction0, AddressingMode addressingMode0, Instruction instruction1, AddressingMode addressingMode1,
+            Instruction instruction2, AddressingMode addressingMode2>
+        static uint8_t superInstructionTriple(Cpu2a03 &cpu, const DecodedInstruction *sequence, uint8_t &instructionCount);
+
+        ///////////////////////////////////////////////////////////////////////
+        // Idle loops
+
+        // Tag the block if it is an idle loop
+        void findIdleLoop(CachedBlock &block);
+        // One iteration of the loop starting at loop (op code already fetched), then skip the iterations which can't
+        // see a change.  Returns the cycles taken.
+        uint32_t runIdleLoop(const DecodedInstruction *loop, uint32_t &instructionCount);
+
+        ///////////////////////////////////////////////////////////////////////
+        // runCycles bus access, one bus cycle each
+        uint8_t runLoopRead(uint16_t address);
+        void runLoopWrite(uint16_t address, uint8_t value);
+
+        const DecodedInstruction *decodedInstruction{ nullptr };
+        uint32_t blockCacheBankState{ 0 };
+
         ///////////////////////////////////////////////////////////////////////
         // Addressing mode handlers
         
@@ -161,6 +397,8 @@ namespace NES {
 
         // Addressing mode access utilities
         void  fetchIndirectAddressToBus();
+        // fetchIndirectAddressToBus for a pointer on the zero page (the high byte can come from $0100)
+        void  fetchZeroPageIndirectAddressToBus();
         void  fetchAddressFromPCToBus(OpCodeArgs &args);
     };
 
@@ -248,282 +486,63 @@ namespace NES {
 
         uint8_t UNK(const OpCode &opCode, Cpu2a03 &cpu);
 
-        // Sourced from http://e-tradition.net/bytes/6502/6502_instruction_set.html
-        //static const OpCode opCodes[256];
-        const OpCode opCodes[256] = {
-            // op, bytes, cycles, page, instruction, addressing mode, handler
-            { 0x00, 1, 7, 0, Instruction::BRK, AddressingMode::Implicit, &BRK },
-            { 0x01, 2, 6, 0, Instruction::ORA, AddressingMode::XIndexedIndirect, &ORA },
-            { 0x02, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x03, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x04, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x05, 2, 3, 0, Instruction::ORA, AddressingMode::ZeroPage, &ORA },
-            { 0x06, 2, 5, 0, Instruction::ASL, AddressingMode::ZeroPage, &ASL },
-            { 0x07, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x08, 1, 3, 0, Instruction::PHP, AddressingMode::Implicit, &PHP },
-            { 0x09, 2, 2, 0, Instruction::ORA, AddressingMode::Immediate, &ORA },
-            { 0x0a, 1, 2, 0, Instruction::ASL, AddressingMode::Accumulator, &ASL },
-            { 0x0b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x0c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x0d, 3, 4, 0, Instruction::ORA, AddressingMode::Absolute, &ORA },
-            { 0x0e, 3, 6, 0, Instruction::ASL, AddressingMode::Absolute, &ASL },
-            { 0x0f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0x10, 2, 2, 2, Instruction::BPL, AddressingMode::Relative, &BPL },
-            { 0x11, 2, 5, 1, Instruction::ORA, AddressingMode::IndirectYIndexed, &ORA },
-            { 0x12, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x13, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x14, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x15, 2, 4, 0, Instruction::ORA, AddressingMode::ZeroPageX, &ORA },
-            { 0x16, 2, 6, 0, Instruction::ASL, AddressingMode::ZeroPageX, &ASL },
-            { 0x17, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x18, 1, 2, 0, Instruction::CLC, AddressingMode::Implicit, &CLC },
-            { 0x19, 3, 4, 1, Instruction::ORA, AddressingMode::AbsoluteY, &ORA },
-            { 0x1a, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x1b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x1c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x1d, 3, 4, 1, Instruction::ORA, AddressingMode::AbsoluteX, &ORA },
-            { 0x1e, 3, 7, 0, Instruction::ASL, AddressingMode::AbsoluteX, &ASL },
-            { 0x1f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0x20, 3, 6, 0, Instruction::JSR, AddressingMode::Absolute, &JSR },
-            { 0x21, 2, 6, 0, Instruction::AND, AddressingMode::XIndexedIndirect, &AND },
-            { 0x22, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x23, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x24, 2, 3, 0, Instruction::BIT, AddressingMode::ZeroPage, &BIT },
-            { 0x25, 2, 3, 0, Instruction::AND, AddressingMode::ZeroPage, &AND },
-            { 0x26, 2, 5, 0, Instruction::ROL, AddressingMode::ZeroPage, &ROL },
-            { 0x27, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x28, 1, 4, 0, Instruction::PLP, AddressingMode::Implicit, &PLP },
-            { 0x29, 2, 2, 0, Instruction::AND, AddressingMode::Immediate, &AND },
-            { 0x2a, 1, 2, 0, Instruction::ROL, AddressingMode::Accumulator, &ROL },
-            { 0x2b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x2c, 3, 4, 0, Instruction::BIT, AddressingMode::Absolute, &BIT },
-            { 0x2d, 3, 4, 0, Instruction::AND, AddressingMode::Absolute, &AND },
-            { 0x2e, 3, 6, 0, Instruction::ROL, AddressingMode::Absolute, &ROL },
-            { 0x2f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0x30, 2, 2, 2, Instruction::BMI, AddressingMode::Relative, &BMI },
-            { 0x31, 2, 5, 1, Instruction::AND, AddressingMode::IndirectYIndexed, &AND },
-            { 0x32, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x33, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x34, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x35, 2, 4, 0, Instruction::AND, AddressingMode::ZeroPageX, &AND },
-            { 0x36, 2, 6, 0, Instruction::ROL, AddressingMode::ZeroPageX, &ROL },
-            { 0x37, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x38, 1, 2, 0, Instruction::SEC, AddressingMode::Implicit, &SEC },
-            { 0x39, 3, 4, 1, Instruction::AND, AddressingMode::AbsoluteY, &AND },
-            { 0x3a, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x3b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x3c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x3d, 3, 4, 1, Instruction::AND, AddressingMode::AbsoluteX, &AND },
-            { 0x3e, 3, 7, 0, Instruction::ROL, AddressingMode::AbsoluteX, &ROL },
-            { 0x3f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0x40, 1, 6, 0, Instruction::RTI, AddressingMode::Implicit, &RTI },
-            { 0x41, 2, 6, 0, Instruction::EOR, AddressingMode::XIndexedIndirect, &EOR },
-            { 0x42, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x43, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x44, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x45, 2, 3, 0, Instruction::EOR, AddressingMode::ZeroPage, &EOR },
-            { 0x46, 2, 5, 0, Instruction::LSR, AddressingMode::ZeroPage, &LSR },
-            { 0x47, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x48, 1, 3, 0, Instruction::PHA, AddressingMode::Implicit, &PHA },
-            { 0x49, 2, 2, 0, Instruction::EOR, AddressingMode::Immediate, &EOR },
-            { 0x4a, 1, 2, 0, Instruction::LSR, AddressingMode::Accumulator, &LSR },
-            { 0x4b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x4c, 3, 3, 0, Instruction::JMP, AddressingMode::Absolute, &JMP },
-            { 0x4d, 3, 4, 0, Instruction::EOR, AddressingMode::Absolute, &EOR },
-            { 0x4e, 3, 6, 0, Instruction::LSR, AddressingMode::Absolute, &LSR },
-            { 0x4f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0x50, 2, 2, 2, Instruction::BVC, AddressingMode::Relative, &BVC },
-            { 0x51, 2, 5, 1, Instruction::EOR, AddressingMode::IndirectYIndexed, &EOR },
-            { 0x52, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x53, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x54, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x55, 2, 4, 0, Instruction::EOR, AddressingMode::ZeroPageX, &EOR },
-            { 0x56, 2, 6, 0, Instruction::LSR, AddressingMode::ZeroPageX, &LSR },
-            { 0x57, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x58, 1, 2, 0, Instruction::CLI, AddressingMode::Implicit, &CLI },
-            { 0x59, 3, 4, 1, Instruction::EOR, AddressingMode::AbsoluteY, &EOR },
-            { 0x5a, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x5b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x5c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x5d, 3, 4, 1, Instruction::EOR, AddressingMode::AbsoluteX, &EOR },
-            { 0x5e, 3, 7, 0, Instruction::LSR, AddressingMode::AbsoluteX, &LSR },
-            { 0x5f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0x60, 1, 6, 0, Instruction::RTS, AddressingMode::Implicit, &RTS },
-            { 0x61, 2, 6, 0, Instruction::ADC, AddressingMode::Indirect, &ADC },
-            { 0x62, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x63, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x64, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x65, 2, 3, 0, Instruction::ADC, AddressingMode::ZeroPage, &ADC },
-            { 0x66, 2, 5, 0, Instruction::ROR, AddressingMode::ZeroPage, &ROR },
-            { 0x67, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x68, 1, 4, 0, Instruction::PLA, AddressingMode::Implicit, &PLA },
-            { 0x69, 2, 2, 0, Instruction::ADC, AddressingMode::Immediate, &ADC },
-            { 0x6a, 1, 2, 0, Instruction::ROR, AddressingMode::Accumulator, &ROR },
-            { 0x6b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x6c, 3, 3, 0, Instruction::JMP, AddressingMode::Indirect, &JMP },
-            { 0x6d, 3, 4, 0, Instruction::ADC, AddressingMode::Absolute, &ADC },
-            { 0x6e, 3, 6, 0, Instruction::ROR, AddressingMode::Absolute, &ROR },
-            { 0x6f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0x70, 2, 2, 2, Instruction::BVS, AddressingMode::Relative, &BVS },
-            { 0x71, 2, 5, 1, Instruction::ADC, AddressingMode::IndirectYIndexed, &ADC },
-            { 0x72, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x73, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x74, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x75, 2, 4, 0, Instruction::ADC, AddressingMode::ZeroPageX, &ADC },
-            { 0x76, 2, 6, 0, Instruction::ROR, AddressingMode::ZeroPageX, &ROR },
-            { 0x77, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x78, 1, 2, 0, Instruction::SEI, AddressingMode::Implicit, &SEI },
-            { 0x79, 3, 4, 1, Instruction::ADC, AddressingMode::AbsoluteY, &ADC },
-            { 0x7a, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x7b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x7c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x7d, 3, 4, 1, Instruction::ADC, AddressingMode::AbsoluteX, &ADC },
-            { 0x7e, 3, 7, 0, Instruction::ROR, AddressingMode::AbsoluteX, &ROR },
-            { 0x7f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0x80, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x81, 2, 6, 0, Instruction::STA, AddressingMode::Indirect, &STA },
-            { 0x82, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x83, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x84, 2, 3, 0, Instruction::STY, AddressingMode::ZeroPage, &STY },
-            { 0x85, 2, 3, 0, Instruction::STA, AddressingMode::ZeroPage, &STA },
-            { 0x86, 2, 3, 0, Instruction::STX, AddressingMode::ZeroPage, &STX },
-            { 0x87, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x88, 1, 2, 0, Instruction::DEY, AddressingMode::Implicit, &DEY },
-            { 0x89, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x8a, 1, 2, 0, Instruction::TXA, AddressingMode::Implicit, &TXA },
-            { 0x8b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x8c, 3, 4, 0, Instruction::STY, AddressingMode::Absolute, &STY },
-            { 0x8d, 3, 4, 0, Instruction::STA, AddressingMode::Absolute, &STA },
-            { 0x8e, 3, 4, 0, Instruction::STX, AddressingMode::Absolute, &STX },
-            { 0x8f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0x90, 2, 2, 2, Instruction::BCC, AddressingMode::Relative, &BCC },
-            { 0x91, 2, 6, 0, Instruction::STA, AddressingMode::IndirectYIndexed, &STA },
-            { 0x92, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x93, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x94, 2, 4, 0, Instruction::STY, AddressingMode::ZeroPageX, &STY },
-            { 0x95, 2, 4, 0, Instruction::STA, AddressingMode::ZeroPageX, &STA },
-            { 0x96, 2, 4, 0, Instruction::STX, AddressingMode::ZeroPageY, &STX },
-            { 0x97, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x98, 1, 2, 0, Instruction::TYA, AddressingMode::Implicit, &TYA },
-            { 0x99, 3, 5, 0, Instruction::STA, AddressingMode::AbsoluteY, &STA },
-            { 0x9a, 1, 2, 0, Instruction::TXS, AddressingMode::Implicit, &TXS },
-            { 0x9b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x9c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x9d, 3, 5, 0, Instruction::STA, AddressingMode::AbsoluteX, &STA },
-            { 0x9e, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0x9f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0xa0, 2, 2, 0, Instruction::LDY, AddressingMode::Immediate, &LDY },
-            { 0xa1, 2, 6, 0, Instruction::LDA, AddressingMode::XIndexedIndirect, &LDA },
-            { 0xa2, 2, 2, 0, Instruction::LDX, AddressingMode::Immediate, &LDX },
-            { 0xa3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xa4, 2, 3, 0, Instruction::LDY, AddressingMode::ZeroPage, &LDY },
-            { 0xa5, 2, 3, 0, Instruction::LDA, AddressingMode::ZeroPage, &LDA },
-            { 0xa6, 2, 3, 0, Instruction::LDX, AddressingMode::ZeroPage, &LDX },
-            { 0xa7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xa8, 1, 2, 0, Instruction::TAY, AddressingMode::Implicit, &TAY },
-            { 0xa9, 2, 2, 0, Instruction::LDA, AddressingMode::Immediate, &LDA },
-            { 0xaa, 1, 2, 0, Instruction::TAX, AddressingMode::Implicit, &TAX },
-            { 0xab, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xac, 0, 0, 0, Instruction::LDY, AddressingMode::Absolute, &LDY },
-            { 0xad, 3, 4, 0, Instruction::LDA, AddressingMode::Absolute, &LDA },
-            { 0xae, 3, 4, 0, Instruction::LDX, AddressingMode::Absolute, &LDX },
-            { 0xaf, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0xb0, 2, 2, 2, Instruction::BCS, AddressingMode::Relative, &BCS },
-            { 0xb1, 2, 5, 1, Instruction::LDA, AddressingMode::IndirectYIndexed, &LDA },
-            { 0xb2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xb3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xb4, 2, 4, 0, Instruction::LDY, AddressingMode::ZeroPageX, &LDY },
-            { 0xb5, 2, 4, 0, Instruction::LDA, AddressingMode::ZeroPageX, &LDA },
-            { 0xb6, 2, 4, 0, Instruction::LDX, AddressingMode::ZeroPageY, &LDX },
-            { 0xb7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xb8, 1, 2, 0, Instruction::CLV, AddressingMode::Implicit, &CLV },
-            { 0xb9, 3, 4, 1, Instruction::LDA, AddressingMode::AbsoluteY, &LDA },
-            { 0xba, 1, 2, 0, Instruction::TSX, AddressingMode::Implicit, &TSX },
-            { 0xbb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xbc, 3, 4, 1, Instruction::LDY, AddressingMode::AbsoluteX, &LDY },
-            { 0xbd, 3, 4, 1, Instruction::LDA, AddressingMode::AbsoluteX, &LDA },
-            { 0xbe, 3, 4, 1, Instruction::LDX, AddressingMode::AbsoluteY, &LDX },
-            { 0xbf, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0xc0, 2, 2, 0, Instruction::CPY, AddressingMode::Immediate, &CPY },
-            { 0xc1, 2, 6, 0, Instruction::CMP, AddressingMode::XIndexedIndirect, &CMP },
-            { 0xc2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xc3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xc4, 2, 3, 0, Instruction::CPY, AddressingMode::ZeroPage, &CPY },
-            { 0xc5, 2, 3, 0, Instruction::CMP, AddressingMode::ZeroPage, &CMP },
-            { 0xc6, 2, 5, 0, Instruction::DEC, AddressingMode::ZeroPage, &DEC },
-            { 0xc7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xc8, 1, 2, 0, Instruction::INY, AddressingMode::Implicit, &INY },
-            { 0xc9, 2, 2, 0, Instruction::CMP, AddressingMode::Immediate, &CMP },
-            { 0xca, 1, 2, 0, Instruction::DEX, AddressingMode::Implicit, &DEX },
-            { 0xcb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xcc, 2, 4, 0, Instruction::CPY, AddressingMode::Absolute, &CPY },
-            { 0xcd, 3, 4, 0, Instruction::CMP, AddressingMode::Absolute, &CMP },
-            { 0xce, 3, 3, 0, Instruction::DEC, AddressingMode::Absolute, &DEC },
-            { 0xcf, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0xd0, 2, 2, 2, Instruction::BNE, AddressingMode::Relative, &BNE },
-            { 0xd1, 2, 5, 1, Instruction::CMP, AddressingMode::IndirectYIndexed, &CMP },
-            { 0xd2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xd3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xd4, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xd5, 2, 4, 0, Instruction::CMP, AddressingMode::ZeroPageX, &CMP },
-            { 0xd6, 2, 6, 0, Instruction::DEC, AddressingMode::ZeroPageX, &DEC },
-            { 0xd7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xd8, 1, 2, 0, Instruction::CLD, AddressingMode::Implicit, &CLD },
-            { 0xd9, 3, 4, 1, Instruction::CMP, AddressingMode::AbsoluteY, &CMP },
-            { 0xda, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xdb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xdc, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xdd, 3, 4, 1, Instruction::CMP, AddressingMode::AbsoluteX, &CMP },
-            { 0xde, 3, 7, 0, Instruction::DEC, AddressingMode::AbsoluteX, &DEC },
-            { 0xdf, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0xe0, 2, 2, 0, Instruction::CPX, AddressingMode::Immediate, &CPX },
-            { 0xe1, 2, 6, 0, Instruction::SBC, AddressingMode::XIndexedIndirect, &SBC },
-            { 0xe2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xe3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xe4, 2, 3, 0, Instruction::CPX, AddressingMode::ZeroPage, &CPX },
-            { 0xe5, 2, 3, 0, Instruction::SBC, AddressingMode::ZeroPage, &SBC },
-            { 0xe6, 2, 5, 0, Instruction::INC, AddressingMode::ZeroPage, &INC },
-            { 0xe7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xe8, 1, 2, 0, Instruction::INX, AddressingMode::Implicit, &INX },
-            { 0xe9, 2, 2, 0, Instruction::SBC, AddressingMode::Immediate, &SBC },
-            { 0xea, 1, 2, 0, Instruction::NOP, AddressingMode::Implicit, &NOP },
-            { 0xeb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xec, 3, 4, 0, Instruction::CPX, AddressingMode::Absolute, &CPX },
-            { 0xed, 3, 4, 0, Instruction::SBC, AddressingMode::Absolute, &SBC },
-            { 0xee, 3, 6, 0, Instruction::INC, AddressingMode::Absolute, &INC },
-            { 0xef, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-
-            { 0xf0, 2, 2, 2, Instruction::BEQ, AddressingMode::Relative, &BEQ },
-            { 0xf1, 2, 5, 1, Instruction::SBC, AddressingMode::IndirectYIndexed, &SBC },
-            { 0xf2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xf3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xf4, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xf5, 2, 4, 0, Instruction::SBC, AddressingMode::ZeroPageX, &SBC },
-            { 0xf6, 2, 6, 0, Instruction::INC, AddressingMode::ZeroPageX, &INC },
-            { 0xf7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xf8, 1, 2, 0, Instruction::SED, AddressingMode::Implicit, &SED },
-            { 0xf9, 3, 4, 1, Instruction::SBC, AddressingMode::AbsoluteY, &SBC },
-            { 0xfa, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xfb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xfc, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK },
-            { 0xfd, 3, 4, 1, Instruction::SBC, AddressingMode::AbsoluteX, &SBC },
-            { 0xfe, 3, 7, 0, Instruction::INC, AddressingMode::AbsoluteX, &INC },
-            { 0xff, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined, &UNK }
-        };
+        // Op code table and the handler for each instruction, indexed by Instruction.  Defined once in CPU2A03.cpp,
+        // where they are also constant expressions for the fused op code handlers.
+        extern const OpCode opCodes[256];
+        extern const InstructionFnPtr instructionHandlers[Instruction::UNK + 1];
     }
-}
 
+    inline InstructionFnPtr OpCode::handler() const {
+        return InstructionSet::instructionHandlers[instruction];
+    }
+
+    // Inline since it runs on every bus cycle
+    inline void Cpu2a03::synchronizeProcessors() {
+        uint32_t ppuCycles = CpuVariant::ppuClocks / CpuVariant::cpuClocks;
+        // PAL runs an extra PPU cycle every 5th cpu cycle
+        if (CpuVariant::ppuClocks % CpuVariant::cpuClocks != 0) {
+            ppuClockPhase += CpuVariant::ppuClocks % CpuVariant::cpuClocks;
+            if (ppuClockPhase >= CpuVariant::cpuClocks) {
+                ppuClockPhase -= CpuVariant::cpuClocks;
+                ppuCycles++;
+            }
+        }
+
+        if (ppuBatchingEnabled) {
+            pendingPpuCycles += ppuCycles;
+            return;
+        }
+        for (uint32_t i = 0; i < ppuCycles; i++) {
+            ppu->doPpuCycle();
+        }
+    }
+
+    inline void Cpu2a03::catchUpPpu() {
+        if (pendingPpuCycles != 0) {
+            ppu->advance(pendingPpuCycles);
+            pendingPpuCycles = 0;
+        }
+    }
+
+    // Inline so the zero page addressing modes and stack operations skip the call as well
+    inline void Cpu2a03::doZeroPageOperation() {
+        synchronizeProcessors();
+
+        uint16_t address = systemBus.addressBus;
+        if (systemBus.read) {
+            systemBus.dataBus = ram.ram[address];
+        } else {
+            ram.ram[address] = systemBus.dataBus;
+            if (blockCache.isRamCodePage(address)) {
+                blockCache.invalidateRamPage(address);
+            }
+        }
+    }
+
+    inline uint8_t Cpu2a03::readFromZeroPage(uint16_t addr) {
+        systemBus.addressBus = addr;
+        systemBus.read = true;
+        doZeroPageOperation();
+        return systemBus.dataBus;
+    }
+}
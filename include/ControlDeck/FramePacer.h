@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+namespace NES {
+    enum class PacingMode {
+        RealTime,       // the console's own frame rate, 60.0988Hz on NTSC
+        FastForward,    // fastForwardFactor times the frame rate
+        Uncapped,       // as fast as the host runs
+    };
+
+    /**
+    *   Keeps emulated frames (see runFrame) to a steady rate off the host's high resolution clock instead of the
+    *   display's vsync.  Deadlines are counted from when the mode was last set, start + frames * period, so the
+    *   average rate is exact however the waits round.  Falling more than maxFramesBehind frames behind starts over
+    *   from now instead of running the missed frames back to back.
+    *
+    *   Also measures how fast emulation is going, whatever the mode, as a percentage of real time.
+    */
+    class FramePacer {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        // Emulated frames per second for the region the core is built for (CpuVariant)
+        static double getFrameRate();
+
+        void setMode(PacingMode mode, double fastForwardFactor = 1.0);
+        PacingMode getMode() const { return mode; }
+        double getFastForwardFactor() const { return fastForwardFactor; }
+
+        /**
+        *   An emulated frame finished at now.  Returns how long to wait before starting the next one, zero when
+        *   that's already due or the pacer is uncapped.
+        */
+        Clock::duration frameDone(Clock::time_point now);
+        // frameDone with the time now, then wait it out
+        void pace();
+
+        // Percent of real time over the last speedWindow, 100 while keeping up with RealTime
+        double getSpeed() const { return speed; }
+
+        // The OS sleep can overshoot by a scheduler tick, so the last part of each wait spins on the clock
+        Clock::duration spinTime{ std::chrono::milliseconds(2) };
+        Clock::duration speedWindow{ std::chrono::milliseconds(500) };
+        uint32_t maxFramesBehind{ 4 };
+    private:
+        void restart(Clock::time_point now);
+
+        PacingMode mode{ PacingMode::RealTime };
+        double fastForwardFactor{ 1.0 };
+        bool started{ false };
+        Clock::time_point start{};
+        uint64_t frames{ 0 };
+
+        bool measuring{ false };
+        Clock::time_point speedWindowStart{};
+        uint32_t speedWindowFrames{ 0 };
+        double speed{ 0.0 };
+    };
+}
@@ -5,6 +5,8 @@
 #include "../Render.h"
 
 namespace NES {
+    class InterruptController;
+
     // Starting cycle in scan line state
     enum class ScanLineState {
         Idle = 0,                 //0
@@ -14,8 +16,8 @@ namespace NES {
         NameTableByteFetch = 337, //337-340
     };
 
-    // Frame rendering state transitions between scan lines for a total of 262 scan lines per frame, 240 of which
-    // are visible.
+    // Frame rendering state transitions between scan lines for a total of 262 scan lines per frame on NTSC (312 on
+    // PAL and Dendy, see CpuVariant), 240 of which are visible.  The values are the NTSC lines.
     enum class RenderState {
         VisibleScanLines = 0,       //0-239
         PostRenderScanLine = 240,   //240
@@ -36,18 +38,56 @@ namespace NES {
         static const uint16_t nameTableBoundary = 0x3f00;
         uint8_t doMemoryOperation(uint16_t address, uint8_t write, bool read = true);
         uint8_t getByte(uint16_t address) { return doMemoryOperation(address, 0); }
+        /**
+        *   8 colour indices (0-3) for row (0-7) of a CHR tile, left to right or flipped horizontally.  table is the
+        *   pattern table, 0 at $0000 and 1 at $1000.  Decoded through the mapper once and then looked up (see
+        *   ChrTileCache) until the tile is written or the mapper switches CHR banks.
+        */
+        const uint8_t *getDecodedTileRow(uint8_t table, uint8_t tile, uint8_t row, bool flipped = false);
         bool isAddressInPaletteRange(uint16_t address);
 
         ///////////////////////////////////////////////////////////////////////
         // CPU Memory-mapped register read/write
         uint8_t readRegister(PPURegister ppuRegister);
         void writeRegister(PPURegister ppuRegister, uint8_t val);
+        /**
+        *   DATA ($2007) writes made while the PPU isn't rendering are queued and copied into vram together here.
+        *   Runs before any other register access, before the PPU fetches from vram again and before a cartridge
+        *   write can remap CHR or the name tables.  Writes during rendering go straight to vram.
+        */
+        void flushDataWrites();
+        /**
+        *   256 OAMDATA writes in one go, as OAM DMA ($4014) makes them.  Only the same as the separate writes while
+        *   the PPU doesn't touch OAM for the whole transfer, see getOamIdleCycles.
+        */
+        void writeOamDma(const uint8_t *data);
+        // PPU cycles from now on which neither reset OAMADDR nor drop OAMDATA writes (post-render and vblank lines)
+        uint32_t getOamIdleCycles() const;
         // scanline-triggered resets of various register components
         void doRegisterUpdates();
         RenderState getRenderState();
 
-        // CPU poll API for NMI.  Only ever active if PPU reaches vblank and PPUCTRL bit 7 set (generate NMI)
-        bool pollNMI();
+        /**
+        *   Number of PPU cycles which can run before the next cycle that can change the NMI line (vblank set/clear).
+        *   Lets the CPU run ahead of the PPU without missing an NMI.
+        */
+        uint32_t getCyclesUntilNmiEvent() const;
+        // PPU cycles run since power up
+        uint64_t getCycle() const { return cycle; }
+        // Frames finished since power up, counted as vblank starts: ppu.renderBuffer holds the whole picture then
+        uint64_t getFrameCount() const { return frameCount; }
+        // PPU cycles until the next frame is finished (the cycle setting vblank has run), a whole frame right after one
+        uint32_t getCyclesUntilFrameEnd() const;
+        // Run ppuCycles PPU cycles back to back, used when the CPU skips ahead over an idle loop or catches the PPU
+        // up after running ahead of it (Cpu2a03::ppuBatchingEnabled).  Visible scan lines the batch covers from
+        // cycle 0 are drawn a line at a time (renderScanLine), the rest dot by dot.
+        void advance(uint32_t ppuCycles);
+        /**
+        *   Take on other's state (registers, timing, vram, OAM, palette and pending DATA writes) for running a copy
+        *   alongside it, as the JIT's differential mode does.  The render buffer, the cartridge and interrupt controller
+        *   this PPU is connected to stay as they are, and decoded CHR tiles are dropped rather than copied.
+        */
+        void copyState(const Ppu2C02 &other);
 
         ////////////////////////////////////////////
         // Registers and memory components
@@ -63,12 +103,15 @@ namespace NES {
 
         Cartridge *cartridge;
         RenderBuffer renderBuffer;
+        // NMI output, driven while vblank and PPUCTRL bit 7 (generate NMI) are both set
+        InterruptController *interrupts{ nullptr };
 
         bool disabled{ false }; // for easier testing to cause goPpuCycle to nop
     private:
         // Rendering state
-        uint16_t curScanLine{ 0 };		// Active scan line (of 262 total)
-        uint32_t cycle{ 0 };			// Overall cycle counter
+        uint16_t curScanLine{ 0 };		// Active scan line (of CpuVariant::scanLines, 262 on NTSC)
+        uint64_t cycle{ 0 };			// Overall cycle counter
+        uint64_t frameCount{ 0 };
         uint16_t scanLineCycle{ 0 };    // one cycle per pixel (35
         uint16_t ppuAddr;
         uint8_t ppuData;
@@ -79,7 +122,23 @@ namespace NES {
         uint8_t patternR{ 0 };  // current low bit pattern table entry
         uint8_t attrTableEntry{ 0 };
 
-        bool flagNmi{ false };
+        // Pending DATA writes, applied to dataWriteAddress, dataWriteAddress + dataWriteIncrement, ...
+        static const uint16_t dataWriteQueueSize = 0x400;
+        uint8_t dataWrites[dataWriteQueueSize];
+        uint16_t dataWriteCount{ 0 };
+        uint16_t dataWriteAddress{ 0 };
+        uint8_t dataWriteIncrement{ 1 };
+
+        ChrTileCache chrTiles;
+
+        // Drive the NMI line from the current vblank flag and PPUCTRL, called wherever either changes
+        void updateNmiLine();
+        // Rendering enabled and on a scan line which fetches from vram (visible and pre-render)
+        bool isRendering();
+        // The 1k of name table ram mapped to a $2000-$3eff address after mirroring
+        uint8_t *getNameTable(uint16_t address);
+        // Cycles from the current one on where doPpuCycle would only move the counters (post-render and vblank lines)
+        uint32_t getIdleCycles();
         /**
         *   Iterate primary OAM to determine which objects are in Y-range for the NEXT scan line from highest priority (0)
         *   to lowest.  Set sprite overflow flag in status register if more than 8 are found.
@@ -113,6 +172,17 @@ namespace NES {
 
         void fetchNameTableByte();
 
+        // Load the background shift registers from the last tile fetched, every 8 cycles from handleScrolling
+        void reloadBackgroundShifters();
+        // The name table, attribute and two pattern table reads for one tile, in doPpuCycle's order
+        void fetchTile();
+        /**
+        *   All 341 cycles of a visible scan line in one go, from cycle 0.  Makes the same reads and leaves the same
+        *   state and pixels as doPpuCycle would, without its per dot dispatch or putPixel.  Only valid when nothing
+        *   writes a PPU register before the line ends, which advance guarantees.
+        */
+        void renderScanLine();
+
         bool isDmaActive;
     };
 }
\ No newline at end of file
@@ -232,6 +232,8 @@ namespace NES{
         // byte 3
         uint8_t spriteLeftX{ 0 };
     };
+    // OAM is written as bytes through OAMDATA and DMA
+    static_assert(sizeof(ObjectAttributeMemory) == 4, "ObjectAttributeMemory must be the 4 packed OAM bytes");
 
     /**
     *   Each color is an 8 bit index into the global color palette (64 color entries).
@@ -282,6 +284,34 @@ namespace NES{
         PatternTableEntry patterns[256]{};
     };
 
+    /**
+    *   CHR tiles decoded from their two bit planes into chunky 2-bit colour indices, a byte per pixel and 8 bytes a
+    *   row, each row both as stored and flipped horizontally (sprite attribute bit 6).  A tile is decoded the first
+    *   time it's asked for (Ppu2C02::getDecodedTileRow) and kept until a CHR write to it (CHR-RAM) or a CHR bank switch
+    *   (MemoryManagementController::chrBankState) drops it.
+    */
+    struct ChrTileCache {
+        static const uint16_t tileCount = 512;  // both pattern tables, $0000-$1fff
+        static const uint8_t bytesPerTile = sizeof(PatternTableEntry);
+
+        struct DecodedTile {
+            uint8_t rows[8][8];
+            uint8_t flippedRows[8][8];
+        };
+
+        // bit 7 of a plane byte is the leftmost pixel
+        static void decode(const uint8_t *planes, DecodedTile &tile);
+        // drop every tile
+        void invalidate();
+        // drop the tile a CHR address falls in
+        void invalidateAddress(uint16_t address) { valid[(address % 0x2000) / bytesPerTile] = false; }
+
+        DecodedTile tiles[tileCount];
+        bool valid[tileCount]{};
+        // the mapper's chrBankState when the tiles were decoded
+        uint32_t chrBankState{ 0 };
+    };
+
     /**
     *  Background data attribute table
     *   Each tileGroup byte represents a 4x4 set of tiles by containing the upper 2 bits of each tile's color
@@ -304,6 +334,8 @@ namespace NES{
         uint8_t nameTable[32 * 30]{};
         AttributeTable attributeTable{};
     };
+    // The attribute table follows the name table directly so a name table is the 1k of vram it's mapped to
+    static_assert(sizeof(NameTable) == 0x400, "NameTable must be 1k of packed vram");
 
     /**
     *   Background tile context for a given line in the PPU.
@@ -375,7 +407,9 @@ namespace NES{
         void onControlWrite(PPURegisters &registers);
         void onScrollWrite(PPURegisters &registers);
         void onAddressWrite(PPURegisters &registers);
-        void onDataAccess(PPURegisters &registers);
+        // rendering: rendering is enabled and the PPU is on a visible or the pre-render scan line, when the vram
+        // address is stepped by the coarse X / Y increments instead of PPUCTRL's 1 or 32
+        void onDataAccess(PPURegisters &registers, bool rendering);
         void onStatusRead(PPURegisters &registers);
 
         // General bitmask accessors for VRAM
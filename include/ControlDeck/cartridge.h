@@ -59,22 +59,52 @@ namespace NES {
 
 
 
+    // Mappers the emulator has a class for, see MemoryManagementController::type
+    enum class MapperType : uint8_t {
+        Other,      // anything else, called through the vtable
+        NRom,
+    };
+
     //// function pointer declaration for memory mapper cartridge handler.
     //typedef void  (*MmcHandler)(SystemBus &bus);
-    // TODO can I avoid virtual here?
     class MemoryManagementController {
     public:
         virtual void doMemoryOperation(SystemBus &bus, Cartridge &cart) = 0;
         virtual uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) = 0;
+
+        // Identifies the PRG banks currently mapped into CPU space.  Mappers which switch banks must change this
+        // whenever the layout changes so that decoded code from the old banks is dropped by the CPU.
+        uint32_t prgBankState{ 0 };
+        // The same for the CHR banks mapped into PPU space, so tiles the PPU has decoded (ChrTileCache) are dropped.
+        // Also changed when CHR-RAM is written some way other than through the PPU.
+        uint32_t chrBankState{ 0 };
+
+        /**
+        *   CPU pages (indexed by address >> MemoryPage::pageBits) the mapper maps straight onto PRG-ROM or PRG-RAM.  The
+        *   CPU reads and writes those without calling doMemoryOperation, so pages holding mapper registers or anything
+        *   else with side effects must stay nullptr.  Mappers which switch banks update them along with prgBankState;
+        *   the CPU picks the new pages up after the mapper write.
+        */
+        uint8_t *prgReadPages[MemoryPage::pageCount]{};
+        uint8_t *prgWritePages[MemoryPage::pageCount]{};
+
+        // Fill in prgReadPages/prgWritePages for the banks mapped in right now.  Called when the CPU first sees the mapper.
+        // The default maps nothing, so every access goes through doMemoryOperation.
+        virtual void mapPrgPages(Cartridge & /*cart*/) {}
+
+        // Set by the (final) mapper classes below so mapperMemoryOperation and mapperChrMemoryOperation can call them
+        // directly
+        MapperType type{ MapperType::Other };
     };
 
     /*
     Simplest MMC.  All banks fixed.
     https://wiki.nesdev.com/w/index.php/NROM
     */
-    class NRom : public MemoryManagementController {
+    class NRom final : public MemoryManagementController {
     public:
         NRom(bool is256) {
+            type = MapperType::NRom;
             if (is256) {
                 secondBankRomIndex = 1;
             }
@@ -94,6 +124,15 @@ namespace NES {
             }
         }
 
+        void mapPrgPages(Cartridge &cart) override {
+            // writes stay with doMemoryOperation
+            const size_t bankPages = prgRomBankSize >> MemoryPage::pageBits;
+            for (size_t i = 0; i < bankPages; i++) {
+                prgReadPages[(0x8000 >> MemoryPage::pageBits) + i] = &cart.prgRom[0].rom[i << MemoryPage::pageBits];
+                prgReadPages[(0xc000 >> MemoryPage::pageBits) + i] = &cart.prgRom[secondBankRomIndex].rom[i << MemoryPage::pageBits];
+            }
+        }
+
         uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
             DBG_ASSERT(address < 0x2000, "expected PPU address below 0x2000 in NROM mapper but got %d", address);
             // Skip any write action.
@@ -103,4 +142,29 @@ namespace NES {
         // default to mirror first bank.  if 256 we switch this to reflect the presence of a second PRG bank
         int secondBankRomIndex{ 0 };
     };
-}
\ No newline at end of file
+
+    /**
+    *   cart.mmc->doMemoryOperation and cart.mmc->doCHRMemoryOperationOperation without the virtual call.  The mapper
+    *   is picked once when the cartridge is loaded (generateMMCFromINesMemoryMapperNumber) and every access after
+    *   that takes the same case, so the switch costs a predicted branch and the mapper's handler is inlined.
+    */
+    inline void mapperMemoryOperation(SystemBus &bus, Cartridge &cart) {
+        switch (cart.mmc->type) {
+        case MapperType::NRom:
+            static_cast<NRom *>(cart.mmc)->doMemoryOperation(bus, cart);
+            break;
+        default:
+            cart.mmc->doMemoryOperation(bus, cart);
+            break;
+        }
+    }
+
+    inline uint8_t mapperChrMemoryOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) {
+        switch (cart.mmc->type) {
+        case MapperType::NRom:
+            return static_cast<NRom *>(cart.mmc)->doCHRMemoryOperationOperation(cart, address, write, isRead);
+        default:
+            return cart.mmc->doCHRMemoryOperationOperation(cart, address, write, isRead);
+        }
+    }
+}
@@ -4,6 +4,8 @@
 #include "PPU\PPU2C02.h"
 #include "cartridge.h"
 #include "CPU/SystemComponents.h"
+#include "CPU/Jit.h"
+#include "CPU/StaticRecompiler.h"
 
 #include "PPU/PPUComponents.h"
 #include "Render.h"
@@ -13,9 +15,32 @@ namespace NES {
         Cpu2a03 cpu;
         Ppu2C02 ppu;
         Cartridge cart;
+
+        // Run hot PRG-ROM code through the recompiler (x86-64 only, interpreter otherwise)
+        bool useJit{ false };
+        Jit jit{ cpu };
+
+        // Code generated ahead of time by ControlDeckRecompiler, used when code is set
+        RecompiledProgram recompiled{ cpu };
+    };
+
+    // What one runFrame call ran
+    struct FrameStats {
+        uint64_t frame{ 0 };            // Ppu2C02::getFrameCount of the frame finished
+        uint32_t cycles{ 0 };           // cpu cycles since the last runFrame returned
+        uint64_t instructions{ 0 };
+        bool lag{ false };              // the game didn't read the controllers
     };
 
     void initNes(char * nesFile, NesControlDeck &nesControlDeck);
-    DebugState nesLoop(NesControlDeck &nes, int numInstructions = -1);
     DebugState step(NesControlDeck &nes);
+    /**
+    *   Run until the PPU finishes the next frame (sets vblank, ppu.renderBuffer holds the whole picture), returning at
+    *   the first instruction boundary after that.  The cycles an instruction runs past the end of the frame are part
+    *   of the next frame's, so frames average out to the PPU's frame length.
+    *
+    *   The interpreter path goes through Cpu2a03::runCycles.  With the JIT, recompiled code or the block cache (which
+    *   runCycles doesn't use) it's a step loop instead.
+    */
+    FrameStats runFrame(NesControlDeck &nes);
 }
\ No newline at end of file
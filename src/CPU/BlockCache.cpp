@@ -0,0 +1,93 @@
+#include <ControlDeck/CPU/BlockCache.h>
+
+namespace NES {
+    const DecodedInstruction * BlockCache::next(uint16_t address, uint32_t bankState) {
+        if (entries.empty()) {
+            misses++;
+            return nullptr;
+        }
+
+        if (activeEntry >= 0) {
+            CachedBlock &block = entries[activeEntry];
+            if (block.valid && activeInstruction < block.numInstructions &&
+                block.instructions[activeInstruction].address == address) {
+                hits++;
+                return &block.instructions[activeInstruction++];
+            }
+        }
+
+        size_t index = entryIndex(address);
+        CachedBlock &block = entries[index];
+        if (block.valid && block.startAddress == address && block.bankState == bankState) {
+            hits++;
+            activeEntry = (int)index;
+            activeInstruction = 1;
+            return &block.instructions[0];
+        }
+
+        misses++;
+        activeEntry = -1;
+        return nullptr;
+    }
+
+    CachedBlock * BlockCache::allocate(uint16_t address, uint32_t bankState) {
+        if (entries.empty()) {
+            entries.resize(numEntries);
+        }
+
+        CachedBlock &block = entries[entryIndex(address)];
+        block.valid = false;
+        block.startAddress = address;
+        block.endAddress = address;
+        block.bankState = bankState;
+        block.numInstructions = 0;
+        return &block;
+    }
+
+    void BlockCache::commit(CachedBlock *block) {
+        if (block->numInstructions == 0) {
+            return;
+        }
+        block->valid = true;
+
+        if (block->startAddress < 0x2000) {
+            // A block is at most 48 bytes so it can only touch the page it starts in and the following one.
+            ramCodePages[(block->startAddress % 0x800) / ramPageSize] = true;
+            ramCodePages[((block->endAddress - 1) % 0x800) / ramPageSize] = true;
+        }
+    }
+
+    void BlockCache::invalidateRamPage(size_t ramAddress) {
+        size_t page = ramAddress / ramPageSize;
+        if (!ramCodePages[page]) {
+            return;
+        }
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            CachedBlock &block = entries[i];
+            if (!block.valid || block.startAddress >= 0x2000) {
+                continue;
+            }
+            size_t firstPage = (block.startAddress % 0x800) / ramPageSize;
+            size_t lastPage = ((block.endAddress - 1) % 0x800) / ramPageSize;
+            if (page == firstPage || page == lastPage) {
+                block.valid = false;
+                invalidations++;
+            }
+        }
+        ramCodePages[page] = false;
+    }
+
+    void BlockCache::flush() {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].valid) {
+                entries[i].valid = false;
+                invalidations++;
+            }
+        }
+        for (size_t i = 0; i < numRamPages; i++) {
+            ramCodePages[i] = false;
+        }
+        activeEntry = -1;
+    }
+}
@@ -5,6 +5,9 @@
 
 namespace NES {
     Cpu2a03::Cpu2a03(Ppu2C02 *ppu, Cartridge *cartridge) : ppu(ppu), cartridge(cartridge) {
+        if (ppu != nullptr) {
+            ppu->interrupts = &interrupts;
+        }
     }
 
     const OpCode * Cpu2a03::fetchOpCode() {
@@ -19,12 +22,20 @@ namespace NES {
     DebugState Cpu2a03::processInstruction() {
         DebugState debugState = DebugState();
         debugState.dmaBefore = dmaData;
-        uint8_t cyclesTaken = 0;
-        if (dmaData.isActive) {
-            if (dmaData.cycleCounter == 0  || (dmaData.cycleCounter == 1 && cycle & 1)) {
-                // do nothing, skip the first cycle and the second if it occurs on an odd cycle.
-                // TODO hard to tell from documentation if the skip happens if the start cycle is odd or if the second cycle is odd
-            } else if ((dmaData.cycleCounter & 1) == 0) {
+        uint32_t cyclesTaken = 0;
+        if (dmaData.isActive && bulkOamDmaEnabled && dmaData.cycleCounter == 0) {
+            cyclesTaken = runBulkOamDma();
+        }
+        if (cyclesTaken != 0) {
+            debugState.dmaAfter = dmaData;
+        } else if (dmaData.isActive) {
+            // skip the first cycle and the second if it occurs on an odd cycle, so the reads start on an even cycle
+            // TODO hard to tell from documentation if the skip happens if the start cycle is odd or if the second cycle is odd
+            uint32_t alignmentCycles = 1 + ((cycle - dmaData.cycleCounter + 1) & 1);
+            if (dmaData.cycleCounter < alignmentCycles) {
+                // no bus access, but the PPU keeps running
+                synchronizeProcessors();
+            } else if (((dmaData.cycleCounter - alignmentCycles) & 1) == 0) {
                 // read mem
                 systemBus.addressBus = (dmaData.baseAddress << 8) + dmaData.bytesWritten;
                 systemBus.read = true;
@@ -46,49 +57,332 @@ namespace NES {
             debugState.dmaAfter = dmaData;
             cyclesTaken = 1;
         } else {
-            if (ppu->pollNMI()) {
-                printf("NMI\n");
-                registers.interruptStatus = InterruptType::INT_NMI;
+            // One test of the pending bits unless a line has changed.  A held IRQ stays pending while masked.
+            InterruptType interruptType = InterruptType::INT_NONE;
+            if (interrupts.isPending()) {
+                interruptType = interrupts.acknowledge(registers.flagSet(ProcessorStatus::InterruptDisable));
             }
-            // TODO add irq polling?  check interrupt disable flag to ignore IRQ if 1
 
-            if (registers.interruptStatus != InterruptType::INT_NONE) {
-                printf("Interrupt being handled for interruptStatus: %d\n", registers.interruptStatus);
-                interrupt(registers.interruptStatus);
+            if (interruptType != InterruptType::INT_NONE) {
+                interrupt(interruptType);
             } else {
                 //            DBG_ASSERT(!registers.flagSet(ProcessorStatus::BreakCommand), "BRK probably shouldn't be set since it isn't used much in nes game ......");
-                // Read the next op code from memory
-                const OpCode *opCode = fetchOpCode();
+                if (flagLivenessEnabled && !debug) {
+                    liveFlags = flagLiveness.getLiveFlags(*this, registers.programCounter);
+                }
+                // Read the next op code from memory, or take it already decoded from the block cache
+                const DecodedInstruction *decoded = blockCacheEnabled ? fetchDecodedInstruction() : nullptr;
+                const OpCode *opCode = decoded != nullptr ? decoded->opCode : fetchOpCode();
                 debugState.opCode = opCode;
                 debugState.registersBefore = registers;
                 debugState.systemBusBefore = systemBus;
                 DBG_ASSERT(opCode->instruction != Instruction::UNK, "Unknown instruction encountered %02x at addr %04x", opCode->opCode, registers.programCounter);
 
 
-                // Set up system bus to contain relevant memory data for a particular instruction.
-                OpCodeArgs opCodeArgs = handleAddressingMode(opCode->addressingMode);
-                debugState.opCodeArgs = opCodeArgs;
-
-                // Call the instruction handler
-                uint8_t branchCycles = opCode->instructionHandler(*opCode, *this);
+                if (idleLoopSkipEnabled && !debug && decoded != nullptr && decoded->idleLoopLength != 0) {
+                    uint32_t instructionCount = 0;
+                    cyclesTaken += runIdleLoop(decoded, instructionCount);
+                    // only the real iteration moved through the block
+                    uint32_t iterationInstructions = instructionCount < decoded->idleLoopLength ? instructionCount : decoded->idleLoopLength;
+                    blockCache.skip((uint8_t)(iterationInstructions - 1));
+                    debugState.instructionCount = instructionCount;
+                } else if (superInstructionsEnabled && !debug && decoded != nullptr && decoded->superInstruction != nullptr) {
+                    // The whole sequence, stopping early at an instruction boundary where DMA or an NMI is due
+                    uint8_t instructionCount = 1;
+                    cyclesTaken += decoded->superInstruction(*this, decoded, instructionCount);
+                    blockCache.skip(instructionCount - 1);
+                    blockCache.superInstructions++;
+                    debugState.instructionCount = instructionCount;
+                } else {
+                    OpCodeArgs opCodeArgs = OpCodeArgs();
+                    uint8_t branchCycles = 0;
+                    if (fusedDispatchEnabled) {
+                        // Operands are served from the decoded instruction if there is one
+                        decodedInstruction = decoded;
+                        branchCycles = fusedOpCodes[opCode->opCode](*this, opCodeArgs);
+                        decodedInstruction = nullptr;
+                    } else {
+                        // Set up system bus to contain relevant memory data for a particular instruction.
+                        opCodeArgs = decoded != nullptr ? handleDecodedAddressingMode(*decoded) : handleAddressingMode(opCode->addressingMode);
+
+                        // Call the instruction handler
+                        branchCycles = opCode->handler()(*opCode, *this);
+                    }
+                    debugState.opCodeArgs = opCodeArgs;
+                    cyclesTaken += opCode->cycles + branchCycles + opCodeArgs.pagingCycles;
+                }
 
                 debugState.registersAfter = registers;
                 debugState.systemBusAfter = systemBus;
 
-                cyclesTaken += opCode->cycles + branchCycles + opCodeArgs.pagingCycles;
-
                 if (debug) {
-                   // debugState.print();
+                    debugState.print(debugOutputFile);
                 }
-                debugState.print(debugOutputFile);
+                // executeInstruction and runCycles compute every flag
+                liveFlags = FlagLiveness::allFlags;
+                instructionsExecuted += debugState.instructionCount;
             }
         } 
-        // clear interrupt source flag set by hardware pins if any.
-        registers.interruptStatus = InterruptType::INT_NONE;
         cycle += cyclesTaken;
+        if (!lazyPpuEnabled) {
+            catchUpPpu();
+        } else if (cycle >= nextEventCycle) {
+            // DMA is picked up from dmaData at the next instruction, the deadline only had to get us here
+            scheduler.cancel(SchedulerEvent::Dma);
+            scheduleInterruptChecks();
+        }
         return debugState;
     }
 
+    uint32_t Cpu2a03::runBulkOamDma() {
+        uint16_t source = dmaData.baseAddress << 8;
+        if (!BlockCache::isCacheableAddress(source)) {
+            // PPU/APU registers or cartridge space where a read can have side effects
+            return 0;
+        }
+
+        // a dummy cycle, one more to line up on an even cycle, then a read and a write per byte
+        uint32_t cyclesTaken = 1 + ((cycle + 1) & 1) + 512;
+        uint32_t ppuCycles = cyclesTaken * (CpuVariant::ppuClocks / CpuVariant::cpuClocks);
+        uint32_t ppuClockPhaseAfter = ppuClockPhase;
+        if (CpuVariant::ppuClocks % CpuVariant::cpuClocks != 0) {
+            ppuClockPhaseAfter += cyclesTaken * (CpuVariant::ppuClocks % CpuVariant::cpuClocks);
+            ppuCycles += ppuClockPhaseAfter / CpuVariant::cpuClocks;
+            ppuClockPhaseAfter %= CpuVariant::cpuClocks;
+        }
+        catchUpPpu();
+        if (ppu->getOamIdleCycles() < ppuCycles) {
+            return 0;
+        }
+
+        uint8_t page[256];
+        if (source < 0x2000) {
+            memcpy(page, &ram.ram[source % SystemRam::systemRAMBytes], sizeof(page));
+        } else {
+            for (uint16_t i = 0; i < sizeof(page); i++) {
+                page[i] = peekCodeByte(source + i);
+            }
+        }
+        ppu->writeOamDma(page);
+
+        // the bus is left as the last write put it
+        systemBus.addressBus = 0x2004;
+        systemBus.dataBus = page[sizeof(page) - 1];
+        systemBus.read = false;
+        dmaData.curByteToWrite = page[sizeof(page) - 1];
+        dmaData.bytesWritten = sizeof(page);
+        dmaData.cycleCounter = (uint16_t)cyclesTaken;
+        dmaData.isActive = false;
+
+        ppuClockPhase = ppuClockPhaseAfter;
+        pendingPpuCycles += ppuCycles;
+        return cyclesTaken;
+    }
+
+    const DecodedInstruction * Cpu2a03::fetchDecodedInstruction() {
+        uint16_t address = registers.programCounter;
+        if (!BlockCache::isCacheableAddress(address)) {
+            return nullptr;
+        }
+
+        uint32_t bankState = getPrgBankState();
+        if (bankState != blockCacheBankState) {
+            // Everything decoded from the old banks is stale.  Take the regular fetch path for this instruction.
+            blockCache.flush();
+            blockCacheBankState = bankState;
+            return nullptr;
+        }
+
+        const DecodedInstruction *decoded = blockCache.next(address, bankState);
+        if (decoded == nullptr) {
+            decodeBlock(address, bankState);
+            decoded = blockCache.next(address, bankState);
+            if (decoded == nullptr) {
+                return nullptr;
+            }
+        }
+
+        fetchDecodedOpCode(*decoded);
+        return decoded;
+    }
+
+    // Op code fetch cycle for an instruction decoded ahead of time.  Operand fetch cycles are charged by readOperand.
+    void Cpu2a03::fetchDecodedOpCode(const DecodedInstruction &decoded) {
+        synchronizeProcessors();
+        systemBus.addressBus = registers.programCounter;
+        systemBus.read = true;
+        systemBus.dataBus = decoded.opCode->opCode;
+        registers.programCounter++;
+    }
+
+    // Same bus activity as handleAddressingMode but with the mode resolved and operands pre-fetched
+    OpCodeArgs Cpu2a03::handleDecodedAddressingMode(const DecodedInstruction &decoded) {
+        OpCodeArgs opCodeArgs = OpCodeArgs();
+        if (decoded.addressingStep != nullptr) {
+            decodedInstruction = &decoded;
+            (this->*decoded.addressingStep)(opCodeArgs);
+            registers.programCounter += addressingModeProgramCounterDelta[decoded.opCode->addressingMode];
+            decodedInstruction = nullptr;
+        }
+        return opCodeArgs;
+    }
+
+    uint8_t Cpu2a03::executeInstruction(const OpCode &opCode, uint8_t operand0, uint8_t operand1) {
+        DecodedInstruction decoded;
+        decoded.opCode = &opCode;
+        decoded.addressingStep = getAddressingStep(opCode.addressingMode);
+        decoded.address = registers.programCounter;
+        decoded.operands[0] = operand0;
+        decoded.operands[1] = operand1;
+
+        fetchDecodedOpCode(decoded);
+        OpCodeArgs opCodeArgs = handleDecodedAddressingMode(decoded);
+        uint8_t branchCycles = opCode.handler()(opCode, *this);
+
+        catchUpPpu();
+        uint8_t cyclesTaken = opCode.cycles + branchCycles + opCodeArgs.pagingCycles;
+        cycle += cyclesTaken;
+        return cyclesTaken;
+    }
+
+    AddressingStepFnPtr Cpu2a03::getAddressingStep(AddressingMode addressingMode) {
+        static const AddressingStepFnPtr addressingSteps[14] = {
+            nullptr,                                // Undefined
+            nullptr,                                // Implicit
+            nullptr,                                // Accumulator
+            &Cpu2a03::getImmediateAddress,
+            &Cpu2a03::getZeroPageAddress,
+            &Cpu2a03::getXIndexedZeroPageAddress,
+            &Cpu2a03::getYIndexedZeroPageAddress,
+            &Cpu2a03::getRelativeAddress,
+            &Cpu2a03::getAbsoluateAddress,
+            &Cpu2a03::getXIndexedAbsoluteAddress,
+            &Cpu2a03::getYIndexedAbsoluteAddress,
+            &Cpu2a03::getIndirectAddress,
+            &Cpu2a03::getXIndexedIndirectAddress,
+            &Cpu2a03::getIndirectYIndexedAddress,
+        };
+        return addressingSteps[addressingMode];
+    }
+
+    /**
+    *   Decode instructions starting at address up to and including the first one which can change the program counter
+    *   through something other than sequential execution (branch, jump, return, interrupt).
+    */
+    CachedBlock * Cpu2a03::decodeBlock(uint16_t address, uint32_t bankState) {
+        CachedBlock *block = blockCache.allocate(address, bankState);
+        uint32_t pc = address;
+        bool inRam = address < 0x2000;
+        while (block->numInstructions < CachedBlock::maxInstructions) {
+            const OpCode *opCode = &InstructionSet::opCodes[peekCodeByte((uint16_t)pc)];
+            if (opCode->instruction == Instruction::UNK) {
+                // leave it to the regular path to report
+                break;
+            }
+
+            // Every byte of the instruction has to come from the same cacheable region
+            uint32_t length = 1 + addressingModeProgramCounterDelta[opCode->addressingMode];
+            uint32_t last = pc + length - 1;
+            if (last > 0xffff || !BlockCache::isCacheableAddress((uint16_t)last) || (last < 0x2000) != inRam) {
+                break;
+            }
+
+            DecodedInstruction &decoded = block->instructions[block->numInstructions++];
+            decoded.opCode = opCode;
+            decoded.addressingStep = getAddressingStep(opCode->addressingMode);
+            decoded.address = (uint16_t)pc;
+            decoded.superInstruction = nullptr;
+            decoded.idleLoopLength = 0;
+            for (uint32_t i = 1; i < length; i++) {
+                decoded.operands[i - 1] = peekCodeByte((uint16_t)(pc + i));
+            }
+            pc += length;
+
+            Instruction instruction = opCode->instruction;
+            if (opCode->addressingMode == AddressingMode::Relative ||
+                instruction == Instruction::JMP || instruction == Instruction::JSR ||
+                instruction == Instruction::RTS || instruction == Instruction::RTI ||
+                instruction == Instruction::BRK) {
+                break;
+            }
+        }
+
+        block->endAddress = (uint16_t)pc;
+        findSuperInstructions(*block);
+        findIdleLoop(*block);
+        blockCache.commit(block);
+        return block;
+    }
+
+    uint8_t Cpu2a03::peekCodeByte(uint16_t address) {
+        if (address < 0x2000) {
+            return ram.ram[address % 0x800];
+        }
+        const MemoryPage &page = memoryPages[address >> MemoryPage::pageBits];
+        if (page.read != nullptr) {
+            return page.read[address & MemoryPage::pageMask];
+        }
+
+        SystemBus bus;
+        bus.addressBus = address;
+        bus.read = true;
+        mapperMemoryOperation(bus, *cartridge);
+        return bus.dataBus;
+    }
+
+    uint32_t Cpu2a03::getPrgBankState() {
+        if (cartridge == nullptr || cartridge->mmc == nullptr) {
+            return 0;
+        }
+        return cartridge->mmc->prgBankState;
+    }
+
+    void Cpu2a03::scheduleEvent(SchedulerEvent event, uint64_t time) {
+        scheduler.schedule(event, time);
+        uint64_t next = scheduler.getNextDeadline();
+        nextEventCycle = (next + CpuVariant::masterClocksPerCpuCycle - 1) / CpuVariant::masterClocksPerCpuCycle;
+    }
+
+    void Cpu2a03::cancelEvent(SchedulerEvent event) {
+        scheduler.cancel(event);
+        uint64_t next = scheduler.getNextDeadline();
+        nextEventCycle = next == Scheduler::never ? next :
+            (next + CpuVariant::masterClocksPerCpuCycle - 1) / CpuVariant::masterClocksPerCpuCycle;
+    }
+
+    void Cpu2a03::scheduleInterruptChecks() {
+        catchUpPpu();
+        uint64_t now = getMasterClock();
+        if (dmaData.isActive || interrupts.isPending()) {
+            // including an IRQ held while masked, which CLI/PLP/RTI can let through at any instruction
+            scheduleEvent(SchedulerEvent::Poll, now);
+        } else {
+            cancelEvent(SchedulerEvent::Poll);
+        }
+
+        uint32_t ppuCycles = ppu != nullptr ? ppu->getCyclesUntilNmiEvent() : 0xffffffff;
+        if (ppuCycles == 0xffffffff) {
+            cancelEvent(SchedulerEvent::Nmi);
+        } else {
+            // A cpu cycle early to cover where the PPU cycles fall within the bus cycle (and the PAL phase).  Too
+            // early only costs a look at the interrupt lines.
+            uint64_t time = now + (uint64_t)ppuCycles * CpuVariant::masterClocksPerPpuCycle;
+            scheduleEvent(SchedulerEvent::Nmi, time > now + CpuVariant::masterClocksPerCpuCycle ? time - CpuVariant::masterClocksPerCpuCycle : now);
+        }
+    }
+
+    uint8_t Cpu2a03::readOperand(uint8_t index) {
+        if (decodedInstruction != nullptr) {
+            // No need to go through the memory mapper, but the bus cycle still happens.
+            synchronizeProcessors();
+            systemBus.addressBus = registers.programCounter + index;
+            systemBus.read = true;
+            systemBus.dataBus = decodedInstruction->operands[index];
+            return systemBus.dataBus;
+        }
+        return readFromAddress(registers.programCounter + index);
+    }
+
     void Cpu2a03::waitForNextInstruction() {
         // implement per instruction wait.  
     }
@@ -103,16 +397,20 @@ namespace NES {
         registers.y = 0;
         registers.stackPointer = 0xfd;  // power up causes NMI RESET interrupt which will -=3 to FA
         registers.programCounter = 0xffed;  // will do reset vector following
-        registers.interruptStatus = InterruptType::INT_RESET;
+        interrupts = InterruptController();
+        interrupts.raiseReset();
         memset(ram.ram, 0, SystemRam::systemRAMBytes);
 
     }
 
-    void Cpu2a03::setIrq() {
-        registers.interruptStatus = InterruptType::INT_IRQ;
+    void Cpu2a03::setIrq(IrqSource source) {
+        interrupts.assertIrq(source);
+    }
+    void Cpu2a03::clearIrq(IrqSource source) {
+        interrupts.releaseIrq(source);
     }
     void Cpu2a03::setNmi() {
-        registers.interruptStatus = InterruptType::INT_NMI;
+        interrupts.raiseNmi();
     }
 
     // $4011 set to 0
@@ -120,7 +418,7 @@ namespace NES {
     // reset vector is at FFFC,FFFD (usually ROM)
     // https://wiki.nesdev.com/w/index.php/CPU_power_up_state#cite_note-1
     void Cpu2a03::reset() {
-        registers.interruptStatus = InterruptType::INT_RESET;
+        interrupts.raiseReset();
     }
 
 
@@ -158,7 +456,7 @@ namespace NES {
         } else {
             dprintf(debugOut, "     ");
         }
-        dprintf(debugOut, "  %s \n", instructionString[opCode->instruction]);
+        dprintf(debugOut, "  %s \n", instructionNames[opCode->instruction]);
 
 
         // if (isDma) {
@@ -189,12 +487,6 @@ namespace NES {
 
     }
 
-    void Cpu2a03::synchronizeProcessors() {
-        ppu->doPpuCycle();
-        ppu->doPpuCycle();
-        ppu->doPpuCycle();
-    }
-
 
     /*
     Source :http://nesdev.com/NESDoc.pdf Appendix D for memory mapper functions
@@ -218,35 +510,71 @@ namespace NES {
     unsigned int Cpu2a03::doMemoryOperation() {
         synchronizeProcessors();
 
-
-        // 2kb system ram, mirrored 3 additional times
-        if (systemBus.addressBus < 0x2000) {
-            // 0x0800-0x0FFF  mirror 1
-            // 0x1000-0x17FF  mirror 2
-            // 0x1800-0x1FFF  mirror 3
+        const MemoryPage &page = memoryPages[systemBus.addressBus >> MemoryPage::pageBits];
+        switch (page.handler) {
+        case MemoryPageHandler::SystemRam:
+            // 2kb system ram, mirrored 3 additional times
             systemRamHandler(systemBus);
-        }
-        // $200-$3fff PPU registers (8bytes) mirrors of those 8 bytes for a total of 8kb
-        else if (systemBus.addressBus < 0x4000) {
+            break;
+        case MemoryPageHandler::PpuRegisters:
             //Eight bytes of memory mapped PPU registers mirrored
             ppuRegisterHandler(systemBus);
+            break;
+        case MemoryPageHandler::IoRegisters:
+            if (systemBus.addressBus < 0x4020) {
+                ioRegisterHandler(systemBus);
+            } else {
+                cartridgeHandler(systemBus);
+            }
+            break;
+        case MemoryPageHandler::Cartridge:
+            // General cartrige space including PRG ROM/RAM, SRAM/WRAM (save data), mapper registers, etc.
+            if (systemBus.read && page.read != nullptr) {
+                systemBus.dataBus = page.read[systemBus.addressBus & MemoryPage::pageMask];
+            } else if (!systemBus.read && page.write != nullptr) {
+                page.write[systemBus.addressBus & MemoryPage::pageMask] = systemBus.dataBus;
+            } else {
+                cartridgeHandler(systemBus);
+            }
+            break;
         }
-        // I/O registers, APU registers
-        else if (systemBus.addressBus < 0x4020) {
-            // TODO add APU etc
 
-            if (systemBus.addressBus == 0x4014 && !systemBus.read) {
-                // Activate DMA for processor to take over.
-                dmaData.activate(systemBus.dataBus);
+        // TODO memory cycles cost by memory op? 
+        return 0;
+    }
+
+    std::array<MemoryPage, MemoryPage::pageCount> Cpu2a03::getDefaultMemoryPages() {
+        std::array<MemoryPage, MemoryPage::pageCount> pages{};
+        for (size_t i = 0; i < MemoryPage::pageCount; i++) {
+            size_t address = i << MemoryPage::pageBits;
+            if (address < 0x2000) {
+                pages[i].handler = MemoryPageHandler::SystemRam;
+            } else if (address < 0x4000) {
+                pages[i].handler = MemoryPageHandler::PpuRegisters;
+            } else if (address < 0x4400) {
+                pages[i].handler = MemoryPageHandler::IoRegisters;
+            } else {
+                pages[i].handler = MemoryPageHandler::Cartridge;
             }
         }
-        // General cartrige space including PRG ROM/RAM, SRAM/WRAM (save data), mapper registers, etc.
-        else {
-            cartridge->mmc->doMemoryOperation(systemBus, *cartridge);
+        return pages;
+    }
+
+    void Cpu2a03::mapCartridge() {
+        mappedMmc = cartridge != nullptr ? cartridge->mmc : nullptr;
+        if (mappedMmc != nullptr) {
+            mappedMmc->mapPrgPages(*cartridge);
         }
+        copyCartridgePages();
+    }
 
-        // TODO memory cycles cost by memory op? 
-        return 0;
+    void Cpu2a03::copyCartridgePages() {
+        for (size_t i = 0; i < MemoryPage::pageCount; i++) {
+            if (memoryPages[i].handler == MemoryPageHandler::Cartridge) {
+                memoryPages[i].read = mappedMmc != nullptr ? mappedMmc->prgReadPages[i] : nullptr;
+                memoryPages[i].write = mappedMmc != nullptr ? mappedMmc->prgWritePages[i] : nullptr;
+            }
+        }
     }
 
     uint8_t Cpu2a03::readFromAddress(uint16_t addr) {
@@ -257,11 +585,40 @@ namespace NES {
     }
 
     void Cpu2a03::ioRegisterHandler(SystemBus &systemBus) {
-        DBG_ASSERT(systemBus.addressBus < 0x4020 && systemBus.addressBus > 0x4000, "invalid address for io handler %d", systemBus.addressBus);
+        DBG_ASSERT(systemBus.addressBus < 0x4020 && systemBus.addressBus >= 0x4000, "invalid address for io handler %d", systemBus.addressBus);
+
+        // TODO add APU etc
+        if (systemBus.addressBus == 0x4014 && !systemBus.read) {
+            // Activate DMA for processor to take over.
+            dmaData.activate(systemBus.dataBus);
+            scheduleEvent(SchedulerEvent::Dma, getMasterClock());
+        } else if ((systemBus.addressBus == 0x4016 || systemBus.addressBus == 0x4017) && systemBus.read) {
+            // TODO controllers
+            controllerReads++;
+        }
+    }
+
+    void Cpu2a03::cartridgeHandler(SystemBus &systemBus) {
+        if (cartridge->mmc != mappedMmc) {
+            // first access through this mapper
+            mapCartridge();
+        }
 
+        // mapper registers can switch CHR banks and mirroring under the PPU
+        if (!systemBus.read) {
+            catchUpPpu();
+            ppu->flushDataWrites();
+        }
+        mapperMemoryOperation(systemBus, *cartridge);
+        if (!systemBus.read) {
+            // and PRG banks under the CPU, or raise an IRQ
+            copyCartridgePages();
+            scheduleEvent(SchedulerEvent::Poll, getMasterClock());
+        }
     }
 
     void Cpu2a03::ppuRegisterHandler(SystemBus &systemBus) {
+        catchUpPpu();
         uint16_t actualAddr = 0x2000 + ((systemBus.addressBus - 0x2000) % 8);
 
         PPURegister reg = (PPURegister)(actualAddr - 0x2000);
@@ -269,6 +626,8 @@ namespace NES {
             systemBus.dataBus = ppu->readRegister(reg);
         } else {
             ppu->writeRegister(reg, systemBus.dataBus);
+            // enabling NMI in vblank raises it straight away
+            scheduleEvent(SchedulerEvent::Poll, getMasterClock());
         }
     }
 
@@ -280,6 +639,10 @@ namespace NES {
             systemBus.dataBus = ram.ram[actual];
         } else {
             ram.ram[actual] = systemBus.dataBus;
+            if (blockCache.isRamCodePage(actual)) {
+                // self modifying code or code copied into RAM
+                blockCache.invalidateRamPage(actual);
+            }
         }
     }
 
@@ -304,7 +667,7 @@ namespace NES {
 
     void Cpu2a03::popStackToDataBus() {
         popStackSetup();
-        doMemoryOperation();
+        doZeroPageOperation();
     }
 
     void Cpu2a03::popStackToDataBusWithFlags() {
@@ -319,7 +682,7 @@ namespace NES {
 
     void Cpu2a03::pushDataBusToStack() {
         pushStackSetup();
-        doMemoryOperation();
+        doZeroPageOperation();
     }
 
     void Cpu2a03::interrupt(InterruptType interruptType) {
@@ -346,6 +709,8 @@ namespace NES {
             }
             pushDataBusToStack();
         }
+        // mask IRQ so a source still holding the line doesn't re-enter the handler straight away
+        registers.setFlag(ProcessorStatus::InterruptDisable);
 
         static uint16_t interruptVector[4][2] = {
             { 0xfffe, 0xffff },    // IRQ
@@ -421,7 +786,7 @@ namespace NES {
     *        1. Get data from PC+1
     */
     void Cpu2a03::getImmediateAddress(OpCodeArgs &args) {
-        args.setArgs(readFromAddress(registers.programCounter));
+        args.setArgs(readOperand(0));
     }
 
     /**
@@ -431,7 +796,7 @@ namespace NES {
     */
     void Cpu2a03::getRelativeAddress(OpCodeArgs &args) {
         // Argument is fetched to be used to alter PC
-        args.setArgs(readFromAddress(registers.programCounter));
+        args.setArgs(readOperand(0));
     }
 
     /**
@@ -441,10 +806,10 @@ namespace NES {
     */
     void Cpu2a03::getZeroPageAddress(OpCodeArgs &args) {
         // get operand addr
-        readFromAddress(registers.programCounter);
+        readOperand(0);
         args.setArgs(systemBus.dataBus);
         // zero page addr only needs lower byte
-        readFromAddress((uint16_t)systemBus.dataBus);
+        readFromZeroPage((uint16_t)systemBus.dataBus);
     }
 
     /**
@@ -453,10 +818,10 @@ namespace NES {
     *        1. fetch addr operand (1 byte)
     */
     void Cpu2a03::getXIndexedZeroPageAddress(OpCodeArgs &args) {
-        readFromAddress(registers.programCounter);
+        readOperand(0);
         args.setArgs(systemBus.dataBus);
 
-        readFromAddress((systemBus.dataBus + registers.x) % 0x80);
+        readFromZeroPage((systemBus.dataBus + registers.x) % 0x80);
     }
 
     /**
@@ -465,10 +830,10 @@ namespace NES {
     *        1. fetch addr operand (1 byte)
     */
     void Cpu2a03::getYIndexedZeroPageAddress(OpCodeArgs &args) {
-        readFromAddress(registers.programCounter);
+        readOperand(0);
         args.setArgs(systemBus.dataBus);
 
-        readFromAddress((systemBus.dataBus + registers.y) % 0x80);
+        readFromZeroPage((systemBus.dataBus + registers.y) % 0x80);
     }
 
     /**
@@ -477,9 +842,9 @@ namespace NES {
     *        2. Fetch ADH
     */
     void Cpu2a03::fetchAddressFromPCToBus(OpCodeArgs &args) {
-        readFromAddress(registers.programCounter);
+        readOperand(0);
         uint8_t adlTmp = systemBus.dataBus;
-        readFromAddress(registers.programCounter + 1);
+        readOperand(1);
         systemBus.setAddressBus(adlTmp, systemBus.dataBus);
 
         args.setArgs(adlTmp, systemBus.dataBus);
@@ -541,11 +906,11 @@ namespace NES {
     *        3. Fetch ADL+X+1
     */
     void Cpu2a03::getXIndexedIndirectAddress(OpCodeArgs &args) {
-        readFromAddress(registers.programCounter);
+        readOperand(0);
         args.setArgs(systemBus.dataBus);
 
         systemBus.setAdlOnly((systemBus.dataBus + registers.x) % 0xff);
-        fetchIndirectAddressToBus();
+        fetchZeroPageIndirectAddressToBus();
         // address bus now contains the address retrieved from x in zero page.
 
         systemBus.read = true;
@@ -562,11 +927,11 @@ namespace NES {
     *    TODO handle special case denoted in http://www.fceux.com/web/help/fceux.html?6502CPU.html 6th cycle when given invalid effective address
     */
     void Cpu2a03::getIndirectYIndexedAddress(OpCodeArgs &args) {
-        readFromAddress(registers.programCounter);
+        readOperand(0);
         args.setArgs(systemBus.dataBus);
 
         systemBus.setAdlOnly(systemBus.dataBus);
-        fetchIndirectAddressToBus();
+        fetchZeroPageIndirectAddressToBus();
         if ((systemBus.addressBus & 0xff) + registers.y > 0xff) {
             args.pagingCycles = 1;
         }
@@ -590,6 +955,16 @@ namespace NES {
         systemBus.setAddressBus(tmpAdl, systemBus.dataBus);
     }
 
+    void Cpu2a03::fetchZeroPageIndirectAddressToBus() {
+        systemBus.read = true;
+        doZeroPageOperation();
+        uint8_t tmpAdl = systemBus.dataBus;
+        systemBus.addressBus++;
+        doZeroPageOperation();
+
+        systemBus.setAddressBus(tmpAdl, systemBus.dataBus);
+    }
+
     // TODO maybe move this into CPU namespace finally to remove the cpu argument?
     namespace InstructionSet {
         uint8_t NOP(const OpCode &opCode, Cpu2a03 &cpu) {
@@ -604,10 +979,13 @@ namespace NES {
                 arg = cpu.registers.acc;
             }
 
-            if ((arg & 0x80) != 0) {
-                cpu.registers.setFlag(ProcessorStatus::CarryFlag);
-            } else {
-                cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+            // C is left alone when it is dead here (see Cpu2a03::flagLivenessEnabled)
+            if (cpu.isFlagLive(ProcessorStatus::CarryFlag)) {
+                if ((arg & 0x80) != 0) {
+                    cpu.registers.setFlag(ProcessorStatus::CarryFlag);
+                } else {
+                    cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+                }
             }
             arg = (int8_t)arg << 1;
             cpu.registers.setFlagIfZero(arg);
@@ -631,10 +1009,12 @@ namespace NES {
             }
 
             bool carrySet = cpu.registers.flagSet(ProcessorStatus::CarryFlag);
-            if ((arg & 0x80) != 0) {
-                cpu.registers.setFlag(ProcessorStatus::CarryFlag);
-            } else {
-                cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+            if (cpu.isFlagLive(ProcessorStatus::CarryFlag)) {
+                if ((arg & 0x80) != 0) {
+                    cpu.registers.setFlag(ProcessorStatus::CarryFlag);
+                } else {
+                    cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+                }
             }
             arg = arg << (uint8_t)1;
             arg += carrySet ? 1 : 0;
@@ -659,10 +1039,12 @@ namespace NES {
                 arg = cpu.registers.acc;
             }
             uint8_t carryMask = cpu.registers.flagSet(ProcessorStatus::CarryFlag) ? 0x80 : 0x00;
-            if ((arg & 0x01) != 0) {
-                cpu.registers.setFlag(ProcessorStatus::CarryFlag);
-            } else {
-                cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+            if (cpu.isFlagLive(ProcessorStatus::CarryFlag)) {
+                if ((arg & 0x01) != 0) {
+                    cpu.registers.setFlag(ProcessorStatus::CarryFlag);
+                } else {
+                    cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+                }
             }
 
             arg = arg >> (uint8_t)1;
@@ -689,10 +1071,12 @@ namespace NES {
                 arg = cpu.registers.acc;
             }
 
-            if ((arg & 0x1) != 0) {
-                cpu.registers.setFlag(ProcessorStatus::CarryFlag);
-            } else {
-                cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+            if (cpu.isFlagLive(ProcessorStatus::CarryFlag)) {
+                if ((arg & 0x1) != 0) {
+                    cpu.registers.setFlag(ProcessorStatus::CarryFlag);
+                } else {
+                    cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+                }
             }
             arg = arg >> (uint8_t)1;
             cpu.registers.setFlagIfZero(arg);
@@ -858,7 +1242,7 @@ namespace NES {
             if (add > 0xff) {
                 cpu.registers.setFlag(ProcessorStatus::CarryFlag);
             }
-            if (cpu.registers.willAddOverflow(busVal)) {
+            if (cpu.isFlagLive(ProcessorStatus::OverflowFlag) && cpu.registers.willAddOverflow(busVal)) {
                 cpu.registers.setFlag(ProcessorStatus::OverflowFlag);
             }
             cpu.registers.setFlagIfZero((uint8_t)add);
@@ -866,13 +1250,85 @@ namespace NES {
             return (uint8_t)add;
         }
 
+        /**
+        *   NMOS 6502 decimal mode addition.  C comes from the decimal result but N, V and Z are what the NMOS part
+        *   leaves behind: N and V from the sum before the high digit is adjusted, Z from the binary sum.
+        *   See http://www.6502.org/tutorials/decimal_mode.html Appendix A
+        */
+        uint8_t addDecimal(uint8_t busVal, Cpu2a03 &cpu) {
+            uint8_t acc = cpu.registers.acc;
+            int carry = cpu.registers.flagSet(ProcessorStatus::CarryFlag) ? 1 : 0;
+            int low = (acc & 0x0f) + (busVal & 0x0f) + carry;
+            if (low >= 0x0a) {
+                low = ((low + 0x06) & 0x0f) + 0x10;
+            }
+            int sum = (acc & 0xf0) + (busVal & 0xf0) + low;
+            int signedSum = (int8_t)(acc & 0xf0) + (int8_t)(busVal & 0xf0) + low;
+
+            cpu.registers.setFlagIfNegative((uint8_t)sum);
+            cpu.registers.setFlagIfZero((uint8_t)(acc + busVal + carry));
+            if (signedSum < -128 || signedSum > 127) {
+                cpu.registers.setFlag(ProcessorStatus::OverflowFlag);
+            } else {
+                cpu.registers.clearFlag(ProcessorStatus::OverflowFlag);
+            }
+
+            if (sum >= 0xa0) {
+                sum += 0x60;
+            }
+            if (sum >= 0x100) {
+                cpu.registers.setFlag(ProcessorStatus::CarryFlag);
+            } else {
+                cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+            }
+            return (uint8_t)sum;
+        }
+
+        // NMOS 6502 decimal mode subtraction.  Every flag is the same as for the binary subtraction.
+        uint8_t subtractDecimal(uint8_t busVal, Cpu2a03 &cpu) {
+            uint8_t acc = cpu.registers.acc;
+            int borrow = cpu.registers.flagSet(ProcessorStatus::CarryFlag) ? 0 : 1;
+            int low = (acc & 0x0f) - (busVal & 0x0f) - borrow;
+            if (low < 0) {
+                low = ((low - 0x06) & 0x0f) - 0x10;
+            }
+            int difference = (acc & 0xf0) - (busVal & 0xf0) + low;
+            if (difference < 0) {
+                difference -= 0x60;
+            }
+
+            int binary = acc - busVal - borrow;
+            cpu.registers.setFlagIfNegative((uint8_t)binary);
+            cpu.registers.setFlagIfZero((uint8_t)binary);
+            if ((acc ^ busVal) & (acc ^ binary) & 0x80) {
+                cpu.registers.setFlag(ProcessorStatus::OverflowFlag);
+            } else {
+                cpu.registers.clearFlag(ProcessorStatus::OverflowFlag);
+            }
+            if (binary >= 0) {
+                cpu.registers.setFlag(ProcessorStatus::CarryFlag);
+            } else {
+                cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+            }
+            return (uint8_t)difference;
+        }
+
         // TODO .. simplify these
+        // Decimal mode only exists on variants with the BCD adder, the check is constant false on the 2A03
         uint8_t ADC(const OpCode &opCode, Cpu2a03 &cpu) {
+            if (CpuVariant::decimalMode && cpu.registers.flagSet(ProcessorStatus::DecimalMode)) {
+                cpu.registers.acc = addDecimal(cpu.systemBus.dataBus, cpu);
+                return 0;
+            }
             cpu.registers.acc = add(cpu.systemBus.dataBus, cpu);
             return 0;
         }
 
         uint8_t SBC(const OpCode &opCode, Cpu2a03 &cpu) {
+            if (CpuVariant::decimalMode && cpu.registers.flagSet(ProcessorStatus::DecimalMode)) {
+                cpu.registers.acc = subtractDecimal(cpu.systemBus.dataBus, cpu);
+                return 0;
+            }
             cpu.registers.acc = add(~cpu.systemBus.dataBus, cpu);
             return 0;
         }
@@ -927,10 +1383,12 @@ namespace NES {
             cpu.registers.setFlagIfZero(val);
             cpu.registers.setFlagIfNegative(cpu.systemBus.dataBus);
 
-            if ((cpu.systemBus.dataBus & 0x40) != 0) {
-                cpu.registers.setFlag(ProcessorStatus::OverflowFlag);
-            } else {
-                cpu.registers.clearFlag(ProcessorStatus::OverflowFlag);
+            if (cpu.isFlagLive(ProcessorStatus::OverflowFlag)) {
+                if ((cpu.systemBus.dataBus & 0x40) != 0) {
+                    cpu.registers.setFlag(ProcessorStatus::OverflowFlag);
+                } else {
+                    cpu.registers.clearFlag(ProcessorStatus::OverflowFlag);
+                }
             }
             cpu.registers.setFlagIfNegative(cpu.systemBus.dataBus);
 
@@ -941,10 +1399,12 @@ namespace NES {
             uint8_t res = reg - arg;
             cpu.registers.setFlagIfZero(res);
 
-            if (reg >= arg) {
-                cpu.registers.setFlag(ProcessorStatus::CarryFlag);
-            } else {
-                cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+            if (cpu.isFlagLive(ProcessorStatus::CarryFlag)) {
+                if (reg >= arg) {
+                    cpu.registers.setFlag(ProcessorStatus::CarryFlag);
+                } else {
+                    cpu.registers.clearFlag(ProcessorStatus::CarryFlag);
+                }
             }
 
             cpu.registers.setFlagIfNegative(res);
@@ -1105,7 +1565,6 @@ namespace NES {
             uint16_t jmpAddress = cpu.systemBus.addressBus;
             // Usual timing order only fetches ADL here
             uint16_t ret = cpu.registers.programCounter - 1;
-            printf("jmp to %04x with return addr %04x\n", jmpAddress, ret);
 
             cpu.systemBus.dataBus = ret >> 8;
             cpu.pushDataBusToStack();
@@ -1152,10 +1611,527 @@ namespace NES {
             DBG_CRASH("Unknown instruction encountered %02x: {addr: $%04x, data:$%02x, read:%d} {a: $%02x, x: $%02x, y: $%02x, sp:$%02x, p: $%02x, pc: $%04x}\n",
                 opCode.opCode,
                 cpu.systemBus.addressBus, cpu.systemBus.dataBus, cpu.systemBus.read,
-                cpu.registers.acc, cpu.registers.x, cpu.registers.y, cpu.registers.stackPointer, cpu.registers.statusRegister, cpu.registers.programCounter);
+                cpu.registers.acc, cpu.registers.x, cpu.registers.y, cpu.registers.stackPointer, cpu.registers.statusRegister.value(), cpu.registers.programCounter);
 
             return 0;
         }
+
+        // Sourced from http://e-tradition.net/bytes/6502/6502_instruction_set.html
+        constexpr OpCode opCodes[256] = {
+            // op, bytes, cycles, page, instruction, addressing mode
+            { 0x00, 1, 7, 0, Instruction::BRK, AddressingMode::Implicit },
+            { 0x01, 2, 6, 0, Instruction::ORA, AddressingMode::XIndexedIndirect },
+            { 0x02, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x03, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x04, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x05, 2, 3, 0, Instruction::ORA, AddressingMode::ZeroPage },
+            { 0x06, 2, 5, 0, Instruction::ASL, AddressingMode::ZeroPage },
+            { 0x07, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x08, 1, 3, 0, Instruction::PHP, AddressingMode::Implicit },
+            { 0x09, 2, 2, 0, Instruction::ORA, AddressingMode::Immediate },
+            { 0x0a, 1, 2, 0, Instruction::ASL, AddressingMode::Accumulator },
+            { 0x0b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x0c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x0d, 3, 4, 0, Instruction::ORA, AddressingMode::Absolute },
+            { 0x0e, 3, 6, 0, Instruction::ASL, AddressingMode::Absolute },
+            { 0x0f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0x10, 2, 2, 2, Instruction::BPL, AddressingMode::Relative },
+            { 0x11, 2, 5, 1, Instruction::ORA, AddressingMode::IndirectYIndexed },
+            { 0x12, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x13, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x14, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x15, 2, 4, 0, Instruction::ORA, AddressingMode::ZeroPageX },
+            { 0x16, 2, 6, 0, Instruction::ASL, AddressingMode::ZeroPageX },
+            { 0x17, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x18, 1, 2, 0, Instruction::CLC, AddressingMode::Implicit },
+            { 0x19, 3, 4, 1, Instruction::ORA, AddressingMode::AbsoluteY },
+            { 0x1a, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x1b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x1c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x1d, 3, 4, 1, Instruction::ORA, AddressingMode::AbsoluteX },
+            { 0x1e, 3, 7, 0, Instruction::ASL, AddressingMode::AbsoluteX },
+            { 0x1f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0x20, 3, 6, 0, Instruction::JSR, AddressingMode::Absolute },
+            { 0x21, 2, 6, 0, Instruction::AND, AddressingMode::XIndexedIndirect },
+            { 0x22, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x23, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x24, 2, 3, 0, Instruction::BIT, AddressingMode::ZeroPage },
+            { 0x25, 2, 3, 0, Instruction::AND, AddressingMode::ZeroPage },
+            { 0x26, 2, 5, 0, Instruction::ROL, AddressingMode::ZeroPage },
+            { 0x27, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x28, 1, 4, 0, Instruction::PLP, AddressingMode::Implicit },
+            { 0x29, 2, 2, 0, Instruction::AND, AddressingMode::Immediate },
+            { 0x2a, 1, 2, 0, Instruction::ROL, AddressingMode::Accumulator },
+            { 0x2b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x2c, 3, 4, 0, Instruction::BIT, AddressingMode::Absolute },
+            { 0x2d, 3, 4, 0, Instruction::AND, AddressingMode::Absolute },
+            { 0x2e, 3, 6, 0, Instruction::ROL, AddressingMode::Absolute },
+            { 0x2f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0x30, 2, 2, 2, Instruction::BMI, AddressingMode::Relative },
+            { 0x31, 2, 5, 1, Instruction::AND, AddressingMode::IndirectYIndexed },
+            { 0x32, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x33, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x34, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x35, 2, 4, 0, Instruction::AND, AddressingMode::ZeroPageX },
+            { 0x36, 2, 6, 0, Instruction::ROL, AddressingMode::ZeroPageX },
+            { 0x37, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x38, 1, 2, 0, Instruction::SEC, AddressingMode::Implicit },
+            { 0x39, 3, 4, 1, Instruction::AND, AddressingMode::AbsoluteY },
+            { 0x3a, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x3b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x3c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x3d, 3, 4, 1, Instruction::AND, AddressingMode::AbsoluteX },
+            { 0x3e, 3, 7, 0, Instruction::ROL, AddressingMode::AbsoluteX },
+            { 0x3f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0x40, 1, 6, 0, Instruction::RTI, AddressingMode::Implicit },
+            { 0x41, 2, 6, 0, Instruction::EOR, AddressingMode::XIndexedIndirect },
+            { 0x42, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x43, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x44, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x45, 2, 3, 0, Instruction::EOR, AddressingMode::ZeroPage },
+            { 0x46, 2, 5, 0, Instruction::LSR, AddressingMode::ZeroPage },
+            { 0x47, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x48, 1, 3, 0, Instruction::PHA, AddressingMode::Implicit },
+            { 0x49, 2, 2, 0, Instruction::EOR, AddressingMode::Immediate },
+            { 0x4a, 1, 2, 0, Instruction::LSR, AddressingMode::Accumulator },
+            { 0x4b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x4c, 3, 3, 0, Instruction::JMP, AddressingMode::Absolute },
+            { 0x4d, 3, 4, 0, Instruction::EOR, AddressingMode::Absolute },
+            { 0x4e, 3, 6, 0, Instruction::LSR, AddressingMode::Absolute },
+            { 0x4f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0x50, 2, 2, 2, Instruction::BVC, AddressingMode::Relative },
+            { 0x51, 2, 5, 1, Instruction::EOR, AddressingMode::IndirectYIndexed },
+            { 0x52, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x53, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x54, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x55, 2, 4, 0, Instruction::EOR, AddressingMode::ZeroPageX },
+            { 0x56, 2, 6, 0, Instruction::LSR, AddressingMode::ZeroPageX },
+            { 0x57, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x58, 1, 2, 0, Instruction::CLI, AddressingMode::Implicit },
+            { 0x59, 3, 4, 1, Instruction::EOR, AddressingMode::AbsoluteY },
+            { 0x5a, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x5b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x5c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x5d, 3, 4, 1, Instruction::EOR, AddressingMode::AbsoluteX },
+            { 0x5e, 3, 7, 0, Instruction::LSR, AddressingMode::AbsoluteX },
+            { 0x5f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0x60, 1, 6, 0, Instruction::RTS, AddressingMode::Implicit },
+            { 0x61, 2, 6, 0, Instruction::ADC, AddressingMode::Indirect },
+            { 0x62, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x63, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x64, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x65, 2, 3, 0, Instruction::ADC, AddressingMode::ZeroPage },
+            { 0x66, 2, 5, 0, Instruction::ROR, AddressingMode::ZeroPage },
+            { 0x67, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x68, 1, 4, 0, Instruction::PLA, AddressingMode::Implicit },
+            { 0x69, 2, 2, 0, Instruction::ADC, AddressingMode::Immediate },
+            { 0x6a, 1, 2, 0, Instruction::ROR, AddressingMode::Accumulator },
+            { 0x6b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x6c, 3, 3, 0, Instruction::JMP, AddressingMode::Indirect },
+            { 0x6d, 3, 4, 0, Instruction::ADC, AddressingMode::Absolute },
+            { 0x6e, 3, 6, 0, Instruction::ROR, AddressingMode::Absolute },
+            { 0x6f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0x70, 2, 2, 2, Instruction::BVS, AddressingMode::Relative },
+            { 0x71, 2, 5, 1, Instruction::ADC, AddressingMode::IndirectYIndexed },
+            { 0x72, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x73, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x74, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x75, 2, 4, 0, Instruction::ADC, AddressingMode::ZeroPageX },
+            { 0x76, 2, 6, 0, Instruction::ROR, AddressingMode::ZeroPageX },
+            { 0x77, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x78, 1, 2, 0, Instruction::SEI, AddressingMode::Implicit },
+            { 0x79, 3, 4, 1, Instruction::ADC, AddressingMode::AbsoluteY },
+            { 0x7a, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x7b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x7c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x7d, 3, 4, 1, Instruction::ADC, AddressingMode::AbsoluteX },
+            { 0x7e, 3, 7, 0, Instruction::ROR, AddressingMode::AbsoluteX },
+            { 0x7f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0x80, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x81, 2, 6, 0, Instruction::STA, AddressingMode::Indirect },
+            { 0x82, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x83, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x84, 2, 3, 0, Instruction::STY, AddressingMode::ZeroPage },
+            { 0x85, 2, 3, 0, Instruction::STA, AddressingMode::ZeroPage },
+            { 0x86, 2, 3, 0, Instruction::STX, AddressingMode::ZeroPage },
+            { 0x87, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x88, 1, 2, 0, Instruction::DEY, AddressingMode::Implicit },
+            { 0x89, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x8a, 1, 2, 0, Instruction::TXA, AddressingMode::Implicit },
+            { 0x8b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x8c, 3, 4, 0, Instruction::STY, AddressingMode::Absolute },
+            { 0x8d, 3, 4, 0, Instruction::STA, AddressingMode::Absolute },
+            { 0x8e, 3, 4, 0, Instruction::STX, AddressingMode::Absolute },
+            { 0x8f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0x90, 2, 2, 2, Instruction::BCC, AddressingMode::Relative },
+            { 0x91, 2, 6, 0, Instruction::STA, AddressingMode::IndirectYIndexed },
+            { 0x92, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x93, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x94, 2, 4, 0, Instruction::STY, AddressingMode::ZeroPageX },
+            { 0x95, 2, 4, 0, Instruction::STA, AddressingMode::ZeroPageX },
+            { 0x96, 2, 4, 0, Instruction::STX, AddressingMode::ZeroPageY },
+            { 0x97, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x98, 1, 2, 0, Instruction::TYA, AddressingMode::Implicit },
+            { 0x99, 3, 5, 0, Instruction::STA, AddressingMode::AbsoluteY },
+            { 0x9a, 1, 2, 0, Instruction::TXS, AddressingMode::Implicit },
+            { 0x9b, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x9c, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x9d, 3, 5, 0, Instruction::STA, AddressingMode::AbsoluteX },
+            { 0x9e, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0x9f, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0xa0, 2, 2, 0, Instruction::LDY, AddressingMode::Immediate },
+            { 0xa1, 2, 6, 0, Instruction::LDA, AddressingMode::XIndexedIndirect },
+            { 0xa2, 2, 2, 0, Instruction::LDX, AddressingMode::Immediate },
+            { 0xa3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xa4, 2, 3, 0, Instruction::LDY, AddressingMode::ZeroPage },
+            { 0xa5, 2, 3, 0, Instruction::LDA, AddressingMode::ZeroPage },
+            { 0xa6, 2, 3, 0, Instruction::LDX, AddressingMode::ZeroPage },
+            { 0xa7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xa8, 1, 2, 0, Instruction::TAY, AddressingMode::Implicit },
+            { 0xa9, 2, 2, 0, Instruction::LDA, AddressingMode::Immediate },
+            { 0xaa, 1, 2, 0, Instruction::TAX, AddressingMode::Implicit },
+            { 0xab, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xac, 0, 0, 0, Instruction::LDY, AddressingMode::Absolute },
+            { 0xad, 3, 4, 0, Instruction::LDA, AddressingMode::Absolute },
+            { 0xae, 3, 4, 0, Instruction::LDX, AddressingMode::Absolute },
+            { 0xaf, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0xb0, 2, 2, 2, Instruction::BCS, AddressingMode::Relative },
+            { 0xb1, 2, 5, 1, Instruction::LDA, AddressingMode::IndirectYIndexed },
+            { 0xb2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xb3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xb4, 2, 4, 0, Instruction::LDY, AddressingMode::ZeroPageX },
+            { 0xb5, 2, 4, 0, Instruction::LDA, AddressingMode::ZeroPageX },
+            { 0xb6, 2, 4, 0, Instruction::LDX, AddressingMode::ZeroPageY },
+            { 0xb7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xb8, 1, 2, 0, Instruction::CLV, AddressingMode::Implicit },
+            { 0xb9, 3, 4, 1, Instruction::LDA, AddressingMode::AbsoluteY },
+            { 0xba, 1, 2, 0, Instruction::TSX, AddressingMode::Implicit },
+            { 0xbb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xbc, 3, 4, 1, Instruction::LDY, AddressingMode::AbsoluteX },
+            { 0xbd, 3, 4, 1, Instruction::LDA, AddressingMode::AbsoluteX },
+            { 0xbe, 3, 4, 1, Instruction::LDX, AddressingMode::AbsoluteY },
+            { 0xbf, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0xc0, 2, 2, 0, Instruction::CPY, AddressingMode::Immediate },
+            { 0xc1, 2, 6, 0, Instruction::CMP, AddressingMode::XIndexedIndirect },
+            { 0xc2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xc3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xc4, 2, 3, 0, Instruction::CPY, AddressingMode::ZeroPage },
+            { 0xc5, 2, 3, 0, Instruction::CMP, AddressingMode::ZeroPage },
+            { 0xc6, 2, 5, 0, Instruction::DEC, AddressingMode::ZeroPage },
+            { 0xc7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xc8, 1, 2, 0, Instruction::INY, AddressingMode::Implicit },
+            { 0xc9, 2, 2, 0, Instruction::CMP, AddressingMode::Immediate },
+            { 0xca, 1, 2, 0, Instruction::DEX, AddressingMode::Implicit },
+            { 0xcb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xcc, 2, 4, 0, Instruction::CPY, AddressingMode::Absolute },
+            { 0xcd, 3, 4, 0, Instruction::CMP, AddressingMode::Absolute },
+            { 0xce, 3, 3, 0, Instruction::DEC, AddressingMode::Absolute },
+            { 0xcf, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0xd0, 2, 2, 2, Instruction::BNE, AddressingMode::Relative },
+            { 0xd1, 2, 5, 1, Instruction::CMP, AddressingMode::IndirectYIndexed },
+            { 0xd2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xd3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xd4, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xd5, 2, 4, 0, Instruction::CMP, AddressingMode::ZeroPageX },
+            { 0xd6, 2, 6, 0, Instruction::DEC, AddressingMode::ZeroPageX },
+            { 0xd7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xd8, 1, 2, 0, Instruction::CLD, AddressingMode::Implicit },
+            { 0xd9, 3, 4, 1, Instruction::CMP, AddressingMode::AbsoluteY },
+            { 0xda, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xdb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xdc, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xdd, 3, 4, 1, Instruction::CMP, AddressingMode::AbsoluteX },
+            { 0xde, 3, 7, 0, Instruction::DEC, AddressingMode::AbsoluteX },
+            { 0xdf, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0xe0, 2, 2, 0, Instruction::CPX, AddressingMode::Immediate },
+            { 0xe1, 2, 6, 0, Instruction::SBC, AddressingMode::XIndexedIndirect },
+            { 0xe2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xe3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xe4, 2, 3, 0, Instruction::CPX, AddressingMode::ZeroPage },
+            { 0xe5, 2, 3, 0, Instruction::SBC, AddressingMode::ZeroPage },
+            { 0xe6, 2, 5, 0, Instruction::INC, AddressingMode::ZeroPage },
+            { 0xe7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xe8, 1, 2, 0, Instruction::INX, AddressingMode::Implicit },
+            { 0xe9, 2, 2, 0, Instruction::SBC, AddressingMode::Immediate },
+            { 0xea, 1, 2, 0, Instruction::NOP, AddressingMode::Implicit },
+            { 0xeb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xec, 3, 4, 0, Instruction::CPX, AddressingMode::Absolute },
+            { 0xed, 3, 4, 0, Instruction::SBC, AddressingMode::Absolute },
+            { 0xee, 3, 6, 0, Instruction::INC, AddressingMode::Absolute },
+            { 0xef, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+
+            { 0xf0, 2, 2, 2, Instruction::BEQ, AddressingMode::Relative },
+            { 0xf1, 2, 5, 1, Instruction::SBC, AddressingMode::IndirectYIndexed },
+            { 0xf2, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xf3, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xf4, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xf5, 2, 4, 0, Instruction::SBC, AddressingMode::ZeroPageX },
+            { 0xf6, 2, 6, 0, Instruction::INC, AddressingMode::ZeroPageX },
+            { 0xf7, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xf8, 1, 2, 0, Instruction::SED, AddressingMode::Implicit },
+            { 0xf9, 3, 4, 1, Instruction::SBC, AddressingMode::AbsoluteY },
+            { 0xfa, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xfb, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xfc, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined },
+            { 0xfd, 3, 4, 1, Instruction::SBC, AddressingMode::AbsoluteX },
+            { 0xfe, 3, 7, 0, Instruction::INC, AddressingMode::AbsoluteX },
+            { 0xff, 0, 0, 0, Instruction::UNK, AddressingMode::Undefined }
+        };
+
+
+        constexpr InstructionFnPtr instructionHandlers[Instruction::UNK + 1] = {
+            &LDA, &LDX, &LDY, &STA, &STX, &STY,
+            &TAX, &TAY, &TXA, &TYA,
+            &TSX, &TXS, &PHA, &PHP, &PLA, &PLP,
+            &AND, &EOR, &ORA, &BIT,
+            &ADC, &SBC, &CMP, &CPX, &CPY,
+            &INC, &INX, &INY, &DEC, &DEX, &DEY,
+            &ASL, &LSR, &ROL, &ROR,
+            &JMP, &JSR, &RTS,
+            &BCC, &BCS, &BEQ, &BMI, &BNE, &BPL, &BVC, &BVS,
+            &CLC, &CLD, &CLI, &CLV, &SEC, &SED, &SEI,
+            &BRK, &NOP, &RTI,
+            &UNK,
+        };
+    }
+
+    ///////////////////////////////////////////////////////////////////////
+    // Fused op code handlers
+    //
+    // One function per (instruction, addressing mode) pair.  The addressing mode switch and the handler lookup are
+    // resolved at compile time, and the handlers are defined above in this file so they can be inlined with the
+    // addressing mode checks (ASL/ROL/ROR/LSR accumulator forms) folded away.
+
+    namespace {
+        // Op code as seen by a fused handler.  Handlers only look at the instruction and addressing mode.
+        template<Instruction instruction, AddressingMode addressingMode>
+        struct FusedOpCode {
+            static constexpr OpCode opCode{ 0, 0, 0, 0, instruction, addressingMode };
+        };
+        template<Instruction instruction, AddressingMode addressingMode>
+        constexpr OpCode FusedOpCode<instruction, addressingMode>::opCode;
+    }
+
+    template<AddressingMode addressingMode>
+    inline void Cpu2a03::fetchOperands(OpCodeArgs &args) {
+        // addressingMode is a constant so only one case is compiled in
+        switch (addressingMode) {
+        case AddressingMode::Absolute:
+            getAbsoluateAddress(args);
+            break;
+        case AddressingMode::AbsoluteX:
+            getXIndexedAbsoluteAddress(args);
+            break;
+        case AddressingMode::AbsoluteY:
+            getYIndexedAbsoluteAddress(args);
+            break;
+        case AddressingMode::Immediate:
+            getImmediateAddress(args);
+            break;
+        case AddressingMode::Indirect:
+            getIndirectAddress(args);
+            break;
+        case AddressingMode::IndirectYIndexed:
+            getIndirectYIndexedAddress(args);
+            break;
+        case AddressingMode::Relative:
+            getRelativeAddress(args);
+            break;
+        case AddressingMode::XIndexedIndirect:
+            getXIndexedIndirectAddress(args);
+            break;
+        case AddressingMode::ZeroPage:
+            getZeroPageAddress(args);
+            break;
+        case AddressingMode::ZeroPageX:
+            getXIndexedZeroPageAddress(args);
+            break;
+        case AddressingMode::ZeroPageY:
+            getYIndexedZeroPageAddress(args);
+            break;
+        case AddressingMode::Accumulator:
+        case AddressingMode::Implicit:
+        case AddressingMode::Undefined:
+        default:
+            // no memory access used
+            return;
+        }
+        registers.programCounter += addressingModeProgramCounterDelta[addressingMode];
+    }
+
+    template<Instruction instruction, AddressingMode addressingMode>
+    uint8_t Cpu2a03::fusedOpCode(Cpu2a03 &cpu, OpCodeArgs &args) {
+        cpu.fetchOperands<addressingMode>(args);
+        return InstructionSet::instructionHandlers[instruction](FusedOpCode<instruction, addressingMode>::opCode, cpu);
+    }
+
+#define FUSED_OPCODE(op) &Cpu2a03::fusedOpCode<InstructionSet::opCodes[op].instruction, InstructionSet::opCodes[op].addressingMode>
+#define FUSED_OPCODE_ROW(row) \
+    FUSED_OPCODE(row + 0x0), FUSED_OPCODE(row + 0x1), FUSED_OPCODE(row + 0x2), FUSED_OPCODE(row + 0x3), \
+    FUSED_OPCODE(row + 0x4), FUSED_OPCODE(row + 0x5), FUSED_OPCODE(row + 0x6), FUSED_OPCODE(row + 0x7), \
+    FUSED_OPCODE(row + 0x8), FUSED_OPCODE(row + 0x9), FUSED_OPCODE(row + 0xa), FUSED_OPCODE(row + 0xb), \
+    FUSED_OPCODE(row + 0xc), FUSED_OPCODE(row + 0xd), FUSED_OPCODE(row + 0xe), FUSED_OPCODE(row + 0xf)
+
+    const FusedOpCodeFnPtr Cpu2a03::fusedOpCodes[256] = {
+        FUSED_OPCODE_ROW(0x00), FUSED_OPCODE_ROW(0x10), FUSED_OPCODE_ROW(0x20), FUSED_OPCODE_ROW(0x30),
+        FUSED_OPCODE_ROW(0x40), FUSED_OPCODE_ROW(0x50), FUSED_OPCODE_ROW(0x60), FUSED_OPCODE_ROW(0x70),
+        FUSED_OPCODE_ROW(0x80), FUSED_OPCODE_ROW(0x90), FUSED_OPCODE_ROW(0xa0), FUSED_OPCODE_ROW(0xb0),
+        FUSED_OPCODE_ROW(0xc0), FUSED_OPCODE_ROW(0xd0), FUSED_OPCODE_ROW(0xe0), FUSED_OPCODE_ROW(0xf0),
+    };
+
+#undef FUSED_OPCODE_ROW
+#undef FUSED_OPCODE
+
+    ///////////////////////////////////////////////////////////////////////
+    // Superinstructions
+    //
+    // Each instruction of a sequence still makes every one of its bus accesses (and so PPU cycles) in order through
+    // the fused handlers.  What goes away is the per instruction dispatch: DebugState, the block cache lookup, the
+    // interrupt checks reduced to the two that can change mid sequence, and the handler call through the table.
+
+    template<Instruction instruction, AddressingMode addressingMode>
+    inline uint8_t Cpu2a03::runDecodedInstruction(const DecodedInstruction &decoded) {
+        OpCodeArgs args = OpCodeArgs();
+        decodedInstruction = &decoded;
+        uint8_t branchCycles = fusedOpCode<instruction, addressingMode>(*this, args);
+        decodedInstruction = nullptr;
+        return decoded.opCode->cycles + branchCycles + args.pagingCycles;
+    }
+
+    bool Cpu2a03::continueSequence(const DecodedInstruction &decoded) {
+        // processInstruction would take DMA or an interrupt before this instruction
+        catchUpPpu();
+        if (dmaData.isActive || interrupts.isPending()) {
+            return false;
+        }
+        if (flagLivenessEnabled) {
+            liveFlags = flagLiveness.getLiveFlags(*this, decoded.address);
+        }
+        fetchDecodedOpCode(decoded);
+        return true;
+    }
+
+    template<Instruction instruction0, AddressingMode addressingMode0, Instruction instruction1, AddressingMode addressingMode1>
+    uint8_t Cpu2a03::superInstructionPair(Cpu2a03 &cpu, const DecodedInstruction *sequence, uint8_t &instructionCount) {
+        uint8_t cyclesTaken = cpu.runDecodedInstruction<instruction0, addressingMode0>(sequence[0]);
+        instructionCount = 1;
+        if (cpu.continueSequence(sequence[1])) {
+            cyclesTaken += cpu.runDecodedInstruction<instruction1, addressingMode1>(sequence[1]);
+            instructionCount = 2;
+        }
+        return cyclesTaken;
+    }
+
+    template<Instruction instruction0, AddressingMode addressingMode0, Instruction instruction1, AddressingMode addressingMode1,
+        Instruction instruction2, AddressingMode addressingMode2>
+    uint8_t Cpu2a03::superInstructionTriple(Cpu2a03 &cpu, const DecodedInstruction *sequence, uint8_t &instructionCount) {
+        uint8_t cyclesTaken = superInstructionPair<instruction0, addressingMode0, instruction1, addressingMode1>(cpu, sequence, instructionCount);
+        if (instructionCount == 2 && cpu.continueSequence(sequence[2])) {
+            cyclesTaken += cpu.runDecodedInstruction<instruction2, addressingMode2>(sequence[2]);
+            instructionCount = 3;
+        }
+        return cyclesTaken;
+    }
+
+#define SUPER_OPCODE(op) InstructionSet::opCodes[op].instruction, InstructionSet::opCodes[op].addressingMode
+#define SUPER_INSTRUCTION_PAIR(op0, op1) { 2, { op0, op1, 0 }, &Cpu2a03::superInstructionPair<SUPER_OPCODE(op0), SUPER_OPCODE(op1)> }
+#define SUPER_INSTRUCTION_TRIPLE(op0, op1, op2) \
+    { 3, { op0, op1, op2 }, &Cpu2a03::superInstructionTriple<SUPER_OPCODE(op0), SUPER_OPCODE(op1), SUPER_OPCODE(op2)> }
+
+    void Cpu2a03::findSuperInstructions(CachedBlock &block) {
+        struct SuperInstructionPattern {
+            uint8_t length;
+            uint8_t opCodes[3];
+            SuperInstructionFnPtr run;
+        };
+        // Longest patterns first
+        static const SuperInstructionPattern patterns[] = {
+            // counters: INC zp / LDA zp / CMP #
+            SUPER_INSTRUCTION_TRIPLE(0xe6, 0xa5, 0xc9),
+            // vblank and sprite 0 polls: LDA abs / BPL|BMI, BIT abs / BPL|BMI
+            SUPER_INSTRUCTION_PAIR(0xad, 0x10),
+            SUPER_INSTRUCTION_PAIR(0xad, 0x30),
+            SUPER_INSTRUCTION_PAIR(0x2c, 0x10),
+            SUPER_INSTRUCTION_PAIR(0x2c, 0x30),
+            // delay loops: DEX|DEY / BNE
+            SUPER_INSTRUCTION_PAIR(0xca, 0xd0),
+            SUPER_INSTRUCTION_PAIR(0x88, 0xd0),
+            // compare chains: CMP # / BEQ|BNE
+            SUPER_INSTRUCTION_PAIR(0xc9, 0xf0),
+            SUPER_INSTRUCTION_PAIR(0xc9, 0xd0),
+        };
+
+        for (uint8_t i = 0; i < block.numInstructions; i++) {
+            for (const SuperInstructionPattern &pattern : patterns) {
+                if (i + pattern.length > block.numInstructions) {
+                    continue;
+                }
+
+                bool match = true;
+                for (uint8_t j = 0; j < pattern.length && match; j++) {
+                    match = block.instructions[i + j].opCode->opCode == pattern.opCodes[j];
+                }
+                if (match) {
+                    block.instructions[i].superInstruction = pattern.run;
+                    break;
+                }
+            }
+        }
+    }
+
+#undef SUPER_INSTRUCTION_TRIPLE
+#undef SUPER_INSTRUCTION_PAIR
+#undef SUPER_OPCODE
+
+    ///////////////////////////////////////////////////////////////////////
+    // Recompiled code
+    //
+    // The static recompiler emits a call to the specialization for each instruction's op code.  The op code and
+    // operands are constants there, so all that's left at run time is the bus activity.
+
+    template<uint8_t op>
+    uint8_t Cpu2a03::executeFusedOpCode(uint8_t operand0, uint8_t operand1) {
+        DecodedInstruction decoded;
+        decoded.opCode = &InstructionSet::opCodes[op];
+        decoded.address = registers.programCounter;
+        decoded.operands[0] = operand0;
+        decoded.operands[1] = operand1;
+
+        fetchDecodedOpCode(decoded);
+        uint8_t cyclesTaken = runDecodedInstruction<InstructionSet::opCodes[op].instruction, InstructionSet::opCodes[op].addressingMode>(decoded);
+
+        catchUpPpu();
+        cycle += cyclesTaken;
+        return cyclesTaken;
     }
 
+    // Defined here for recompiled code, which only has the declaration
+#define EXECUTE_FUSED_OPCODE(op) template uint8_t Cpu2a03::executeFusedOpCode<op>(uint8_t operand0, uint8_t operand1)
+#define EXECUTE_FUSED_OPCODE_ROW(row) \
+    EXECUTE_FUSED_OPCODE(row + 0x0); EXECUTE_FUSED_OPCODE(row + 0x1); EXECUTE_FUSED_OPCODE(row + 0x2); EXECUTE_FUSED_OPCODE(row + 0x3); \
+    EXECUTE_FUSED_OPCODE(row + 0x4); EXECUTE_FUSED_OPCODE(row + 0x5); EXECUTE_FUSED_OPCODE(row + 0x6); EXECUTE_FUSED_OPCODE(row + 0x7); \
+    EXECUTE_FUSED_OPCODE(row + 0x8); EXECUTE_FUSED_OPCODE(row + 0x9); EXECUTE_FUSED_OPCODE(row + 0xa); EXECUTE_FUSED_OPCODE(row + 0xb); \
+    EXECUTE_FUSED_OPCODE(row + 0xc); EXECUTE_FUSED_OPCODE(row + 0xd); EXECUTE_FUSED_OPCODE(row + 0xe); EXECUTE_FUSED_OPCODE(row + 0xf)
+
+    EXECUTE_FUSED_OPCODE_ROW(0x00); EXECUTE_FUSED_OPCODE_ROW(0x10); EXECUTE_FUSED_OPCODE_ROW(0x20); EXECUTE_FUSED_OPCODE_ROW(0x30);
+    EXECUTE_FUSED_OPCODE_ROW(0x40); EXECUTE_FUSED_OPCODE_ROW(0x50); EXECUTE_FUSED_OPCODE_ROW(0x60); EXECUTE_FUSED_OPCODE_ROW(0x70);
+    EXECUTE_FUSED_OPCODE_ROW(0x80); EXECUTE_FUSED_OPCODE_ROW(0x90); EXECUTE_FUSED_OPCODE_ROW(0xa0); EXECUTE_FUSED_OPCODE_ROW(0xb0);
+    EXECUTE_FUSED_OPCODE_ROW(0xc0); EXECUTE_FUSED_OPCODE_ROW(0xd0); EXECUTE_FUSED_OPCODE_ROW(0xe0); EXECUTE_FUSED_OPCODE_ROW(0xf0);
+
+#undef EXECUTE_FUSED_OPCODE_ROW
+#undef EXECUTE_FUSED_OPCODE
 }
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include <ControlDeck/CPU/FlagLiveness.h>
+#include <ControlDeck/CPU/StaticRecompiler.h>
+
+namespace NES {
+    const uint8_t FlagLiveness::allFlags;
+
+    static const uint8_t carry = 1 << ProcessorStatus::CarryFlag;
+    static const uint8_t zero = 1 << ProcessorStatus::ZeroFlag;
+    static const uint8_t overflow = 1 << ProcessorStatus::OverflowFlag;
+    static const uint8_t negative = 1 << ProcessorStatus::NegativeFlag;
+
+    // Flags an instruction reads (uses) and writes (defines)
+    static void getFlagEffects(Instruction instruction, uint8_t &uses, uint8_t &defines) {
+        uses = 0;
+        defines = 0;
+        switch (instruction) {
+        case Instruction::LDA: case Instruction::LDX: case Instruction::LDY:
+        case Instruction::TAX: case Instruction::TAY: case Instruction::TXA: case Instruction::TYA:
+        case Instruction::TSX: case Instruction::PLA:
+        case Instruction::AND: case Instruction::EOR: case Instruction::ORA:
+        case Instruction::INC: case Instruction::INX: case Instruction::INY:
+        case Instruction::DEC: case Instruction::DEX: case Instruction::DEY:
+            defines = negative | zero;
+            break;
+        case Instruction::BIT:
+            defines = negative | overflow | zero;
+            break;
+        case Instruction::ADC: case Instruction::SBC:
+            uses = carry;
+            defines = negative | overflow | zero | carry;
+            break;
+        case Instruction::CMP: case Instruction::CPX: case Instruction::CPY:
+        case Instruction::ASL: case Instruction::LSR:
+            defines = negative | zero | carry;
+            break;
+        case Instruction::ROL: case Instruction::ROR:
+            uses = carry;
+            defines = negative | zero | carry;
+            break;
+        case Instruction::BCC: case Instruction::BCS:
+            uses = carry;
+            break;
+        case Instruction::BEQ: case Instruction::BNE:
+            uses = zero;
+            break;
+        case Instruction::BMI: case Instruction::BPL:
+            uses = negative;
+            break;
+        case Instruction::BVC: case Instruction::BVS:
+            uses = overflow;
+            break;
+        case Instruction::CLC: case Instruction::SEC:
+            defines = carry;
+            break;
+        case Instruction::CLV:
+            defines = overflow;
+            break;
+        case Instruction::PLP: case Instruction::RTI:
+            defines = FlagLiveness::allFlags;
+            break;
+        case Instruction::PHP: case Instruction::BRK: case Instruction::UNK:
+            // P is pushed where anything can read it
+            uses = FlagLiveness::allFlags;
+            break;
+        default:
+            break;
+        }
+    }
+
+    static bool isPrgRomAddress(uint32_t address) {
+        return address >= 0x8000 && address <= 0xffff;
+    }
+
+    // Live flags on entry to the handler at vector, everything if it isn't in the walked code
+    static uint8_t getHandlerLiveFlags(Cpu2a03 &cpu, const ControlFlowGraph &graph, const std::vector<uint8_t> &liveIn, uint16_t vector) {
+        uint16_t handler = cpu.peekCodeByte(vector) | (cpu.peekCodeByte(vector + 1) << 8);
+        return graph.contains(handler) ? liveIn[handler - 0x8000] : FlagLiveness::allFlags;
+    }
+
+    void FlagLiveness::analyse(Cpu2a03 &cpu, std::vector<uint8_t> &liveFlags) {
+        liveFlags.assign(prgRomSize, allFlags);
+        ControlFlowGraph graph;
+        graph.build(cpu);
+
+        // Live flags before each instruction.  Grows from nothing until no instruction changes.
+        std::vector<uint8_t> liveIn(prgRomSize, 0);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            // an interrupt can run its handler after any instruction
+            uint8_t interruptLive = getHandlerLiveFlags(cpu, graph, liveIn, 0xfffa) | getHandlerLiveFlags(cpu, graph, liveIn, 0xfffe);
+
+            // backwards, so straight-line code settles in one pass
+            for (auto it = graph.instructions.rbegin(); it != graph.instructions.rend(); ++it) {
+                const RecompiledInstruction &instruction = it->second;
+                const OpCode &opCode = InstructionSet::opCodes[instruction.opCode];
+                uint16_t operand = instruction.operands[0] | (instruction.operands[1] << 8);
+                uint32_t next = instruction.address + instruction.length;
+
+                // Where execution can go next, up to two places.  Unknown successors leave every flag live.
+                uint32_t successors[2] = { next, 0 };
+                uint8_t numSuccessors = 1;
+                bool unknownSuccessor = false;
+                if (opCode.addressingMode == AddressingMode::Relative) {
+                    successors[1] = (uint16_t)(next + (int8_t)instruction.operands[0]);
+                    numSuccessors = 2;
+                } else if (opCode.instruction == Instruction::JSR) {
+                    // the return address is only reached through RTS
+                    successors[0] = operand;
+                } else if (opCode.instruction == Instruction::JMP) {
+                    if (opCode.addressingMode == AddressingMode::Absolute) {
+                        successors[0] = operand;
+                    } else if (isPrgRomAddress(operand) && isPrgRomAddress(operand + 1u)) {
+                        successors[0] = cpu.peekCodeByte(operand) | (cpu.peekCodeByte(operand + 1) << 8);
+                    } else {
+                        unknownSuccessor = true;
+                    }
+                } else if (opCode.instruction == Instruction::RTS || opCode.instruction == Instruction::RTI ||
+                    opCode.instruction == Instruction::BRK) {
+                    unknownSuccessor = true;
+                }
+
+                uint8_t liveOut = interruptLive;
+                for (uint8_t i = 0; i < numSuccessors && !unknownSuccessor; i++) {
+                    if (!isPrgRomAddress(successors[i]) || !graph.contains((uint16_t)successors[i])) {
+                        unknownSuccessor = true;
+                    } else {
+                        liveOut |= liveIn[successors[i] - 0x8000];
+                    }
+                }
+                if (unknownSuccessor) {
+                    liveOut = allFlags;
+                }
+
+                uint8_t uses, defines;
+                getFlagEffects(opCode.instruction, uses, defines);
+                size_t index = instruction.address - 0x8000;
+                uint8_t newLiveIn = uses | (liveOut & ~defines);
+                liveFlags[index] = liveOut;
+                if (newLiveIn != liveIn[index]) {
+                    liveIn[index] = newLiveIn;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    FlagLiveness::FlagLiveness(const FlagLiveness &other) {
+        *this = other;
+    }
+
+    FlagLiveness &FlagLiveness::operator=(const FlagLiveness &other) {
+        bankLiveFlags = other.bankLiveFlags;
+        current = nullptr;
+        currentBankState = 0;
+        bankSwitches = other.bankSwitches;
+        analyses = other.analyses;
+        return *this;
+    }
+
+    uint8_t FlagLiveness::getLiveFlags(Cpu2a03 &cpu, uint16_t address) {
+        if (address < 0x8000) {
+            return allFlags;
+        }
+
+        uint32_t bankState = cpu.getPrgBankState();
+        if (current == nullptr || bankState != currentBankState) {
+            // bank switch, or the first instruction out of ROM
+            auto found = bankLiveFlags.find(bankState);
+            if (found == bankLiveFlags.end()) {
+                if (bankLiveFlags.size() == maxBankStates) {
+                    auto leastRecent = bankLiveFlags.begin();
+                    for (auto entry = bankLiveFlags.begin(); entry != bankLiveFlags.end(); ++entry) {
+                        if (entry->second.lastUsed < leastRecent->second.lastUsed) {
+                            leastRecent = entry;
+                        }
+                    }
+                    bankLiveFlags.erase(leastRecent);
+                }
+                found = bankLiveFlags.emplace(bankState, BankLiveFlags{}).first;
+                analyse(cpu, found->second.liveFlags);
+                analyses++;
+            }
+            found->second.lastUsed = ++bankSwitches;
+            current = &found->second.liveFlags;
+            currentBankState = bankState;
+        }
+        return (*current)[address - 0x8000];
+    }
+
+    void FlagLiveness::flush() {
+        bankLiveFlags.clear();
+        current = nullptr;
+        currentBankState = 0;
+    }
+}
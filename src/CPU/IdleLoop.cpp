@@ -0,0 +1,123 @@
+#include <ControlDeck/CPU/cpu2A03.h>
+
+namespace NES {
+    namespace {
+        bool isPpuStatusAddress(uint16_t address) {
+            return address >= 0x2000 && address < 0x4000 && (address & 0x7) == (uint8_t)PPURegister::STATUS;
+        }
+
+        // Where an instruction jumps or branches to, -1 if it doesn't
+        int32_t getLoopTarget(const DecodedInstruction &decoded) {
+            if (decoded.opCode->instruction == Instruction::JMP && decoded.opCode->addressingMode == AddressingMode::Absolute) {
+                return decoded.operands[0] | (decoded.operands[1] << 8);
+            }
+            if (decoded.opCode->addressingMode == AddressingMode::Relative) {
+                return (uint16_t)(decoded.address + 2 + (int8_t)decoded.operands[0]);
+            }
+            return -1;
+        }
+    }
+
+    /**
+    *   A block is an idle loop when it ends by jumping or branching back to its own start and everything before that
+    *   only reads system RAM or immediates into registers and flags (loads, compares, BIT and AND).  Repeating such an
+    *   iteration gives the same registers and flags as long as what it reads doesn't change, and RAM only changes
+    *   when the CPU writes it (the NMI handler).
+    *
+    *   PPUSTATUS can be read right before a BPL back to the start.  The branch is only taken when vblank was clear so
+    *   the read doesn't change anything the next iteration sees.
+    */
+    void Cpu2a03::findIdleLoop(CachedBlock &block) {
+        const DecodedInstruction &last = block.instructions[block.numInstructions - 1];
+        if (getLoopTarget(last) != block.startAddress) {
+            return;
+        }
+
+        for (uint8_t i = 0; i + 1 < block.numInstructions; i++) {
+            const DecodedInstruction &decoded = block.instructions[i];
+            switch (decoded.opCode->instruction) {
+            case Instruction::LDA:
+            case Instruction::LDX:
+            case Instruction::LDY:
+            case Instruction::BIT:
+            case Instruction::CMP:
+            case Instruction::CPX:
+            case Instruction::CPY:
+            case Instruction::AND:
+                break;
+            default:
+                return;
+            }
+
+            uint16_t address = decoded.operands[0] | (decoded.operands[1] << 8);
+            switch (decoded.opCode->addressingMode) {
+            case AddressingMode::Immediate:
+            case AddressingMode::ZeroPage:
+                break;
+            case AddressingMode::Absolute:
+                if (address < 0x2000) {
+                    break;
+                }
+                if (isPpuStatusAddress(address) && i + 2 == block.numInstructions && last.opCode->instruction == Instruction::BPL) {
+                    break;
+                }
+                return;
+            default:
+                return;
+            }
+        }
+
+        block.instructions[0].idleLoopLength = block.numInstructions;
+        idleLoopStats.loopsDetected++;
+    }
+
+    uint32_t Cpu2a03::runIdleLoop(const DecodedInstruction *loop, uint32_t &instructionCount) {
+        catchUpPpu();
+        uint64_t ppuCycleStart = ppu->getCycle();
+        uint32_t ppuCyclesUntilEvent = ppu->getCyclesUntilNmiEvent();
+        // PPU time in 1/cpuClocks of a PPU cycle, including the fraction synchronizeProcessors carries (PAL).  Every
+        // bus cycle adds ppuClocks of these.
+        uint64_t ppuPhaseStart = ppuCycleStart * CpuVariant::cpuClocks + ppuClockPhase;
+
+        // One real iteration
+        uint32_t iterationCycles = 0;
+        instructionCount = 0;
+        for (uint8_t i = 0; i < loop->idleLoopLength; i++) {
+            if (i > 0 && !continueSequence(loop[i])) {
+                return iterationCycles;
+            }
+            OpCodeArgs args = OpCodeArgs();
+            decodedInstruction = &loop[i];
+            uint8_t branchCycles = fusedOpCodes[loop[i].opCode->opCode](*this, args);
+            decodedInstruction = nullptr;
+            iterationCycles += loop[i].opCode->cycles + branchCycles + args.pagingCycles;
+            instructionCount++;
+        }
+
+        // It has to have come back around with nothing it read able to change during the iteration
+        catchUpPpu();
+        if (registers.programCounter != loop->address || ppu->disabled || interrupts.isPending() ||
+            ppu->getCycle() - ppuCycleStart > ppuCyclesUntilEvent) {
+            return iterationCycles;
+        }
+
+        // Every iteration which fits before vblank is raised or cleared reads the same values and leaves the same
+        // state.  An iteration is the same number of bus cycles each time round (counting the op code fetch made
+        // before the loop was recognized), but on PAL not always the same number of PPU cycles, so count in phase.
+        uint64_t iterationPhase = ppu->getCycle() * CpuVariant::cpuClocks + ppuClockPhase - ppuPhaseStart + CpuVariant::ppuClocks;
+        uint64_t phaseUntilEvent = ((uint64_t)ppu->getCyclesUntilNmiEvent() + 1) * CpuVariant::cpuClocks - 1 - ppuClockPhase;
+        uint32_t iterations = (uint32_t)(phaseUntilEvent / iterationPhase);
+        if (iterations == 0) {
+            return iterationCycles;
+        }
+        uint64_t skippedPhase = ppuClockPhase + iterations * iterationPhase;
+        ppu->advance((uint32_t)(skippedPhase / CpuVariant::cpuClocks));
+        ppuClockPhase = (uint32_t)(skippedPhase % CpuVariant::cpuClocks);
+
+        instructionCount += iterations * loop->idleLoopLength;
+        idleLoopStats.fastForwards++;
+        idleLoopStats.iterationsSkipped += iterations;
+        idleLoopStats.cyclesSkipped += (uint64_t)iterations * iterationCycles;
+        return iterationCycles * (iterations + 1);
+    }
+}
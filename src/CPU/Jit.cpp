@@ -0,0 +1,945 @@
+#include <ControlDeck/CPU/Jit.h>
+#include <ControlDeck/common.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CONTROLDECK_JIT_X64
+#endif
+
+#ifdef CONTROLDECK_JIT_X64
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+namespace NES {
+    ///////////////////////////////////////////////////////////////////////
+    // Calls made from generated code
+
+    static void catchUpPpu(JitContext *ctx) {
+        for (; ctx->pendingBusCycles > 0; ctx->pendingBusCycles--) {
+            ctx->cpu->synchronizeProcessors();
+        }
+    }
+
+    // I/O and mapper reads.  doMemoryOperation runs the PPU for the access itself.
+    static uint32_t jitRead(JitContext *ctx, uint32_t address) {
+        catchUpPpu(ctx);
+        Cpu2a03 &cpu = *ctx->cpu;
+        cpu.systemBus.addressBus = (uint16_t)address;
+        cpu.systemBus.read = true;
+        cpu.doMemoryOperation();
+        return cpu.systemBus.dataBus;
+    }
+
+    static void jitWrite(JitContext *ctx, uint32_t address, uint32_t value) {
+        catchUpPpu(ctx);
+        Cpu2a03 &cpu = *ctx->cpu;
+        cpu.systemBus.addressBus = (uint16_t)address;
+        cpu.systemBus.dataBus = (uint8_t)value;
+        cpu.systemBus.read = false;
+        cpu.doMemoryOperation();
+    }
+
+    // RAM write landed on a page the block cache has decoded code from
+    static void jitInvalidateRamPage(JitContext *ctx, uint32_t ramAddress) {
+        ctx->cpu->blockCache.invalidateRamPage(ramAddress);
+    }
+
+#ifdef CONTROLDECK_JIT_X64
+    namespace {
+        enum HostReg { RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+        // 6502 registers live in callee saved host registers for the whole block
+        const HostReg regA = R12;
+        const HostReg regX = R13;
+        const HostReg regY = R14;
+        const HostReg regP = R15;
+        const HostReg regContext = RBX;
+        const HostReg regRam = RBP;
+
+#ifdef _WIN32
+        const HostReg argRegs[3] = { RCX, RDX, R8 };
+#else
+        const HostReg argRegs[3] = { RDI, RSI, RDX };
+#endif
+        // pushes + this keep the stack 16 byte aligned and leave the 32 byte shadow space win64 calls want
+        const uint8_t frameSize = 40;
+
+        // opcode for op r/m32, r32
+        enum AluOp { OP_ADD = 0x01, OP_OR = 0x09, OP_AND = 0x21, OP_SUB = 0x29, OP_XOR = 0x31, OP_CMP = 0x39, OP_TEST = 0x85 };
+        // /digit for op r/m32, imm32
+        enum AluImm { IMM_ADD = 0, IMM_OR = 1, IMM_AND = 4, IMM_SUB = 5, IMM_XOR = 6, IMM_CMP = 7 };
+        enum Shift { SHIFT_SHL = 4, SHIFT_SHR = 5 };
+        enum Condition { CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5 };
+
+        /**
+        *   Just enough of an x86-64 assembler for the recompiler.  All register operations are 32 bit which keeps the
+        *   upper halves of the host registers clear.
+        */
+        class X64Emitter {
+        public:
+            std::vector<uint8_t> code;
+
+            void byte(uint8_t b) { code.push_back(b); }
+            void dword(uint32_t d) {
+                for (int i = 0; i < 4; i++) {
+                    byte((d >> (i * 8)) & 0xff);
+                }
+            }
+            void qword(uint64_t q) {
+                dword((uint32_t)q);
+                dword((uint32_t)(q >> 32));
+            }
+
+            void rex(bool w, int reg, int index, int base, bool force = false) {
+                uint8_t prefix = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((index & 8) ? 2 : 0) | ((base & 8) ? 1 : 0);
+                if (prefix != 0x40 || force) {
+                    byte(prefix);
+                }
+            }
+            void modrmReg(int reg, int rm) {
+                byte(0xc0 | ((reg & 7) << 3) | (rm & 7));
+            }
+            // [base + disp32]
+            void modrmMem(int reg, int base, int32_t disp) {
+                if ((base & 7) == RSP) {
+                    byte(0x80 | ((reg & 7) << 3) | 4);
+                    byte(0x24);
+                } else {
+                    byte(0x80 | ((reg & 7) << 3) | (base & 7));
+                }
+                dword(disp);
+            }
+            // [base + index + disp32]
+            void modrmSib(int reg, int base, int index, int32_t disp) {
+                byte(0x80 | ((reg & 7) << 3) | 4);
+                byte(((index & 7) << 3) | (base & 7));
+                dword(disp);
+            }
+
+            void movRR(HostReg dst, HostReg src) { rex(false, src, 0, dst); byte(0x89); modrmReg(src, dst); }
+            void movRR64(HostReg dst, HostReg src) { rex(true, src, 0, dst); byte(0x89); modrmReg(src, dst); }
+            void movRI(HostReg dst, uint32_t imm) { rex(false, 0, 0, dst); byte(0xb8 + (dst & 7)); dword(imm); }
+            void movRI64(HostReg dst, uint64_t imm) { rex(true, 0, 0, dst); byte(0xb8 + (dst & 7)); qword(imm); }
+            void load32(HostReg dst, HostReg base, int32_t disp) { rex(false, dst, 0, base); byte(0x8b); modrmMem(dst, base, disp); }
+            void load64(HostReg dst, HostReg base, int32_t disp) { rex(true, dst, 0, base); byte(0x8b); modrmMem(dst, base, disp); }
+            void store32(HostReg base, int32_t disp, HostReg src) { rex(false, src, 0, base); byte(0x89); modrmMem(src, base, disp); }
+            void store32I(HostReg base, int32_t disp, uint32_t imm) { rex(false, 0, 0, base); byte(0xc7); modrmMem(0, base, disp); dword(imm); }
+            void movzx8(HostReg dst, HostReg base, int32_t disp) { rex(false, dst, 0, base); byte(0x0f); byte(0xb6); modrmMem(dst, base, disp); }
+            void movzx8(HostReg dst, HostReg base, HostReg index, int32_t disp) {
+                rex(false, dst, index, base); byte(0x0f); byte(0xb6); modrmSib(dst, base, index, disp);
+            }
+            void movzxRR8(HostReg dst, HostReg src) { rex(false, dst, 0, src, src >= RSP); byte(0x0f); byte(0xb6); modrmReg(dst, src); }
+            void store8(HostReg base, int32_t disp, HostReg src) { rex(false, src, 0, base, src >= RSP); byte(0x88); modrmMem(src, base, disp); }
+            void store8(HostReg base, HostReg index, int32_t disp, HostReg src) {
+                rex(false, src, index, base, src >= RSP); byte(0x88); modrmSib(src, base, index, disp);
+            }
+            void alu(AluOp op, HostReg dst, HostReg src) { rex(false, src, 0, dst); byte(op); modrmReg(src, dst); }
+            void alu(AluImm op, HostReg dst, uint32_t imm) { rex(false, 0, 0, dst); byte(0x81); modrmReg(op, dst); dword(imm); }
+            void aluMem(AluOp op, HostReg base, int32_t disp, HostReg src) { rex(false, src, 0, base); byte(op); modrmMem(src, base, disp); }
+            void aluMem(AluImm op, HostReg base, int32_t disp, uint32_t imm) { rex(false, 0, 0, base); byte(0x81); modrmMem(op, base, disp); dword(imm); }
+            void cmpMem8(HostReg base, int32_t disp, uint8_t imm) { rex(false, 0, 0, base); byte(0x80); modrmMem(IMM_CMP, base, disp); byte(imm); }
+            void test(HostReg dst, uint32_t imm) { rex(false, 0, 0, dst); byte(0xf7); modrmReg(0, dst); dword(imm); }
+            void shift(Shift op, HostReg dst, uint8_t count) { rex(false, 0, 0, dst); byte(0xc1); modrmReg(op, dst); byte(count); }
+            void setcc(Condition cc, HostReg dst) { rex(false, 0, 0, dst, dst >= RSP); byte(0x0f); byte(0x90 + cc); modrmReg(0, dst); }
+            void push(HostReg r) { rex(false, 0, 0, r); byte(0x50 + (r & 7)); }
+            void pop(HostReg r) { rex(false, 0, 0, r); byte(0x58 + (r & 7)); }
+            void subRsp(uint8_t imm) { byte(0x48); byte(0x83); byte(0xec); byte(imm); }
+            void addRsp(uint8_t imm) { byte(0x48); byte(0x83); byte(0xc4); byte(imm); }
+            void ret() { byte(0xc3); }
+
+            void call(const void *fn) {
+                movRI64(RAX, (uint64_t)(uintptr_t)fn);
+                byte(0xff);
+                byte(0xd0);
+            }
+
+            // Forward jumps: returns the location to hand to patch() once the target is known
+            size_t jcc(Condition cc) { byte(0x0f); byte(0x80 + cc); dword(0); return code.size() - 4; }
+            void patch(size_t at) {
+                uint32_t rel = (uint32_t)(code.size() - (at + 4));
+                memcpy(&code[at], &rel, sizeof(rel));
+            }
+        };
+
+        // Where an instruction's operand comes from (or goes to)
+        enum class Target {
+            None,
+            Immediate,
+            Ram,            // fixed RAM address, accessed directly
+            RamIndexed,     // base + index which always stays inside $0000-$1fff
+            Rom,            // fixed PRG-ROM address: reads are folded into a constant
+            RomIndexed,     // base + index which always stays inside PRG-ROM: read through the mapper
+            Io,             // PPU/APU registers, expansion, SRAM or mapper writes: always through doMemoryOperation
+        };
+
+        struct Operand {
+            Target target{ Target::None };
+            uint16_t address{ 0 };
+            HostReg index{ RAX };
+            uint8_t value{ 0 };     // immediate or folded PRG-ROM byte
+        };
+
+        struct DecodedOp {
+            const OpCode *opCode;
+            uint16_t address;
+            uint16_t next;
+            uint8_t operands[2];
+            Operand operand;
+        };
+
+        bool isSupportedInstruction(const OpCode &opCode) {
+            switch (opCode.instruction) {
+            case Instruction::LDA: case Instruction::LDX: case Instruction::LDY:
+            case Instruction::STA: case Instruction::STX: case Instruction::STY:
+            case Instruction::TAX: case Instruction::TAY: case Instruction::TXA: case Instruction::TYA:
+            case Instruction::TSX: case Instruction::TXS:
+            case Instruction::AND: case Instruction::EOR: case Instruction::ORA: case Instruction::BIT:
+            case Instruction::CMP: case Instruction::CPX: case Instruction::CPY:
+            case Instruction::INC: case Instruction::INX: case Instruction::INY:
+            case Instruction::DEC: case Instruction::DEX: case Instruction::DEY:
+            case Instruction::BCC: case Instruction::BCS: case Instruction::BEQ: case Instruction::BMI:
+            case Instruction::BNE: case Instruction::BPL: case Instruction::BVC: case Instruction::BVS:
+            case Instruction::CLC: case Instruction::CLD: case Instruction::CLI: case Instruction::CLV:
+            case Instruction::SEC: case Instruction::SED: case Instruction::SEI:
+            case Instruction::NOP:
+                return true;
+            case Instruction::ASL: case Instruction::LSR: case Instruction::ROL:
+                // the memory forms write the unshifted value back in the interpreter.  Leave them there so
+                // differential runs compare like with like.
+                return opCode.addressingMode == AddressingMode::Accumulator;
+            case Instruction::JMP:
+                return opCode.addressingMode == AddressingMode::Absolute;
+            default:
+                // ADC/SBC/ROR have open issues in their handlers, stack and interrupt instructions aren't worth it
+                return false;
+            }
+        }
+
+        bool isStore(Instruction instruction) {
+            return instruction == Instruction::STA || instruction == Instruction::STX || instruction == Instruction::STY;
+        }
+
+        bool isReadModifyWrite(Instruction instruction) {
+            return instruction == Instruction::INC || instruction == Instruction::DEC;
+        }
+
+        class BlockCompiler {
+        public:
+            BlockCompiler(X64Emitter &e) : e(e) {}
+
+            void prologue() {
+                e.push(RBX);
+                e.push(RBP);
+                e.push(R12);
+                e.push(R13);
+                e.push(R14);
+                e.push(R15);
+                e.subRsp(frameSize);
+                e.movRR64(regContext, argRegs[0]);
+                e.load64(regRam, regContext, offsetof(JitContext, ram));
+                e.load32(regA, regContext, offsetof(JitContext, a));
+                e.load32(regX, regContext, offsetof(JitContext, x));
+                e.load32(regY, regContext, offsetof(JitContext, y));
+                e.load32(regP, regContext, offsetof(JitContext, p));
+            }
+
+            /**
+            *   Leave the block with the program counter at pc.  extraBusCycles/extraCycles are for a taken branch which
+            *   leaves in the middle of the block.
+            */
+            void exit(uint16_t pc, uint32_t retired, uint32_t extraBusCycles = 0, uint32_t extraCycles = 0) {
+                if (busCycles + extraBusCycles > 0) {
+                    e.aluMem(IMM_ADD, regContext, offsetof(JitContext, pendingBusCycles), busCycles + extraBusCycles);
+                }
+                e.aluMem(IMM_ADD, regContext, offsetof(JitContext, cycles), cycles + extraCycles);
+                e.store32I(regContext, offsetof(JitContext, instructions), retired);
+                e.store32I(regContext, offsetof(JitContext, pc), pc);
+                e.store32(regContext, offsetof(JitContext, a), regA);
+                e.store32(regContext, offsetof(JitContext, x), regX);
+                e.store32(regContext, offsetof(JitContext, y), regY);
+                e.store32(regContext, offsetof(JitContext, p), regP);
+                e.addRsp(frameSize);
+                e.pop(R15);
+                e.pop(R14);
+                e.pop(R13);
+                e.pop(R12);
+                e.pop(RBP);
+                e.pop(RBX);
+                e.ret();
+            }
+
+            // Returns false if the instruction ends the block (the exit has been emitted)
+            bool instruction(const DecodedOp &op, uint32_t retiredBefore) {
+                const OpCode &opCode = *op.opCode;
+                const Operand &operand = op.operand;
+                uint32_t retired = retiredBefore + 1;
+
+                // op code and operand fetches
+                busCycles += 1 + addressingModeProgramCounterDelta[opCode.addressingMode];
+                maxBusCycles += 1 + addressingModeProgramCounterDelta[opCode.addressingMode];
+                cycles += opCode.cycles;
+
+                if (operand.target == Target::RamIndexed || operand.target == Target::RomIndexed) {
+                    // same page crossing rule as getXIndexedAbsoluteAddress
+                    e.movRR(RDX, operand.index);
+                    e.alu(IMM_ADD, RDX, operand.address & 0xff);
+                    e.alu(IMM_CMP, RDX, 0xff);
+                    e.setcc(CC_AE, RDX);
+                    e.movzxRR8(RDX, RDX);
+                    e.aluMem(OP_ADD, regContext, offsetof(JitContext, cycles), RDX);
+                }
+
+                // Addressing modes which resolve to an address read it, stores included.
+                if (operand.target == Target::Immediate) {
+                    e.movRI(RAX, operand.value);
+                } else if (operand.target != Target::None) {
+                    read();
+                }
+
+                switch (opCode.instruction) {
+                case Instruction::LDA: e.movRR(regA, RAX); setNZ(regA); break;
+                case Instruction::LDX: e.movRR(regX, RAX); setNZ(regX); break;
+                case Instruction::LDY: e.movRR(regY, RAX); setNZ(regY); break;
+                case Instruction::STA: write(regA); break;
+                case Instruction::STX: write(regX); break;
+                case Instruction::STY: write(regY); break;
+
+                case Instruction::TAX: e.movRR(regX, regA); setNZ(regX); break;
+                case Instruction::TAY: e.movRR(regY, regA); setNZ(regY); break;
+                case Instruction::TXA: e.movRR(regA, regX); setNZ(regA); break;
+                case Instruction::TYA: e.movRR(regA, regY); setNZ(regA); break;
+                case Instruction::TSX: e.load32(regX, regContext, offsetof(JitContext, sp)); setNZ(regX); break;
+                case Instruction::TXS: e.store32(regContext, offsetof(JitContext, sp), regX); break;
+
+                case Instruction::AND: e.alu(OP_AND, regA, RAX); setNZ(regA); break;
+                case Instruction::ORA: e.alu(OP_OR, regA, RAX); setNZ(regA); break;
+                case Instruction::EOR: e.alu(OP_XOR, regA, RAX); setNZ(regA); break;
+                case Instruction::BIT:
+                    e.alu(IMM_AND, regP, 0x3d);
+                    e.movRR(RDX, regA);
+                    e.alu(OP_AND, RDX, RAX);
+                    e.alu(OP_TEST, RDX, RDX);
+                    e.setcc(CC_E, RCX);
+                    e.movzxRR8(RCX, RCX);
+                    e.shift(SHIFT_SHL, RCX, 1);
+                    e.alu(OP_OR, regP, RCX);
+                    e.alu(IMM_AND, RAX, 0xc0);
+                    e.alu(OP_OR, regP, RAX);
+                    break;
+
+                case Instruction::CMP: compare(regA); break;
+                case Instruction::CPX: compare(regX); break;
+                case Instruction::CPY: compare(regY); break;
+
+                case Instruction::INC: increment(RAX, 1); write(RAX); break;
+                case Instruction::DEC: increment(RAX, 0xff); write(RAX); break;
+                case Instruction::INX: increment(regX, 1); break;
+                case Instruction::INY: increment(regY, 1); break;
+                case Instruction::DEX: increment(regX, 0xff); break;
+                case Instruction::DEY: increment(regY, 0xff); break;
+
+                case Instruction::ASL:
+                    e.movRR(RCX, regA);
+                    e.shift(SHIFT_SHR, RCX, 7);
+                    setCarry(RCX);
+                    e.shift(SHIFT_SHL, regA, 1);
+                    e.alu(IMM_AND, regA, 0xff);
+                    setNZ(regA);
+                    break;
+                case Instruction::LSR:
+                    e.movRR(RCX, regA);
+                    e.alu(IMM_AND, RCX, 1);
+                    setCarry(RCX);
+                    e.shift(SHIFT_SHR, regA, 1);
+                    setNZ(regA);
+                    break;
+                case Instruction::ROL:
+                    e.movRR(RDX, regP);
+                    e.alu(IMM_AND, RDX, 1);
+                    e.movRR(RCX, regA);
+                    e.shift(SHIFT_SHR, RCX, 7);
+                    setCarry(RCX);
+                    e.shift(SHIFT_SHL, regA, 1);
+                    e.alu(OP_OR, regA, RDX);
+                    e.alu(IMM_AND, regA, 0xff);
+                    setNZ(regA);
+                    break;
+
+                case Instruction::CLC: e.alu(IMM_AND, regP, ~(1u << ProcessorStatus::CarryFlag) & 0xff); break;
+                case Instruction::CLD: e.alu(IMM_AND, regP, ~(1u << ProcessorStatus::DecimalMode) & 0xff); break;
+                case Instruction::CLI: e.alu(IMM_AND, regP, ~(1u << ProcessorStatus::InterruptDisable) & 0xff); break;
+                case Instruction::CLV: e.alu(IMM_AND, regP, ~(1u << ProcessorStatus::OverflowFlag) & 0xff); break;
+                case Instruction::SEC: e.alu(IMM_OR, regP, 1u << ProcessorStatus::CarryFlag); break;
+                case Instruction::SED: e.alu(IMM_OR, regP, 1u << ProcessorStatus::DecimalMode); break;
+                case Instruction::SEI: e.alu(IMM_OR, regP, 1u << ProcessorStatus::InterruptDisable); break;
+                case Instruction::NOP: break;
+
+                case Instruction::BCC: branch(op, ProcessorStatus::CarryFlag, false, retired); break;
+                case Instruction::BCS: branch(op, ProcessorStatus::CarryFlag, true, retired); break;
+                case Instruction::BEQ: branch(op, ProcessorStatus::ZeroFlag, true, retired); break;
+                case Instruction::BNE: branch(op, ProcessorStatus::ZeroFlag, false, retired); break;
+                case Instruction::BMI: branch(op, ProcessorStatus::NegativeFlag, true, retired); break;
+                case Instruction::BPL: branch(op, ProcessorStatus::NegativeFlag, false, retired); break;
+                case Instruction::BVS: branch(op, ProcessorStatus::OverflowFlag, true, retired); break;
+                case Instruction::BVC: branch(op, ProcessorStatus::OverflowFlag, false, retired); break;
+
+                case Instruction::JMP:
+                    exit(operand.address, retired);
+                    return false;
+                default:
+                    DBG_CRASH("Unsupported instruction made it to the recompiler %02x", opCode.opCode);
+                    break;
+                }
+
+                if (touchesIo) {
+                    // Let the interpreter look at interrupts/DMA which the access may have started
+                    exit(op.next, retired);
+                    return false;
+                }
+                return true;
+            }
+
+            uint32_t busCycles{ 0 };    // since the PPU was last caught up
+            uint32_t cycles{ 0 };
+            uint32_t maxBusCycles{ 0 };
+            const Operand *current{ nullptr };
+            bool touchesIo{ false };
+
+        private:
+            // Load the operand into eax
+            void read() {
+                const Operand &operand = *current;
+                switch (operand.target) {
+                case Target::Ram:
+                    e.movzx8(RAX, regRam, operand.address % 0x800);
+                    break;
+                case Target::Rom:
+                    e.movRI(RAX, operand.value);
+                    break;
+                case Target::RamIndexed:
+                    ramIndexedAddressToEcx();
+                    e.movzx8(RAX, regRam, RCX, 0);
+                    break;
+                case Target::RomIndexed:
+                case Target::Io:
+                    if (operand.target == Target::RomIndexed) {
+                        e.movRR(RCX, operand.index);
+                        e.alu(IMM_ADD, RCX, operand.address);
+                        e.movRR(argRegs[1], RCX);
+                    } else {
+                        e.movRI(argRegs[1], operand.address);
+                        touchesIo = true;
+                    }
+                    callback((const void *)&jitRead);
+                    return;
+                default:
+                    return;
+                }
+                busCycles++;
+                maxBusCycles++;
+            }
+
+            void write(HostReg value) {
+                const Operand &operand = *current;
+                maxBusCycles++;
+                switch (operand.target) {
+                case Target::Ram: {
+                    uint16_t ramAddress = operand.address % 0x800;
+                    e.store8(regRam, ramAddress, value);
+                    busCycles++;
+                    // block cache invalidation
+                    e.load64(RDX, regContext, offsetof(JitContext, ramCodePages));
+                    e.cmpMem8(RDX, ramAddress / BlockCache::ramPageSize, 0);
+                    size_t skip = e.jcc(CC_E);
+                    e.movRI(argRegs[1], ramAddress);
+                    e.movRR64(argRegs[0], regContext);
+                    e.call((const void *)&jitInvalidateRamPage);
+                    e.patch(skip);
+                    break;
+                }
+                case Target::RamIndexed: {
+                    ramIndexedAddressToEcx();
+                    e.store8(regRam, RCX, 0, value);
+                    busCycles++;
+                    e.movRR(RDX, RCX);
+                    e.shift(SHIFT_SHR, RDX, 8);
+                    e.load64(RAX, regContext, offsetof(JitContext, ramCodePages));
+                    e.movzx8(RDX, RAX, RDX, 0);
+                    e.alu(OP_TEST, RDX, RDX);
+                    size_t skip = e.jcc(CC_E);
+                    e.movRR(argRegs[1], RCX);
+                    e.movRR64(argRegs[0], regContext);
+                    e.call((const void *)&jitInvalidateRamPage);
+                    e.patch(skip);
+                    break;
+                }
+                default:
+                    // Mapper registers or I/O
+                    e.movRR(argRegs[2], value);
+                    e.movRI(argRegs[1], operand.address);
+                    touchesIo = true;
+                    callback((const void *)&jitWrite);
+                    break;
+                }
+            }
+
+            // address (in RAM) for RamIndexed operands
+            void ramIndexedAddressToEcx() {
+                e.movRR(RCX, current->index);
+                e.alu(IMM_ADD, RCX, current->address);
+                e.alu(IMM_AND, RCX, 0x7ff);
+            }
+
+            // Call into the emulator with the PPU caught up to (but not including) the access being made
+            void callback(const void *fn) {
+                if (busCycles > 0) {
+                    e.aluMem(IMM_ADD, regContext, offsetof(JitContext, pendingBusCycles), busCycles);
+                    busCycles = 0;
+                }
+                maxBusCycles++;
+                e.movRR64(argRegs[0], regContext);
+                e.call(fn);
+            }
+
+            // N and Z from an 8 bit value.  Clobbers ecx.
+            void setNZ(HostReg value) {
+                e.alu(IMM_AND, regP, 0x7d);
+                e.movzx8(RCX, regContext, value, offsetof(JitContext, nzFlags));
+                e.alu(OP_OR, regP, RCX);
+            }
+
+            // Carry from bit 0 of an otherwise clear register
+            void setCarry(HostReg carry) {
+                e.alu(IMM_AND, regP, 0xfe);
+                e.alu(OP_OR, regP, carry);
+            }
+
+            void compare(HostReg reg) {
+                e.movRR(RDX, reg);
+                e.alu(OP_SUB, RDX, RAX);
+                e.alu(IMM_AND, RDX, 0xff);
+                setNZ(RDX);
+                e.alu(OP_CMP, reg, RAX);
+                e.setcc(CC_AE, RCX);
+                e.movzxRR8(RCX, RCX);
+                setCarry(RCX);
+            }
+
+            void increment(HostReg reg, uint32_t amount) {
+                e.alu(IMM_ADD, reg, amount);
+                e.alu(IMM_AND, reg, 0xff);
+                setNZ(reg);
+            }
+
+            void branch(const DecodedOp &op, ProcessorStatus flag, bool takenWhenSet, uint32_t retired) {
+                uint8_t offset = op.operands[0];
+                uint16_t target = (uint16_t)(op.next + (int8_t)offset);
+                // Same page crossing rule as InstructionSet::branch
+                uint32_t pageCrossCycles = ((op.next & 0xff) + offset > 0xff) ? 1 : 0;
+                maxBusCycles += pageCrossCycles;
+
+                e.test(regP, 1u << flag);
+                size_t notTaken = e.jcc(takenWhenSet ? CC_E : CC_NE);
+                exit(target, retired, pageCrossCycles, 1);
+                e.patch(notTaken);
+            }
+
+            X64Emitter &e;
+        };
+    }
+#endif
+
+    ///////////////////////////////////////////////////////////////////////
+    // Differential mode
+
+    void JitMapperLog::record(Cartridge &cart) {
+        this->cart = &cart;
+        mapper = cart.mmc;
+        recording = true;
+        log.clear();
+        replayed = 0;
+        replayMismatch = false;
+        memcpy(blockReadPages, mapper->prgReadPages, sizeof(blockReadPages));
+        memcpy(blockWritePages, mapper->prgWritePages, sizeof(blockWritePages));
+        takeMapping();
+
+        replayCartridge = cart;
+        replayCartridge.mmc = this;
+        cart.mmc = this;
+    }
+
+    void JitMapperLog::stopRecording() {
+        cart->mmc = mapper;
+        recording = false;
+        // the replay runs from the banks the block started with
+        memcpy(prgReadPages, blockReadPages, sizeof(prgReadPages));
+        memcpy(prgWritePages, blockWritePages, sizeof(prgWritePages));
+    }
+
+    void JitMapperLog::takeMapping() {
+        prgBankState = mapper->prgBankState;
+        chrBankState = mapper->chrBankState;
+        memcpy(prgReadPages, mapper->prgReadPages, sizeof(prgReadPages));
+        memcpy(prgWritePages, mapper->prgWritePages, sizeof(prgWritePages));
+    }
+
+    void JitMapperLog::doMemoryOperation(SystemBus &bus, Cartridge &cart) {
+        if (recording) {
+            mapper->doMemoryOperation(bus, cart);
+            Access access = { bus.addressBus, bus.dataBus, bus.read };
+            log.push_back(access);
+            if (!bus.read) {
+                takeMapping();
+            }
+            return;
+        }
+
+        if (replayed < log.size() && log[replayed].address == bus.addressBus && log[replayed].read == bus.read) {
+            if (bus.read) {
+                bus.dataBus = log[replayed].data;
+            } else if (bus.dataBus != log[replayed].data) {
+                replayMismatch = true;
+            }
+            replayed++;
+        } else if (bus.read) {
+            // code or an operand the block had folded in
+            mapper->doMemoryOperation(bus, cart);
+        } else {
+            // a write the block didn't make, which the mapper mustn't see
+            replayMismatch = true;
+        }
+    }
+
+    uint8_t JitMapperLog::doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead) {
+        if (!recording && !isRead) {
+            return 0;
+        }
+        return mapper->doCHRMemoryOperationOperation(cart, address, write, isRead);
+    }
+
+    void JitMapperLog::mapPrgPages(Cartridge &cart) {
+        if (recording) {
+            mapper->mapPrgPages(cart);
+            takeMapping();
+        }
+    }
+
+    Jit::Jit(Cpu2a03 &cpu) : cpu(cpu) {
+        blocks.resize(numBlocks);
+        for (int i = 0; i < 256; i++) {
+            context.nzFlags[i] = (i == 0 ? (1 << ProcessorStatus::ZeroFlag) : 0) | (i & 0x80);
+        }
+    }
+
+    Jit::~Jit() {
+#ifdef CONTROLDECK_JIT_X64
+        if (codeBuffer != nullptr) {
+#ifdef _WIN32
+            VirtualFree(codeBuffer, 0, MEM_RELEASE);
+#else
+            munmap(codeBuffer, codeBufferSize);
+#endif
+        }
+#endif
+    }
+
+    bool Jit::isSupported() {
+#ifdef CONTROLDECK_JIT_X64
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void Jit::flush() {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            blocks[i] = JitBlock();
+        }
+        codeUsed = 0;
+    }
+
+    JitBlock * Jit::findBlock(uint16_t address, uint32_t bankState) {
+        JitBlock &block = blocks[(address ^ (address >> 12)) & (numBlocks - 1)];
+        if (block.startAddress != address || block.bankState != bankState || (!block.compiled && block.executions == 0)) {
+            block = JitBlock();
+            block.startAddress = address;
+            block.bankState = bankState;
+        }
+        return &block;
+    }
+
+    DebugState Jit::step() {
+        lastInstructionCount = 1;
+
+        uint16_t address = cpu.registers.programCounter;
+        bool canRun = enabled && isSupported() && address >= 0x8000 && cpu.ppu != nullptr &&
+            !cpu.dmaData.isActive && !cpu.interrupts.isPending();
+        if (canRun) {
+            uint32_t currentBankState = cpu.getPrgBankState();
+            if (currentBankState != bankState) {
+                flush();
+                bankState = currentBankState;
+            }
+
+            JitBlock *block = findBlock(address, bankState);
+            if (!block->compiled && ++block->executions >= hotThreshold) {
+                compile(*block);
+            }
+
+            if (block->code != nullptr) {
+                // Don't run past anything which could raise an NMI before the block ends
+                cpu.catchUpPpu();
+                if (ppuCyclesForCpuCycles(block->maxBusCycles) <= cpu.ppu->getCyclesUntilNmiEvent()) {
+                    return runBlock(*block);
+                }
+                deadlineFallbacks++;
+            }
+        }
+
+        DebugState debugState = cpu.processInstruction();
+        lastInstructionCount = debugState.instructionCount;
+        instructionsExecuted += lastInstructionCount;
+        return debugState;
+    }
+
+    DebugState Jit::runBlock(JitBlock &block) {
+        DebugState debugState = DebugState();
+        debugState.opCode = &InstructionSet::opCodes[cpu.peekCodeByte(block.startAddress)];
+        debugState.registersBefore = cpu.registers;
+        debugState.systemBusBefore = cpu.systemBus;
+
+        bool logMapper = differential && cpu.cartridge != nullptr && cpu.cartridge->mmc != nullptr;
+        if (differential) {
+            if (!reference) {
+                reference.reset(new Cpu2a03());
+                referencePpu.reset(new Ppu2C02());
+                referencePpu->interrupts = &reference->interrupts;
+                reference->ppu = referencePpu.get();
+            }
+            reference->ram = cpu.ram;
+            reference->systemBus = cpu.systemBus;
+            reference->registers = cpu.registers;
+            reference->dmaData = cpu.dmaData;
+            reference->interrupts = cpu.interrupts;
+            reference->cycle = cpu.cycle;
+            referencePpu->copyState(*cpu.ppu);
+            if (logMapper) {
+                mapperLog.record(*cpu.cartridge);
+                reference->cartridge = &mapperLog.replayCartridge;
+            } else {
+                reference->cartridge = cpu.cartridge;
+            }
+            referencePpu->cartridge = reference->cartridge;
+        }
+
+        Registers &registers = cpu.registers;
+        context.a = registers.acc;
+        context.x = registers.x;
+        context.y = registers.y;
+        context.p = registers.statusRegister;
+        context.sp = registers.stackPointer;
+        context.pendingBusCycles = 0;
+        context.cycles = 0;
+        context.instructions = 0;
+        context.ram = cpu.ram.ram;
+        context.ramCodePages = cpu.blockCache.getRamCodePages();
+        context.cpu = &cpu;
+
+        block.code(&context);
+
+        registers.acc = (uint8_t)context.a;
+        registers.x = (uint8_t)context.x;
+        registers.y = (uint8_t)context.y;
+        registers.statusRegister = (uint8_t)context.p;
+        registers.stackPointer = (uint8_t)context.sp;
+        registers.programCounter = (uint16_t)context.pc;
+        catchUpPpu(&context);
+        cpu.catchUpPpu();
+        cpu.cycle += context.cycles;
+
+        lastInstructionCount = context.instructions;
+        instructionsExecuted += context.instructions;
+        jitInstructions += context.instructions;
+        blocksRun++;
+
+        debugState.registersAfter = cpu.registers;
+        debugState.systemBusAfter = cpu.systemBus;
+
+        if (logMapper) {
+            mapperLog.stopRecording();
+        }
+        if (differential) {
+            checkAgainstInterpreter(context.instructions, logMapper);
+        }
+        return debugState;
+    }
+
+    void Jit::checkAgainstInterpreter(uint32_t instructions, bool loggedMapper) {
+        Cpu2a03 &reference = *this->reference;
+        Ppu2C02 &referencePpu = *this->referencePpu;
+        uint16_t blockAddress = reference.registers.programCounter;
+        reference.mapCartridge();
+        for (uint32_t i = 0; i < instructions; i++) {
+            reference.processInstruction();
+        }
+
+        const Registers &expected = reference.registers;
+        const Registers &actual = cpu.registers;
+        bool match = expected.acc == actual.acc && expected.x == actual.x && expected.y == actual.y &&
+            expected.statusRegister == actual.statusRegister && expected.stackPointer == actual.stackPointer &&
+            expected.programCounter == actual.programCounter && reference.cycle == cpu.cycle &&
+            memcmp(reference.ram.ram, cpu.ram.ram, SystemRam::systemRAMBytes) == 0 &&
+            referencePpu.getCyclesUntilNmiEvent() == cpu.ppu->getCyclesUntilNmiEvent();
+        bool mapperMatch = !loggedMapper || mapperLog.replayMatches();
+        match = match && mapperMatch;
+        if (match) {
+            return;
+        }
+
+        differentialMismatches++;
+        lastMismatchAddress = blockAddress;
+        if (cpu.debugOutputFile != nullptr) {
+            fprintf(cpu.debugOutputFile, "JIT mismatch for block at $%04x: A:%02X/%02X X:%02X/%02X Y:%02X/%02X P:%02X/%02X S:%02X/%02X PC:%04X/%04X cycle:%llu/%llu%s\n",
+                lastMismatchAddress,
+                expected.acc, actual.acc, expected.x, actual.x, expected.y, actual.y,
+                expected.statusRegister.value(), actual.statusRegister.value(), expected.stackPointer, actual.stackPointer,
+                expected.programCounter, actual.programCounter, (unsigned long long)reference.cycle, (unsigned long long)cpu.cycle,
+                mapperMatch ? "" : " mapper accesses differ");
+        }
+
+        // keep going with the interpreter's result
+        cpu.ram = reference.ram;
+        cpu.registers = reference.registers;
+        cpu.systemBus = reference.systemBus;
+        cpu.dmaData = reference.dmaData;
+        cpu.cycle = reference.cycle;
+        cpu.interrupts = reference.interrupts;
+        cpu.ppu->copyState(referencePpu);
+    }
+
+    void Jit::compile(JitBlock &block) {
+        block.compiled = true;
+#ifdef CONTROLDECK_JIT_X64
+        X64Emitter emitter;
+        BlockCompiler compiler(emitter);
+        compiler.prologue();
+
+        uint32_t pc = block.startAddress;
+        uint32_t retired = 0;
+        bool open = true;
+        while (open && retired < maxBlockInstructions && pc >= 0x8000) {
+            DecodedOp op = DecodedOp();
+            op.opCode = &InstructionSet::opCodes[cpu.peekCodeByte((uint16_t)pc)];
+            op.address = (uint16_t)pc;
+            const OpCode &opCode = *op.opCode;
+            uint32_t length = 1 + addressingModeProgramCounterDelta[opCode.addressingMode];
+            if (!isSupportedInstruction(opCode) || pc + length - 1 > 0xffff) {
+                break;
+            }
+            for (uint32_t i = 1; i < length; i++) {
+                op.operands[i - 1] = cpu.peekCodeByte((uint16_t)(pc + i));
+            }
+            op.next = (uint16_t)(pc + length);
+
+            // Work out where the operand lives
+            Operand &operand = op.operand;
+            bool write = isStore(opCode.instruction) || isReadModifyWrite(opCode.instruction);
+            uint16_t base = op.operands[0] | (op.operands[1] << 8);
+            switch (opCode.addressingMode) {
+            case AddressingMode::Implicit:
+            case AddressingMode::Accumulator:
+            case AddressingMode::Relative:
+                break;
+            case AddressingMode::Immediate:
+                operand.target = Target::Immediate;
+                operand.value = op.operands[0];
+                break;
+            case AddressingMode::ZeroPage:
+                operand.target = Target::Ram;
+                operand.address = op.operands[0];
+                break;
+            case AddressingMode::Absolute:
+                operand.address = base;
+                if (base < 0x2000) {
+                    operand.target = Target::Ram;
+                } else if (base >= 0x8000 && !write) {
+                    operand.target = Target::Rom;
+                    operand.value = cpu.peekCodeByte(base);
+                } else if (opCode.instruction == Instruction::JMP) {
+                    // jumping out of cacheable memory
+                    operand.target = Target::None;
+                } else {
+                    operand.target = Target::Io;
+                }
+                break;
+            case AddressingMode::AbsoluteX:
+            case AddressingMode::AbsoluteY:
+                operand.address = base;
+                operand.index = opCode.addressingMode == AddressingMode::AbsoluteX ? regX : regY;
+                if (base + 0xff < 0x2000) {
+                    operand.target = Target::RamIndexed;
+                } else if (base >= 0x8000 && base + 0xff <= 0xffff && !write) {
+                    operand.target = Target::RomIndexed;
+                }
+                break;
+            default:
+                // zero page indexed (interpreter wraps at $80), indirect modes
+                break;
+            }
+            if (opCode.addressingMode != AddressingMode::Implicit && opCode.addressingMode != AddressingMode::Accumulator &&
+                opCode.addressingMode != AddressingMode::Relative && operand.target == Target::None) {
+                break;
+            }
+            // INC/DEC need both a read and write through the fast path or both through the emulator
+            if (isReadModifyWrite(opCode.instruction) && operand.target != Target::Ram && operand.target != Target::RamIndexed) {
+                break;
+            }
+
+            compiler.current = &op.operand;
+            open = compiler.instruction(op, retired);
+            retired++;
+            pc = op.next;
+        }
+
+        if (retired == 0) {
+            return;
+        }
+        if (open) {
+            // hand back to the interpreter at the first instruction which couldn't be compiled
+            compiler.exit((uint16_t)pc, retired);
+        }
+
+        size_t size = emitter.code.size();
+        if (codeBuffer == nullptr) {
+#ifdef _WIN32
+            codeBuffer = (uint8_t *)VirtualAlloc(nullptr, codeBufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+            void *memory = mmap(nullptr, codeBufferSize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            codeBuffer = memory == MAP_FAILED ? nullptr : (uint8_t *)memory;
+#endif
+            if (codeBuffer == nullptr) {
+                // No executable memory available, stick to the interpreter
+                enabled = false;
+                return;
+            }
+        }
+        if (codeUsed + size > codeBufferSize) {
+            JitBlock keep = block;
+            flush();
+            block = keep;
+        }
+
+        memcpy(codeBuffer + codeUsed, emitter.code.data(), size);
+        block.code = (JitBlockFnPtr)(codeBuffer + codeUsed);
+        block.maxBusCycles = compiler.maxBusCycles;
+        codeUsed = (codeUsed + size + 15) & ~(size_t)15;
+        blocksCompiled++;
+#endif
+    }
+}
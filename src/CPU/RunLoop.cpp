@@ -0,0 +1,416 @@
+#include <ControlDeck/CPU/cpu2A03.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CONTROLDECK_COMPUTED_GOTO
+#endif
+
+namespace NES {
+    namespace {
+        // Instructions runCycles handles inline with the registers in locals.  Everything else goes through the
+        // fused op code handlers with the registers written back.
+        enum RunLoopOp : uint8_t {
+            OpSlow = 0,
+            OpLda, OpLdx, OpLdy, OpAnd, OpOra, OpEor, OpCmp, OpCpx, OpCpy, OpBit,
+            OpSta, OpStx, OpSty, OpInc, OpDec,
+            OpInx, OpIny, OpDex, OpDey, OpTax, OpTay, OpTxa, OpTya, OpTsx, OpTxs,
+            OpClc, OpSec, OpCli, OpSei, OpClv, OpCld, OpSed, OpNop,
+            OpAslA, OpLsrA, OpRolA,
+            OpBcc, OpBcs, OpBeq, OpBne, OpBpl, OpBmi, OpBvc, OpBvs,
+            OpJmp, OpPha, OpPla,
+        };
+
+        struct RunLoopOpTable {
+            RunLoopOpTable() {
+                for (int i = 0; i < 256; i++) {
+                    ops[i] = lookup(InstructionSet::opCodes[i]);
+                }
+            }
+
+            static RunLoopOp lookup(const OpCode &opCode) {
+                switch (opCode.addressingMode) {
+                case AddressingMode::Immediate:
+                case AddressingMode::ZeroPage:
+                case AddressingMode::Absolute:
+                case AddressingMode::AbsoluteX:
+                case AddressingMode::AbsoluteY:
+                    switch (opCode.instruction) {
+                    case Instruction::LDA: return OpLda;
+                    case Instruction::LDX: return OpLdx;
+                    case Instruction::LDY: return OpLdy;
+                    case Instruction::AND: return OpAnd;
+                    case Instruction::ORA: return OpOra;
+                    case Instruction::EOR: return OpEor;
+                    case Instruction::CMP: return OpCmp;
+                    case Instruction::CPX: return OpCpx;
+                    case Instruction::CPY: return OpCpy;
+                    case Instruction::BIT: return OpBit;
+                    case Instruction::STA: return OpSta;
+                    case Instruction::STX: return OpStx;
+                    case Instruction::STY: return OpSty;
+                    case Instruction::INC: return OpInc;
+                    case Instruction::DEC: return OpDec;
+                    case Instruction::JMP: return OpJmp;
+                    default: return OpSlow;
+                    }
+                case AddressingMode::Implicit:
+                    switch (opCode.instruction) {
+                    case Instruction::INX: return OpInx;
+                    case Instruction::INY: return OpIny;
+                    case Instruction::DEX: return OpDex;
+                    case Instruction::DEY: return OpDey;
+                    case Instruction::TAX: return OpTax;
+                    case Instruction::TAY: return OpTay;
+                    case Instruction::TXA: return OpTxa;
+                    case Instruction::TYA: return OpTya;
+                    case Instruction::TSX: return OpTsx;
+                    case Instruction::TXS: return OpTxs;
+                    case Instruction::CLC: return OpClc;
+                    case Instruction::SEC: return OpSec;
+                    case Instruction::CLI: return OpCli;
+                    case Instruction::SEI: return OpSei;
+                    case Instruction::CLV: return OpClv;
+                    case Instruction::CLD: return OpCld;
+                    case Instruction::SED: return OpSed;
+                    case Instruction::NOP: return OpNop;
+                    case Instruction::PHA: return OpPha;
+                    case Instruction::PLA: return OpPla;
+                    default: return OpSlow;
+                    }
+                case AddressingMode::Accumulator:
+                    // ROR stays on the handler
+                    switch (opCode.instruction) {
+                    case Instruction::ASL: return OpAslA;
+                    case Instruction::LSR: return OpLsrA;
+                    case Instruction::ROL: return OpRolA;
+                    default: return OpSlow;
+                    }
+                case AddressingMode::Relative:
+                    switch (opCode.instruction) {
+                    case Instruction::BCC: return OpBcc;
+                    case Instruction::BCS: return OpBcs;
+                    case Instruction::BEQ: return OpBeq;
+                    case Instruction::BNE: return OpBne;
+                    case Instruction::BPL: return OpBpl;
+                    case Instruction::BMI: return OpBmi;
+                    case Instruction::BVC: return OpBvc;
+                    case Instruction::BVS: return OpBvs;
+                    default: return OpSlow;
+                    }
+                default:
+                    return OpSlow;
+                }
+            }
+
+            RunLoopOp ops[256];
+        };
+
+        const RunLoopOpTable &getRunLoopOps() {
+            static const RunLoopOpTable table;
+            return table;
+        }
+    }
+
+    /**
+    *   Bus access helpers for runCycles.  System RAM is accessed directly, anything else goes through
+    *   doMemoryOperation.  Both cost one synchronizeProcessors like any other bus cycle.
+    */
+    inline uint8_t Cpu2a03::runLoopRead(uint16_t address) {
+        if (address < 0x2000) {
+            synchronizeProcessors();
+            return ram.ram[address % 0x800];
+        }
+        return readFromAddress(address);
+    }
+
+    inline void Cpu2a03::runLoopWrite(uint16_t address, uint8_t value) {
+        if (address < 0x2000) {
+            synchronizeProcessors();
+            size_t actual = address % 0x800;
+            ram.ram[actual] = value;
+            if (blockCache.isRamCodePage(actual)) {
+                blockCache.invalidateRamPage(actual);
+            }
+            return;
+        }
+        systemBus.addressBus = address;
+        systemBus.dataBus = value;
+        systemBus.read = false;
+        doMemoryOperation();
+    }
+
+    bool Cpu2a03::runDueEvents() {
+        uint64_t now = getMasterClock();
+        bool runEnd = false;
+        for (SchedulerEvent event = scheduler.popDue(now); event != SchedulerEvent::Count; event = scheduler.popDue(now)) {
+            runEnd = runEnd || event == SchedulerEvent::RunEnd;
+        }
+        if (runEnd) {
+            return true;
+        }
+        // NMI, DMA and polls all come down to looking at the lines again
+        scheduleInterruptChecks();
+        return false;
+    }
+
+    uint32_t Cpu2a03::runCycles(uint32_t budget) {
+        uint64_t startCycle = cycle;
+        if (debug) {
+            // keep the trace output
+            while (cycle - startCycle < budget) {
+                processInstruction();
+            }
+            return (uint32_t)(cycle - startCycle);
+        }
+
+        const RunLoopOp *ops = getRunLoopOps().ops;
+        uint8_t a = registers.acc;
+        uint8_t x = registers.x;
+        uint8_t y = registers.y;
+        uint8_t sp = registers.stackPointer;
+        uint16_t pc = registers.programCounter;
+        StatusRegister p = registers.statusRegister;
+        uint64_t cycles = cycle;
+        // processInstruction counts the instructions it runs itself
+        uint64_t instructions = 0;
+        scheduleEvent(SchedulerEvent::RunEnd, (startCycle + budget) * CpuVariant::masterClocksPerCpuCycle);
+        scheduleInterruptChecks();
+
+#define RUN_LOOP_WRITE_BACK() \
+        registers.acc = a; \
+        registers.x = x; \
+        registers.y = y; \
+        registers.stackPointer = sp; \
+        registers.programCounter = pc; \
+        registers.statusRegister = p; \
+        cycle = cycles
+
+#define RUN_LOOP_RELOAD() \
+        a = registers.acc; \
+        x = registers.x; \
+        y = registers.y; \
+        sp = registers.stackPointer; \
+        pc = registers.programCounter; \
+        p = registers.statusRegister; \
+        cycles = cycle
+
+#define RUN_LOOP_SET_NZ(val) \
+        p.zeroResult = (val); \
+        p.negativeResult = (val)
+
+#define RUN_LOOP_SET_FLAG(flag, condition) \
+        p.bits = (condition) ? (p.bits | (1 << (flag))) : (p.bits & ~(1 << (flag)))
+
+#define RUN_LOOP_FLAG(flag) ((p.bits & (1 << (flag))) != 0)
+
+#define RUN_LOOP_COMPARE(reg) \
+        RUN_LOOP_SET_NZ((uint8_t)((reg) - value)); \
+        RUN_LOOP_SET_FLAG(ProcessorStatus::CarryFlag, (reg) >= value)
+
+        // Taken branches read the offset and cost a cycle, plus a dummy read if the page changes
+#define RUN_LOOP_BRANCH(condition) \
+        if (condition) { \
+            if ((pc & 0xff) + value > 0xff) { \
+                synchronizeProcessors(); \
+            } \
+            pc += (int8_t)value; \
+            branchCycles = 1; \
+        }
+
+#ifdef CONTROLDECK_COMPUTED_GOTO
+        static void *const opLabels[] = {
+            &&OpSlow,
+            &&OpLda, &&OpLdx, &&OpLdy, &&OpAnd, &&OpOra, &&OpEor, &&OpCmp, &&OpCpx, &&OpCpy, &&OpBit,
+            &&OpSta, &&OpStx, &&OpSty, &&OpInc, &&OpDec,
+            &&OpInx, &&OpIny, &&OpDex, &&OpDey, &&OpTax, &&OpTay, &&OpTxa, &&OpTya, &&OpTsx, &&OpTxs,
+            &&OpClc, &&OpSec, &&OpCli, &&OpSei, &&OpClv, &&OpCld, &&OpSed, &&OpNop,
+            &&OpAslA, &&OpLsrA, &&OpRolA,
+            &&OpBcc, &&OpBcs, &&OpBeq, &&OpBne, &&OpBpl, &&OpBmi, &&OpBvc, &&OpBvs,
+            &&OpJmp, &&OpPha, &&OpPla,
+        };
+#define RUN_LOOP_CASE(op) op
+#else
+#define RUN_LOOP_CASE(op) case op
+#endif
+
+        while (true) {
+            if (cycles >= nextEventCycle) {
+                RUN_LOOP_WRITE_BACK();
+                if (runDueEvents()) {
+                    break;
+                }
+                if (dmaData.isActive || interrupts.isPending()) {
+                    // DMA and interrupts are rare enough to leave to the regular path
+                    processInstruction();
+                    scheduleInterruptChecks();
+                    RUN_LOOP_RELOAD();
+                    continue;
+                }
+            }
+
+            uint8_t opCodeByte = runLoopRead(pc);
+            const OpCode &opCode = InstructionSet::opCodes[opCodeByte];
+            pc++;
+            RunLoopOp op = ops[opCodeByte];
+
+            // Operand fetch, same bus accesses as handleAddressingMode
+            uint8_t value = 0;
+            uint16_t address = 0;
+            uint8_t pagingCycles = 0;
+            uint8_t branchCycles = 0;
+            if (op != OpSlow) {
+                switch (opCode.addressingMode) {
+                case AddressingMode::Immediate:
+                case AddressingMode::Relative:
+                    value = runLoopRead(pc);
+                    pc++;
+                    break;
+                case AddressingMode::ZeroPage:
+                    address = runLoopRead(pc);
+                    value = runLoopRead(address);
+                    pc++;
+                    break;
+                case AddressingMode::Absolute:
+                    address = runLoopRead(pc);
+                    address |= runLoopRead(pc + 1) << 8;
+                    value = runLoopRead(address);
+                    pc += 2;
+                    break;
+                case AddressingMode::AbsoluteX:
+                case AddressingMode::AbsoluteY: {
+                    uint8_t index = opCode.addressingMode == AddressingMode::AbsoluteX ? x : y;
+                    address = runLoopRead(pc);
+                    address |= runLoopRead(pc + 1) << 8;
+                    if ((address & 0xff) + index >= 0xff) {
+                        pagingCycles = 1;
+                    }
+                    address += index;
+                    value = runLoopRead(address);
+                    pc += 2;
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+#ifdef CONTROLDECK_COMPUTED_GOTO
+            goto *opLabels[op];
+#else
+            switch (op) {
+#endif
+            RUN_LOOP_CASE(OpSlow): {
+                RUN_LOOP_WRITE_BACK();
+                // processInstruction leaves the op code fetch on the bus for the handlers
+                systemBus.addressBus = pc - 1;
+                systemBus.read = true;
+                systemBus.dataBus = opCodeByte;
+                OpCodeArgs opCodeArgs = OpCodeArgs();
+                branchCycles = fusedOpCodes[opCodeByte](*this, opCodeArgs);
+                pagingCycles = opCodeArgs.pagingCycles;
+                RUN_LOOP_RELOAD();
+                goto done;
+            }
+
+            RUN_LOOP_CASE(OpLda): a = value; RUN_LOOP_SET_NZ(a); goto done;
+            RUN_LOOP_CASE(OpLdx): x = value; RUN_LOOP_SET_NZ(x); goto done;
+            RUN_LOOP_CASE(OpLdy): y = value; RUN_LOOP_SET_NZ(y); goto done;
+            RUN_LOOP_CASE(OpAnd): a &= value; RUN_LOOP_SET_NZ(a); goto done;
+            RUN_LOOP_CASE(OpOra): a |= value; RUN_LOOP_SET_NZ(a); goto done;
+            RUN_LOOP_CASE(OpEor): a ^= value; RUN_LOOP_SET_NZ(a); goto done;
+            RUN_LOOP_CASE(OpCmp): RUN_LOOP_COMPARE(a); goto done;
+            RUN_LOOP_CASE(OpCpx): RUN_LOOP_COMPARE(x); goto done;
+            RUN_LOOP_CASE(OpCpy): RUN_LOOP_COMPARE(y); goto done;
+            RUN_LOOP_CASE(OpBit):
+                p.zeroResult = a & value;
+                p.negativeResult = value;
+                RUN_LOOP_SET_FLAG(ProcessorStatus::OverflowFlag, (value & 0x40) != 0);
+                goto done;
+
+            RUN_LOOP_CASE(OpSta): runLoopWrite(address, a); goto done;
+            RUN_LOOP_CASE(OpStx): runLoopWrite(address, x); goto done;
+            RUN_LOOP_CASE(OpSty): runLoopWrite(address, y); goto done;
+            RUN_LOOP_CASE(OpInc): value++; RUN_LOOP_SET_NZ(value); runLoopWrite(address, value); goto done;
+            RUN_LOOP_CASE(OpDec): value--; RUN_LOOP_SET_NZ(value); runLoopWrite(address, value); goto done;
+
+            RUN_LOOP_CASE(OpInx): x++; RUN_LOOP_SET_NZ(x); goto done;
+            RUN_LOOP_CASE(OpIny): y++; RUN_LOOP_SET_NZ(y); goto done;
+            RUN_LOOP_CASE(OpDex): x--; RUN_LOOP_SET_NZ(x); goto done;
+            RUN_LOOP_CASE(OpDey): y--; RUN_LOOP_SET_NZ(y); goto done;
+            RUN_LOOP_CASE(OpTax): x = a; RUN_LOOP_SET_NZ(x); goto done;
+            RUN_LOOP_CASE(OpTay): y = a; RUN_LOOP_SET_NZ(y); goto done;
+            RUN_LOOP_CASE(OpTxa): a = x; RUN_LOOP_SET_NZ(a); goto done;
+            RUN_LOOP_CASE(OpTya): a = y; RUN_LOOP_SET_NZ(a); goto done;
+            RUN_LOOP_CASE(OpTsx): x = sp; RUN_LOOP_SET_NZ(x); goto done;
+            RUN_LOOP_CASE(OpTxs): sp = x; goto done;
+
+            RUN_LOOP_CASE(OpClc): RUN_LOOP_SET_FLAG(ProcessorStatus::CarryFlag, false); goto done;
+            RUN_LOOP_CASE(OpSec): RUN_LOOP_SET_FLAG(ProcessorStatus::CarryFlag, true); goto done;
+            RUN_LOOP_CASE(OpCli): RUN_LOOP_SET_FLAG(ProcessorStatus::InterruptDisable, false); goto done;
+            RUN_LOOP_CASE(OpSei): RUN_LOOP_SET_FLAG(ProcessorStatus::InterruptDisable, true); goto done;
+            RUN_LOOP_CASE(OpClv): RUN_LOOP_SET_FLAG(ProcessorStatus::OverflowFlag, false); goto done;
+            RUN_LOOP_CASE(OpCld): RUN_LOOP_SET_FLAG(ProcessorStatus::DecimalMode, false); goto done;
+            RUN_LOOP_CASE(OpSed): RUN_LOOP_SET_FLAG(ProcessorStatus::DecimalMode, true); goto done;
+            RUN_LOOP_CASE(OpNop): goto done;
+
+            RUN_LOOP_CASE(OpAslA):
+                RUN_LOOP_SET_FLAG(ProcessorStatus::CarryFlag, (a & 0x80) != 0);
+                a <<= 1;
+                RUN_LOOP_SET_NZ(a);
+                goto done;
+            RUN_LOOP_CASE(OpLsrA):
+                RUN_LOOP_SET_FLAG(ProcessorStatus::CarryFlag, (a & 0x01) != 0);
+                a >>= 1;
+                RUN_LOOP_SET_NZ(a);
+                goto done;
+            RUN_LOOP_CASE(OpRolA): {
+                uint8_t carry = RUN_LOOP_FLAG(ProcessorStatus::CarryFlag) ? 1 : 0;
+                RUN_LOOP_SET_FLAG(ProcessorStatus::CarryFlag, (a & 0x80) != 0);
+                a = (uint8_t)(a << 1) + carry;
+                RUN_LOOP_SET_NZ(a);
+                goto done;
+            }
+
+            RUN_LOOP_CASE(OpBcc): RUN_LOOP_BRANCH(!RUN_LOOP_FLAG(ProcessorStatus::CarryFlag)); goto done;
+            RUN_LOOP_CASE(OpBcs): RUN_LOOP_BRANCH(RUN_LOOP_FLAG(ProcessorStatus::CarryFlag)); goto done;
+            RUN_LOOP_CASE(OpBeq): RUN_LOOP_BRANCH(p.zeroResult == 0); goto done;
+            RUN_LOOP_CASE(OpBne): RUN_LOOP_BRANCH(p.zeroResult != 0); goto done;
+            RUN_LOOP_CASE(OpBpl): RUN_LOOP_BRANCH((p.negativeResult & 0x80) == 0); goto done;
+            RUN_LOOP_CASE(OpBmi): RUN_LOOP_BRANCH((p.negativeResult & 0x80) != 0); goto done;
+            RUN_LOOP_CASE(OpBvc): RUN_LOOP_BRANCH(!RUN_LOOP_FLAG(ProcessorStatus::OverflowFlag)); goto done;
+            RUN_LOOP_CASE(OpBvs): RUN_LOOP_BRANCH(RUN_LOOP_FLAG(ProcessorStatus::OverflowFlag)); goto done;
+
+            RUN_LOOP_CASE(OpJmp): pc = address; goto done;
+            RUN_LOOP_CASE(OpPha):
+                // stack pointer update cycle, then the write
+                synchronizeProcessors();
+                runLoopWrite(stackBaseAddress + sp--, a);
+                goto done;
+            RUN_LOOP_CASE(OpPla):
+                synchronizeProcessors();
+                a = runLoopRead(stackBaseAddress + ++sp);
+                RUN_LOOP_SET_NZ(a);
+                goto done;
+#ifndef CONTROLDECK_COMPUTED_GOTO
+            }
+#endif
+        done:
+            cycles += opCode.cycles + branchCycles + pagingCycles;
+            instructions++;
+        }
+        instructionsExecuted += instructions;
+
+        // registers were written back for the last deadline
+        cancelEvent(SchedulerEvent::RunEnd);
+        catchUpPpu();
+        return (uint32_t)(cycle - startCycle);
+
+#undef RUN_LOOP_WRITE_BACK
+#undef RUN_LOOP_RELOAD
+#undef RUN_LOOP_SET_NZ
+#undef RUN_LOOP_SET_FLAG
+#undef RUN_LOOP_FLAG
+#undef RUN_LOOP_COMPARE
+#undef RUN_LOOP_BRANCH
+#undef RUN_LOOP_CASE
+    }
+}
@@ -0,0 +1,75 @@
+#include <ControlDeck/CPU/Scheduler.h>
+
+namespace NES {
+    const uint64_t Scheduler::never;
+
+    static_assert((size_t)SchedulerEvent::Count == 4, "positions initializer needs one entry per event");
+
+    void Scheduler::schedule(SchedulerEvent event, uint64_t time) {
+        uint8_t index = positions[(size_t)event];
+        if (index == notScheduled) {
+            index = size++;
+        }
+        place(index, { time, event });
+        update(index);
+    }
+
+    void Scheduler::cancel(SchedulerEvent event) {
+        uint8_t index = positions[(size_t)event];
+        if (index == notScheduled) {
+            return;
+        }
+        positions[(size_t)event] = notScheduled;
+        size--;
+        if (index != size) {
+            // last deadline fills the hole
+            place(index, heap[size]);
+            update(index);
+        }
+    }
+
+    uint64_t Scheduler::getDeadline(SchedulerEvent event) const {
+        uint8_t index = positions[(size_t)event];
+        return index == notScheduled ? never : heap[index].time;
+    }
+
+    SchedulerEvent Scheduler::popDue(uint64_t time) {
+        if (size == 0 || heap[0].time > time) {
+            return SchedulerEvent::Count;
+        }
+        SchedulerEvent event = heap[0].event;
+        cancel(event);
+        return event;
+    }
+
+    void Scheduler::place(uint8_t index, const Deadline &deadline) {
+        heap[index] = deadline;
+        positions[(size_t)deadline.event] = index;
+    }
+
+    void Scheduler::update(uint8_t index) {
+        Deadline deadline = heap[index];
+        // up towards the root while earlier than the parent
+        while (index > 0 && deadline.time < heap[(index - 1) / 2].time) {
+            uint8_t parent = (index - 1) / 2;
+            place(index, heap[parent]);
+            index = parent;
+        }
+        // then down while later than the earliest child
+        while (true) {
+            uint8_t child = index * 2 + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && heap[child + 1].time < heap[child].time) {
+                child++;
+            }
+            if (heap[child].time >= deadline.time) {
+                break;
+            }
+            place(index, heap[child]);
+            index = child;
+        }
+        place(index, deadline);
+    }
+}
@@ -0,0 +1,155 @@
+#include <ControlDeck/CPU/StaticRecompiler.h>
+#include <ControlDeck/common.h>
+
+namespace NES {
+    static bool isPrgRomAddress(uint32_t address) {
+        return address >= 0x8000 && address <= 0xffff;
+    }
+
+    // Instructions after which execution doesn't continue at the next address
+    static bool endsFlow(Instruction instruction) {
+        return instruction == Instruction::JMP || instruction == Instruction::RTS ||
+            instruction == Instruction::RTI || instruction == Instruction::BRK;
+    }
+
+    void ControlFlowGraph::build(Cpu2a03 &cpu) {
+        instructions.clear();
+        blockStarts.clear();
+        entryPoints.clear();
+        indirectJumps.clear();
+
+        std::vector<uint16_t> worklist;
+        const uint16_t vectors[3] = { 0xfffc, 0xfffa, 0xfffe };    // reset, NMI, IRQ/BRK
+        for (uint16_t vector : vectors) {
+            uint16_t handler = cpu.peekCodeByte(vector) | (cpu.peekCodeByte(vector + 1) << 8);
+            if (isPrgRomAddress(handler)) {
+                entryPoints.push_back(handler);
+                worklist.push_back(handler);
+            }
+        }
+
+        while (!worklist.empty()) {
+            uint32_t pc = worklist.back();
+            worklist.pop_back();
+            blockStarts.insert((uint16_t)pc);
+
+            // Follow straight-line code until it ends or runs into code already walked
+            while (isPrgRomAddress(pc) && !contains((uint16_t)pc)) {
+                const OpCode &opCode = InstructionSet::opCodes[cpu.peekCodeByte((uint16_t)pc)];
+                uint32_t length = 1 + addressingModeProgramCounterDelta[opCode.addressingMode];
+                if (opCode.instruction == Instruction::UNK || !isPrgRomAddress(pc + length - 1)) {
+                    // Data or a bad jump, leave it to the interpreter
+                    break;
+                }
+
+                RecompiledInstruction &instruction = instructions[(uint16_t)pc];
+                instruction.address = (uint16_t)pc;
+                instruction.opCode = opCode.opCode;
+                instruction.length = (uint8_t)length;
+                for (uint32_t i = 1; i < length; i++) {
+                    instruction.operands[i - 1] = cpu.peekCodeByte((uint16_t)(pc + i));
+                }
+                uint16_t operand = instruction.operands[0] | (instruction.operands[1] << 8);
+                uint32_t next = pc + length;
+
+                if (opCode.addressingMode == AddressingMode::Relative) {
+                    worklist.push_back((uint16_t)(next + (int8_t)instruction.operands[0]));
+                    worklist.push_back((uint16_t)next);
+                    break;
+                }
+                if (opCode.instruction == Instruction::JSR) {
+                    // assume the subroutine returns
+                    worklist.push_back(operand);
+                    worklist.push_back((uint16_t)next);
+                    break;
+                }
+                if (opCode.instruction == Instruction::JMP) {
+                    if (opCode.addressingMode == AddressingMode::Absolute) {
+                        worklist.push_back(operand);
+                    } else if (isPrgRomAddress(operand) && isPrgRomAddress(operand + 1u)) {
+                        // pointer is in ROM so the target can't change
+                        worklist.push_back(cpu.peekCodeByte(operand) | (cpu.peekCodeByte(operand + 1) << 8));
+                    } else {
+                        indirectJumps.push_back((uint16_t)pc);
+                    }
+                    break;
+                }
+                if (endsFlow(opCode.instruction)) {
+                    break;
+                }
+                pc = next;
+            }
+        }
+    }
+
+    void writeRecompiledSource(const ControlFlowGraph &graph, FILE *out, const char *functionName, const char *romName) {
+        fprintf(out, "// Generated by ControlDeckRecompiler%s%s.  Do not edit.\n", romName != nullptr ? " from " : "", romName != nullptr ? romName : "");
+        fprintf(out, "// %u instructions, %u blocks, %u unresolved indirect jumps\n",
+            (unsigned)graph.instructions.size(), (unsigned)graph.blockStarts.size(), (unsigned)graph.indirectJumps.size());
+        fprintf(out, "#include <ControlDeck/CPU/StaticRecompiler.h>\n\n");
+        fprintf(out, "uint32_t %s(NES::Cpu2a03 &cpu, uint32_t maxInstructions) {\n", functionName);
+        fprintf(out, "    uint32_t executed = 0;\n");
+        fprintf(out, "    for (;;) {\n");
+        fprintf(out, "        switch (cpu.registers.programCounter) {\n");
+
+        for (auto it = graph.instructions.begin(); it != graph.instructions.end(); ++it) {
+            const RecompiledInstruction &instruction = it->second;
+            const OpCode &opCode = InstructionSet::opCodes[instruction.opCode];
+            uint32_t next = instruction.address + instruction.length;
+
+            fprintf(out, "        case 0x%04x:    // %s %s\n", instruction.address,
+                instructionNames[opCode.instruction], addressingModeNames[opCode.addressingMode]);
+            fprintf(out, "            if (executed == maxInstructions || !NES::canRunRecompiled(cpu)) return executed;\n");
+            fprintf(out, "            cpu.executeFusedOpCode<0x%02x>(0x%02x, 0x%02x);\n",
+                instruction.opCode, instruction.operands[0], instruction.operands[1]);
+            fprintf(out, "            executed++;\n");
+
+            // Fall through to the next case only if it is the instruction that runs next
+            auto following = std::next(it);
+            bool fallsThrough = following != graph.instructions.end() && following->first == next;
+            // marked for -Wimplicit-fallthrough, [[fallthrough]] needs C++17
+            if (opCode.addressingMode == AddressingMode::Relative) {
+                if (fallsThrough) {
+                    fprintf(out, "            if (cpu.registers.programCounter != 0x%04x) continue;\n", next);
+                    fprintf(out, "            // fall through\n");
+                } else {
+                    fprintf(out, "            continue;\n");
+                }
+            } else if (!fallsThrough || endsFlow(opCode.instruction) || opCode.instruction == Instruction::JSR) {
+                fprintf(out, "            continue;\n");
+            } else {
+                fprintf(out, "            // fall through\n");
+            }
+        }
+
+        fprintf(out, "        default:\n");
+        fprintf(out, "            // outside the code found ahead of time\n");
+        fprintf(out, "            return executed;\n");
+        fprintf(out, "        }\n");
+        fprintf(out, "    }\n");
+        fprintf(out, "}\n");
+    }
+
+    DebugState RecompiledProgram::step() {
+        if (code != nullptr) {
+            DebugState debugState = DebugState();
+            debugState.registersBefore = cpu.registers;
+            debugState.systemBusBefore = cpu.systemBus;
+
+            lastInstructionCount = code(cpu, maxInstructions);
+            if (lastInstructionCount > 0) {
+                instructionsExecuted += lastInstructionCount;
+                recompiledInstructions += lastInstructionCount;
+                debugState.registersAfter = cpu.registers;
+                debugState.systemBusAfter = cpu.systemBus;
+                return debugState;
+            }
+        }
+
+        DebugState debugState = cpu.processInstruction();
+        lastInstructionCount = debugState.instructionCount;
+        instructionsExecuted += lastInstructionCount;
+        interpreterFallbacks++;
+        return debugState;
+    }
+}
@@ -0,0 +1,76 @@
+#include <ControlDeck/FramePacer.h>
+#include <ControlDeck/CPU/CpuVariant.h>
+#include <thread>
+
+namespace NES {
+    double FramePacer::getFrameRate() {
+        // 341 PPU cycles a scan line.  An NTSC PPU drops a dot every other frame while rendering, which Ppu2C02
+        // doesn't do yet (see its TODO), but pace to what the console really does: 60.0988Hz, not 60.0985Hz.
+        double ppuCyclesPerFrame = (double)CpuVariant::scanLines * 341 - (CpuVariant::scanLines == 262 ? 0.5 : 0.0);
+        return CpuVariant::clockHz * (double)CpuVariant::ppuClocks / CpuVariant::cpuClocks / ppuCyclesPerFrame;
+    }
+
+    void FramePacer::setMode(PacingMode mode, double fastForwardFactor) {
+        this->mode = mode;
+        this->fastForwardFactor = mode == PacingMode::FastForward ? fastForwardFactor : 1.0;
+        // deadlines start over from the next frame
+        started = false;
+    }
+
+    void FramePacer::restart(Clock::time_point now) {
+        started = true;
+        start = now;
+        frames = 0;
+    }
+
+    FramePacer::Clock::duration FramePacer::frameDone(Clock::time_point now) {
+        if (!measuring) {
+            // the first frame only marks where the window starts
+            measuring = true;
+            speedWindowStart = now;
+        } else {
+            speedWindowFrames++;
+        }
+        Clock::duration measured = now - speedWindowStart;
+        if (measured >= speedWindow && measured > Clock::duration::zero()) {
+            double emulatedSeconds = speedWindowFrames / getFrameRate();
+            speed = 100.0 * emulatedSeconds / std::chrono::duration<double>(measured).count();
+            speedWindowStart = now;
+            speedWindowFrames = 0;
+        }
+
+        if (mode == PacingMode::Uncapped) {
+            return Clock::duration::zero();
+        }
+        if (!started) {
+            restart(now);
+        }
+
+        frames++;
+        std::chrono::duration<double> period(1.0 / (getFrameRate() * fastForwardFactor));
+        Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(period * (double)frames);
+        if (now >= deadline) {
+            if (now - deadline > std::chrono::duration_cast<Clock::duration>(period * (double)maxFramesBehind)) {
+                // the host can't keep up (or was stopped in a debugger), don't make up for it
+                restart(now);
+            }
+            return Clock::duration::zero();
+        }
+        return deadline - now;
+    }
+
+    void FramePacer::pace() {
+        Clock::time_point now = Clock::now();
+        Clock::duration wait = frameDone(now);
+        if (wait <= Clock::duration::zero()) {
+            return;
+        }
+
+        Clock::time_point until = now + wait;
+        if (wait > spinTime) {
+            std::this_thread::sleep_until(until - spinTime);
+        }
+        while (Clock::now() < until) {
+        }
+    }
+}
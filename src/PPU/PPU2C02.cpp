@@ -1,19 +1,26 @@
 #include <ControlDeck/PPU/ppu2c02.h>
+#include <cstring>
 #include <ControlDeck/common.h>
+#include <ControlDeck/CPU/InterruptController.h>
+#include <ControlDeck/CPU/CpuVariant.h>
 
 namespace NES {
     void Ppu2C02::setPowerUpState() {
         ppuMemory = PPUMemoryComponents();
         renderingRegisters = PPURenderingRegisters();
+        dataWriteCount = 0;
+        updateNmiLine();
     }
 
     const uint32_t cyclesPerScanLine = 341;
-    const uint32_t scanLines = 262; // some documentation starts at -1 but this starts at 0
+    const uint32_t scanLines = CpuVariant::scanLines; // some documentation starts at -1 but this starts at 0
+    const uint16_t vblankScanLine = CpuVariant::vblankScanLine;
 
     // http://nesdev.com/2C02%20technical%20reference.TXT
     // clock signal is main 6502 clock (21.48mhz / 4)'
     // 341 ppu clock cycles per scan line
     // 240 scan lines per frame + 20 pre-render + 1 dummy + 1 post-render = 262 total scan lines per frame
+    // (PAL has 70 vblank lines and Dendy 51 post-render lines for 312, see CpuVariant)
     // Memory access is 2 cycles long
 
     /*
@@ -54,13 +61,13 @@ namespace NES {
     } 
 
     RenderState Ppu2C02::getRenderState() {
-        if (curScanLine == 0 || curScanLine == 262) {
+        if (curScanLine == 0) {
             return RenderState::PreRenderScanLine;
         } else if (curScanLine < 241) {
             return RenderState::VisibleScanLines;
-        } else if (curScanLine == 241) {
+        } else if (curScanLine < vblankScanLine) {
             return RenderState::PostRenderScanLine;
-        } else { // curScanLine 242-261
+        } else { // curScanLine 242-261 on NTSC
             return RenderState::VerticalBlank;
         }
     }
@@ -82,13 +89,17 @@ namespace NES {
         // scan line is 341 ppu clock cycles (113.667 cpu cycles with a 3x multiplier of clock from cpu to ppu)
         // 260 scan lines visible, +2  (-1, 261) which are pre-render scanlines.
         RenderState renderState = getRenderState();
+        // fetches below read vram, so queued DATA writes have to land first
+        if (dataWriteCount > 0 && (renderState == RenderState::PreRenderScanLine || renderState == RenderState::VisibleScanLines)) {
+            flushDataWrites();
+        }
         if (renderState == RenderState::PreRenderScanLine) {
             if (scanLineCycle == 1) {
                 // reset sprite zero hit, overflow, etc.
             }
             if (scanLineCycle == 2) {
                 ppuMemory.memoryMappedRegisters.setVBlank(false);
-                flagNmi = false;    // if nmi wasn't polled by cpu during vblank, reset
+                updateNmiLine();
             }
             if (scanLineCycle >= 257 && scanLineCycle <= 320) {
                 ppuMemory.memoryMappedRegisters.oamAddr = 0;
@@ -174,13 +185,13 @@ namespace NES {
         } else if (renderState == RenderState::PostRenderScanLine) {
             // Post-render scan line
         } else {    // RenderState::VerticalBlank
-            // Vblank period (20 scan lines) # 242-261
+            // Vblank period (20 scan lines on NTSC) # 242-261
             if (scanLineCycle == 1) {
                 // Second cycle enables vblank NMI!
                 ppuMemory.memoryMappedRegisters.setVBlank(true);
-                if (ppuMemory.memoryMappedRegisters.getGenerateVBlankNmi()) {
-                    // TODO GENERATE THE NMI?????????s
-                    flagNmi = true;
+                updateNmiLine();
+                if (curScanLine == vblankScanLine) {
+                    frameCount++;
                 }
             }
         }
@@ -192,12 +203,114 @@ namespace NES {
         scanLineCycle = cycle % cyclesPerScanLine;
     }
 
-    bool Ppu2C02::pollNMI() {
-        if (flagNmi) {
-            flagNmi = false;
-            return true;
+    void Ppu2C02::copyState(const Ppu2C02 &other) {
+        ppuMemory = other.ppuMemory;
+        renderingRegisters = other.renderingRegisters;
+        spriteMemory = other.spriteMemory;
+        bkrndTileMemory = other.bkrndTileMemory;
+        disabled = other.disabled;
+
+        curScanLine = other.curScanLine;
+        cycle = other.cycle;
+        frameCount = other.frameCount;
+        scanLineCycle = other.scanLineCycle;
+        ppuAddr = other.ppuAddr;
+        ppuData = other.ppuData;
+        currentNameTable = other.currentNameTable;
+        patternL = other.patternL;
+        patternR = other.patternR;
+        attrTableEntry = other.attrTableEntry;
+        memcpy(dataWrites, other.dataWrites, other.dataWriteCount);
+        dataWriteCount = other.dataWriteCount;
+        dataWriteAddress = other.dataWriteAddress;
+        dataWriteIncrement = other.dataWriteIncrement;
+        isDmaActive = other.isDmaActive;
+
+        chrTiles.invalidate();
+    }
+
+    void Ppu2C02::advance(uint32_t ppuCycles) {
+        if (disabled) {
+            return;
+        }
+        while (ppuCycles > 0) {
+            uint32_t idleCycles = getIdleCycles();
+            if (idleCycles == 0) {
+                if (scanLineCycle == 0 && ppuCycles >= cyclesPerScanLine && getRenderState() == RenderState::VisibleScanLines) {
+                    // Nothing can write a register until the batch is done, so the whole line can be drawn at once
+                    renderScanLine();
+                    ppuCycles -= cyclesPerScanLine;
+                    continue;
+                }
+
+                // Cycle by cycle to the end of a pre-render or visible scan line, or just the vblank set on a vblank line
+                uint32_t busyCycles = curScanLine < (uint16_t)RenderState::PostRenderScanLine ? cyclesPerScanLine - scanLineCycle : 1;
+                uint32_t run = busyCycles < ppuCycles ? busyCycles : ppuCycles;
+                for (uint32_t i = 0; i < run; i++) {
+                    doPpuCycle();
+                }
+                ppuCycles -= run;
+                continue;
+            }
+
+            // Nothing to do but count, so move the counters the same way doPpuCycle would in one go
+            uint32_t skip = idleCycles < ppuCycles ? idleCycles : ppuCycles;
+            cycle += skip;
+            curScanLine = (curScanLine + (scanLineCycle + skip) / cyclesPerScanLine) % scanLines;
+            scanLineCycle = cycle % cyclesPerScanLine;
+            ppuCycles -= skip;
         }
-        return false;
+    }
+
+    uint32_t Ppu2C02::getIdleCycles() {
+        RenderState renderState = getRenderState();
+        if (renderState == RenderState::PostRenderScanLine) {
+            // the rest of the post-render lines and cycle 0 of the first vblank line
+            return (vblankScanLine - curScanLine) * cyclesPerScanLine - scanLineCycle + 1;
+        }
+        if (renderState == RenderState::VerticalBlank) {
+            // every vblank line sets vblank on cycle 1
+            if (scanLineCycle == 1) {
+                return 0;
+            }
+            if (scanLineCycle == 0) {
+                return 1;
+            }
+            return cyclesPerScanLine - scanLineCycle + (curScanLine + 1u < scanLines ? 1 : 0);
+        }
+        return 0;
+    }
+
+    void Ppu2C02::updateNmiLine() {
+        if (interrupts != nullptr) {
+            interrupts->setNmiLine(ppuMemory.memoryMappedRegisters.getVBlank() && ppuMemory.memoryMappedRegisters.getGenerateVBlankNmi());
+        }
+    }
+
+    uint32_t Ppu2C02::getCyclesUntilNmiEvent() const {
+        if (disabled) {
+            return 0xffffffff;
+        }
+
+        // vblank (and the NMI) is raised on cycle 1 of the vertical blank scan lines and cleared on cycle 2 of the
+        // pre-render scan line.  Counted to the last post-render line, a line early.
+        const uint16_t lastPostRenderScanLine = vblankScanLine - 1;
+        if (curScanLine < lastPostRenderScanLine) {
+            return (lastPostRenderScanLine - curScanLine) * cyclesPerScanLine + 1 - scanLineCycle;
+        }
+        if (scanLineCycle <= 2) {
+            return scanLineCycle == 0 ? 1 : 0;
+        }
+        return cyclesPerScanLine - scanLineCycle + 1;
+    }
+
+    uint32_t Ppu2C02::getCyclesUntilFrameEnd() const {
+        // just past cycle 1 of the first vblank line
+        const uint32_t frameEnd = vblankScanLine * cyclesPerScanLine + 2;
+        const uint32_t cyclesPerFrame = scanLines * cyclesPerScanLine;
+        uint32_t position = curScanLine * cyclesPerScanLine + scanLineCycle;
+        uint32_t cycles = (frameEnd + cyclesPerFrame - position) % cyclesPerFrame;
+        return cycles != 0 ? cycles : cyclesPerFrame;
     }
 
     void loadTile() {
@@ -211,29 +324,113 @@ namespace NES {
 
             // Reload registers with data loaded during the last 8 cycles
             if (scanLineCycle % 8 == 1) {
-                DBG_ASSERT((bkrndTileMemory.patternTableL & 0x00ff) == 0, "expected background shift register L to be 0 on lsb at this point. Instead was $%04x", bkrndTileMemory.patternTableL);
-                DBG_ASSERT((bkrndTileMemory.patternTableR & 0x00ff) == 0, "expected background shift register R to be 0 on lsb at this point. Instead was $%04x", bkrndTileMemory.patternTableR);
-                bkrndTileMemory.patternTableL |= patternL;
-                bkrndTileMemory.patternTableR |= patternR;
-
-                // assemble attribute register from coarse x, y
-                // Gets the 2 bits associated with a 2x2 region of an at block representing 4x4 tiles of 8x8pixels each. This means the 2x2 tile is a 16x16px
-                // region of the screen which has to have the same most significant bits of the palette color.  The lower 2 bits of the coarseX/Y represent a 2x2 region.
-                // I don't really understand why some sources show a -1 on the coarseX scroll here... Others do something closer to below
-                //uint8_t atSubTile = attrTableEntry >> ((renderingRegisters.getCoarseYScroll() & 2) << 1) | ((renderingRegisters.getCoarseXScroll()) & 2);
-                uint8_t atSubTile = attrTableEntry;
-                if (renderingRegisters.getCoarseYScroll() & 2) {
-                    atSubTile >>= 4;
-                }
-                if (renderingRegisters.getCoarseXScroll() & 2) {
-                    atSubTile >>= 2;
+                reloadBackgroundShifters();
+            }
+
+        }
+    }
+
+    void Ppu2C02::reloadBackgroundShifters() {
+        DBG_ASSERT((bkrndTileMemory.patternTableL & 0x00ff) == 0, "expected background shift register L to be 0 on lsb at this point. Instead was $%04x", bkrndTileMemory.patternTableL);
+        DBG_ASSERT((bkrndTileMemory.patternTableR & 0x00ff) == 0, "expected background shift register R to be 0 on lsb at this point. Instead was $%04x", bkrndTileMemory.patternTableR);
+        bkrndTileMemory.patternTableL |= patternL;
+        bkrndTileMemory.patternTableR |= patternR;
+
+        // assemble attribute register from coarse x, y
+        // Gets the 2 bits associated with a 2x2 region of an at block representing 4x4 tiles of 8x8pixels each. This means the 2x2 tile is a 16x16px
+        // region of the screen which has to have the same most significant bits of the palette color.  The lower 2 bits of the coarseX/Y represent a 2x2 region.
+        // I don't really understand why some sources show a -1 on the coarseX scroll here... Others do something closer to below
+        //uint8_t atSubTile = attrTableEntry >> ((renderingRegisters.getCoarseYScroll() & 2) << 1) | ((renderingRegisters.getCoarseXScroll()) & 2);
+        uint8_t atSubTile = attrTableEntry;
+        if (renderingRegisters.getCoarseYScroll() & 2) {
+            atSubTile >>= 4;
+        }
+        if (renderingRegisters.getCoarseXScroll() & 2) {
+            atSubTile >>= 2;
+        }
+        bkrndTileMemory.attrTile = atSubTile;
+
+        // TODO sprite portion
+    }
+
+    void Ppu2C02::fetchTile() {
+        // the reads doPpuCycle makes on states 1, 3, 5 and 7 of a tile
+        ppuAddr = nameTableBaseAddr | 0xfff;
+        currentNameTable = getByte(ppuAddr);
+        ppuAddr = attributeTableBaseAddr |
+            (renderingRegisters.getNameTableSelect() << 10) |
+            ((renderingRegisters.getCoarseYScroll() >> 2) << 3) |
+            (renderingRegisters.getCoarseXScroll() >> 2);
+        attrTableEntry = getByte(ppuAddr);
+        ppuAddr = (uint16_t)ppuMemory.memoryMappedRegisters.getBackgroundPatternTable() * sizeof(PatternTable) + currentNameTable * sizeof(PatternTableEntry)
+            + renderingRegisters.getFineYScroll();
+        patternL |= (uint16_t)getByte(ppuAddr) << 8;
+        ppuAddr = (uint16_t)ppuMemory.memoryMappedRegisters.getBackgroundPatternTable() * sizeof(PatternTable) + currentNameTable * sizeof(PatternTableEntry)
+            + renderingRegisters.getFineYScroll() + 8;
+        patternR |= (uint16_t)getByte(ppuAddr) << 8;
+    }
+
+    void Ppu2C02::renderScanLine() {
+        if (dataWriteCount > 0) {
+            flushDataWrites();
+        }
+
+        // Cycles 1-256, a tile every 8.  The first tile was loaded on the line before, so there's no shift on cycle 1.
+        uint8_t *row = &renderBuffer.renderBuffer[3 * screen_w * (screen_h - curScanLine)];
+        for (uint16_t tile = 0; tile < 32; tile++) {
+            if (tile > 0) {
+                bkrndTileMemory.patternTableL <<= 1;
+                bkrndTileMemory.patternTableR <<= 1;
+                reloadBackgroundShifters();
+            }
+            fetchTile();
+
+            // the attribute is the same for all 8 pixels, so only the pattern bits pick between 4 colours
+            Pixel colors[4];
+            for (uint8_t bits = 0; bits < 4; bits++) {
+                uint8_t bkrndIndex = (bkrndTileMemory.attrTile << 2) | bits;
+                colors[bits] = CpuVariant::palette()[ppuMemory.colorPalette.getBkrndColorIndex(bkrndIndex)];
+            }
+            for (uint16_t x = 0; x < 8; x++) {
+                if (x > 0) {
+                    bkrndTileMemory.patternTableL <<= 1;
+                    bkrndTileMemory.patternTableR <<= 1;
                 }
-                bkrndTileMemory.attrTile = atSubTile;
+                const Pixel &pixel = colors[((bkrndTileMemory.patternTableR & 1) << 1) | (bkrndTileMemory.patternTableL & 1)];
+                uint8_t *out = &row[3 * (tile * 8 + x)];
+                out[0] = pixel.r;
+                out[1] = pixel.g;
+                out[2] = pixel.b;
+            }
+        }
+
+        // 257-320 sprite fetches
+        ppuMemory.memoryMappedRegisters.oamAddr = 0;
 
-                // TODO sprite portion
+        // 321-336 the first two tiles of the next line, drawn off the right of the screen.  Again no shift on 321.
+        for (uint16_t tile = 0; tile < 2; tile++) {
+            if (tile > 0) {
+                bkrndTileMemory.patternTableL <<= 1;
+                bkrndTileMemory.patternTableR <<= 1;
+                reloadBackgroundShifters();
             }
+            fetchTile();
+            bkrndTileMemory.patternTableL <<= 7;
+            bkrndTileMemory.patternTableR <<= 7;
+        }
 
+        // 337-340 the last shift and two name table fetches
+        bkrndTileMemory.patternTableL <<= 1;
+        bkrndTileMemory.patternTableR <<= 1;
+        reloadBackgroundShifters();
+        for (int i = 0; i < 2; i++) {
+            ppuAddr = nameTableBaseAddr | 0xfff;
+            currentNameTable = getByte(ppuAddr);
         }
+
+        cycle += cyclesPerScanLine;
+        curScanLine = (curScanLine + 1) % scanLines;
+        scanLineCycle = cycle % cyclesPerScanLine;
     }
 
     Pixel Ppu2C02::getScreenPixel() {
@@ -253,11 +450,12 @@ namespace NES {
         }
 
         // Map color palette index to RGB pixel
-        return colorPaletteNtsc[outColor];
+        return CpuVariant::palette()[outColor];
     }
 
 
     uint8_t Ppu2C02::readRegister(PPURegister ppuRegister) {
+        flushDataWrites();
         uint8_t val = 0;
         // TODO handle the fact that the lead capacitance means that reading CTRL, MASK, OAMADDR, SCROLL, ADDR
         //  for normally write-only registers will return that latched value which decays at some rate.
@@ -270,6 +468,7 @@ namespace NES {
             val = ppuMemory.memoryMappedRegisters.status;
             renderingRegisters.onStatusRead(ppuMemory.memoryMappedRegisters);           
             ppuMemory.memoryMappedRegisters.setVBlank(false);
+            updateNmiLine();
             break;
         case PPURegister::OAM_ADDRESS:
             break;
@@ -291,7 +490,7 @@ namespace NES {
                 // In the palette range, return the vram address immediately - don't require a dummy read from DATA
                 val = ppuMemory.memoryMappedRegisters.data;
             }
-            renderingRegisters.onDataAccess(ppuMemory.memoryMappedRegisters);
+            renderingRegisters.onDataAccess(ppuMemory.memoryMappedRegisters, isRendering());
             break;
         }
         return val;
@@ -301,6 +500,9 @@ namespace NES {
     // TODO maybe move the ppu interaction code out here since the registers don't really own any of that
     void Ppu2C02::writeRegister(PPURegister ppuRegister, uint8_t val) {
         RenderState renderState = getRenderState();
+        if (ppuRegister != PPURegister::DATA) {
+            flushDataWrites();
+        }
 
         switch (ppuRegister) {
         case PPURegister::PPUCTRL:
@@ -310,6 +512,8 @@ namespace NES {
             //}
             ppuMemory.memoryMappedRegisters.control = val;
             renderingRegisters.onControlWrite(ppuMemory.memoryMappedRegisters);
+            // enabling NMI during vblank raises it straight away
+            updateNmiLine();
             break;
         case PPURegister::PPUMASK:
             ppuMemory.memoryMappedRegisters.mask = val;
@@ -328,6 +532,7 @@ namespace NES {
                 break;
             } else {
                 ppuMemory.memoryMappedRegisters.oamData = val;
+                reinterpret_cast<uint8_t *>(spriteMemory.primaryOAM)[ppuMemory.memoryMappedRegisters.oamAddr] = val;
                 // oamaddr increments during rendering has some odd behavior.. Is this necessary to implement?
                 // see: http://wiki.nesdev.com/w/index.php/PPU_programmer_reference#OAM_data_.28.242004.29_.3C.3E_read.2Fwrite
                 ppuMemory.memoryMappedRegisters.oamAddr++;
@@ -345,11 +550,87 @@ namespace NES {
             break;
         case PPURegister::DATA:
             ppuMemory.memoryMappedRegisters.data = val;
-            renderingRegisters.onDataAccess(ppuMemory.memoryMappedRegisters);
+            if (isRendering()) {
+                // The vram address moves with the rendering increments, so write it now
+                flushDataWrites();
+                doMemoryOperation(renderingRegisters.vramAddress, val, false);
+                renderingRegisters.onDataAccess(ppuMemory.memoryMappedRegisters, true);
+                break;
+            }
+
+            if (dataWriteCount == dataWriteQueueSize) {
+                flushDataWrites();
+            }
+            if (dataWriteCount == 0) {
+                dataWriteAddress = renderingRegisters.vramAddress;
+                dataWriteIncrement = ppuMemory.memoryMappedRegisters.getDataAccessIncrement();
+            }
+            dataWrites[dataWriteCount++] = val;
+            renderingRegisters.onDataAccess(ppuMemory.memoryMappedRegisters, false);
             break;
         };
     }
 
+    void Ppu2C02::flushDataWrites() {
+        uint16_t i = 0;
+        while (i < dataWriteCount) {
+            uint16_t address = (uint16_t)(dataWriteAddress + i * dataWriteIncrement) % 0x4000;
+            if (address < 0x2000 || address >= nameTableBoundary) {
+                // CHR goes through the mapper and the palette entries are scattered, so one at a time
+                doMemoryOperation(address, dataWrites[i], false);
+                i++;
+                continue;
+            }
+
+            // Copy straight into the name table up to the end of its 1k (or the palettes in the $3c00 mirror)
+            uint8_t *nameTable = getNameTable(address);
+            uint16_t offset = address % 0x400;
+            uint16_t tableBase = address - offset;
+            uint16_t end = tableBase + 0x400 <= nameTableBoundary ? 0x400 : nameTableBoundary - tableBase;
+            uint16_t run = (end - offset + dataWriteIncrement - 1) / dataWriteIncrement;
+            if (run > dataWriteCount - i) {
+                run = dataWriteCount - i;
+            }
+            if (dataWriteIncrement == 1) {
+                memcpy(&nameTable[offset], &dataWrites[i], run);
+            } else {
+                for (uint16_t j = 0; j < run; j++) {
+                    nameTable[offset + j * dataWriteIncrement] = dataWrites[i + j];
+                }
+            }
+            i += run;
+        }
+        dataWriteCount = 0;
+    }
+
+    void Ppu2C02::writeOamDma(const uint8_t *data) {
+        // same as any other register access
+        flushDataWrites();
+        // starts at OAMADDR and wraps around back to it
+        uint8_t *oam = reinterpret_cast<uint8_t *>(spriteMemory.primaryOAM);
+        size_t start = ppuMemory.memoryMappedRegisters.oamAddr;
+        memcpy(&oam[start], data, sizeof(spriteMemory.primaryOAM) - start);
+        memcpy(oam, &data[sizeof(spriteMemory.primaryOAM) - start], start);
+        ppuMemory.memoryMappedRegisters.oamData = data[sizeof(spriteMemory.primaryOAM) - 1];
+    }
+
+    uint32_t Ppu2C02::getOamIdleCycles() const {
+        if (disabled) {
+            return 0xffffffff;
+        }
+        if (curScanLine < (uint16_t)RenderState::PostRenderScanLine) {
+            // pre-render (0) and visible scan lines
+            return 0;
+        }
+        return (scanLines - curScanLine) * cyclesPerScanLine - scanLineCycle;
+    }
+
+    bool Ppu2C02::isRendering() {
+        RenderState renderState = getRenderState();
+        return ppuMemory.memoryMappedRegisters.isRenderingEnabled() &&
+            (renderState == RenderState::VisibleScanLines || renderState == RenderState::PreRenderScanLine);
+    }
+
     void Ppu2C02::doRegisterUpdates() {
         //if (ppuMemory.memoryMappedRegisters.isRenderingEnabled()) {
 
@@ -384,32 +665,16 @@ namespace NES {
 
         // Cartridge-backed CHR-ROM is mapped here and bank-switched(if needed) via CPU memory
         if (address < 0x2000) {
-            return cartridge->mmc->doCHRMemoryOperationOperation(*cartridge, address, write, read);
+            if (!read) {
+                // CHR-RAM
+                chrTiles.invalidateAddress(address);
+            }
+            return mapperChrMemoryOperation(*cartridge, address, write, read);
         }
         // either internal vram or cart ram to enable 4 nametables
         else if (address < 0x3f00) {
-            // 0x3000-0x3eff is a mirror of 0x2000-0x2fff
-            uint16_t base = (address - 0x2000) % 0x1000;   // 4 1k nametables mirrored up to 2eff
-            size_t table = base / 0x400;
-            size_t offset = base % 0x400;
-
-            // 4 tables addressable, only 2 in ram so mirror them based on cartridge settings.
-            // See http://wiki.nesdev.com/w/index.php/Mirroring
-            switch (cartridge->mirroring) {
-            case PPUMirroring::PPU_VERTICAL:
-                table = table % 2;  // Configuration: 0, 1, 0, 1 
-                break;
-            case PPUMirroring::PPU_HORIZONTAL:
-                table = table / 2;  // Configuration: 0, 0, 1, 1
-                break;
-            default:
-                DBG_CRASH("Unsupported mirroring mode found %d", cartridge->mirroring);
-            };
-            if (base % 0x400 < 0x3c0) {
-                opAddr = &ppuMemory.nameTables[table].nameTable[offset];
-            } else {
-                opAddr = &ppuMemory.nameTables[table].attributeTable.tileGroup[offset - 0x3c0];
-            }
+            // name table bytes $000-$3bf then the attribute table $3c0-$3ff
+            opAddr = getNameTable(address) + address % 0x400;
         }
         // Palette memory ($3f00-$3f20 mirrored up to $4000)
         else if (address < 0x4000) {
@@ -448,6 +713,45 @@ namespace NES {
         return readResult;
     }
 
+    const uint8_t *Ppu2C02::getDecodedTileRow(uint8_t table, uint8_t tile, uint8_t row, bool flipped) {
+        if (chrTiles.chrBankState != cartridge->mmc->chrBankState) {
+            chrTiles.invalidate();
+            chrTiles.chrBankState = cartridge->mmc->chrBankState;
+        }
+
+        uint16_t index = (uint16_t)(table & 1) * 256 + tile;
+        ChrTileCache::DecodedTile &decoded = chrTiles.tiles[index];
+        if (!chrTiles.valid[index]) {
+            uint8_t planes[ChrTileCache::bytesPerTile];
+            for (uint16_t i = 0; i < ChrTileCache::bytesPerTile; i++) {
+                planes[i] = getByte(index * ChrTileCache::bytesPerTile + i);
+            }
+            ChrTileCache::decode(planes, decoded);
+            chrTiles.valid[index] = true;
+        }
+        return flipped ? decoded.flippedRows[row & 7] : decoded.rows[row & 7];
+    }
+
+    uint8_t *Ppu2C02::getNameTable(uint16_t address) {
+        // 0x3000-0x3eff is a mirror of 0x2000-0x2fff
+        uint16_t base = (address - 0x2000) % 0x1000;   // 4 1k nametables mirrored up to 2eff
+        size_t table = base / 0x400;
+
+        // 4 tables addressable, only 2 in ram so mirror them based on cartridge settings.
+        // See http://wiki.nesdev.com/w/index.php/Mirroring
+        switch (cartridge->mirroring) {
+        case PPUMirroring::PPU_VERTICAL:
+            table = table % 2;  // Configuration: 0, 1, 0, 1 
+            break;
+        case PPUMirroring::PPU_HORIZONTAL:
+            table = table / 2;  // Configuration: 0, 0, 1, 1
+            break;
+        default:
+            DBG_CRASH("Unsupported mirroring mode found %d", cartridge->mirroring);
+        };
+        return reinterpret_cast<uint8_t *>(&ppuMemory.nameTables[table]);
+    }
+
     bool Ppu2C02::isAddressInPaletteRange(uint16_t address) {
         address = address % 0x4000;
         return address >= 0x3f00 && address < 0x4000;
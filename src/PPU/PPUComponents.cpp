@@ -1,5 +1,6 @@
 #include <ControlDeck/PPU/PPUComponents.h>
 #include <ControlDeck/common.h>
+#include <cstring>
 
 namespace NES {
     /////////////////////////////////////////////////////////////////
@@ -275,8 +276,8 @@ namespace NES {
     static const uint16_t coarseXMask = 0x001f;
     static const uint16_t nameTableSelectMask = 0x0c00;
 
-    void PPURenderingRegisters::onDataAccess(PPURegisters &registers) {
-        if (registers.isRenderingEnabled()) {
+    void PPURenderingRegisters::onDataAccess(PPURegisters &registers, bool rendering) {
+        if (rendering) {
             // Code edge cases on increment from http://wiki.nesdev.com/w/index.php/PPU_scrolling#Wrapping_around
             // Coarse X increment / wraparound
             uint16_t coarseX = getCoarseXScroll();
@@ -360,4 +361,24 @@ namespace NES {
     uint8_t SystemColorPalette::getSpriteColorIndex(uint8_t index) {
         return 0;
     }
+
+    /////////////////////////////////////////////////////////////////
+    // CHR tile cache
+
+    void ChrTileCache::decode(const uint8_t *planes, DecodedTile &tile) {
+        // 8 bytes of bit 0 then 8 bytes of bit 1, see PatternTableEntry
+        for (int row = 0; row < 8; row++) {
+            uint8_t bit0 = planes[row];
+            uint8_t bit1 = planes[row + 8];
+            for (int x = 0; x < 8; x++) {
+                uint8_t index = (((bit1 >> (7 - x)) & 1) << 1) | ((bit0 >> (7 - x)) & 1);
+                tile.rows[row][x] = index;
+                tile.flippedRows[row][7 - x] = index;
+            }
+        }
+    }
+
+    void ChrTileCache::invalidate() {
+        memset(valid, 0, sizeof(valid));
+    }
 }
\ No newline at end of file
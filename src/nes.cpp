@@ -8,6 +8,7 @@ namespace NES {
 
         controlDeck.ppu.cartridge = &controlDeck.cart;
         controlDeck.cpu.ppu = &controlDeck.ppu;
+        controlDeck.ppu.interrupts = &controlDeck.cpu.interrupts;
         controlDeck.cpu.cartridge = &controlDeck.cart;
 
         controlDeck.cpu.debug = true;
@@ -19,24 +20,64 @@ namespace NES {
 
 
     DebugState step(NesControlDeck &nes) {
+        if (nes.recompiled.code != nullptr) {
+            return nes.recompiled.step();
+        }
+        if (nes.useJit) {
+            return nes.jit.step();
+        }
         return nes.cpu.processInstruction();
     }
 
-    DebugState nesLoop(NesControlDeck &nes, int numInstructions) {
-        bool countDown = numInstructions > -1;
-        DebugState dbgState;
-        int instructionCounter = 0;
-        while (instructionCounter < numInstructions) {
-            dbgState = nes.cpu.processInstruction();
-            if (countDown) {
-                instructionCounter++;
-            }
+    static uint64_t getInstructionsExecuted(NesControlDeck &nes) {
+        if (nes.recompiled.code != nullptr) {
+            return nes.recompiled.instructionsExecuted;
+        }
+        if (nes.useJit) {
+            return nes.jit.instructionsExecuted;
+        }
+        return nes.cpu.instructionsExecuted;
+    }
 
-            if (instructionCounter % 100 == 0 ) {
-                printf("i: %d\n", instructionCounter);
-            }
+    // At least cpuCycles cycles, through whatever step would use
+    static void runCycles(NesControlDeck &nes, uint32_t cpuCycles) {
+        if (nes.recompiled.code == nullptr && !nes.useJit && !nes.cpu.blockCacheEnabled) {
+            nes.cpu.runCycles(cpuCycles);
+            return;
+        }
+        uint64_t end = nes.cpu.getCycle() + cpuCycles;
+        while (nes.cpu.getCycle() < end) {
+            step(nes);
+        }
+    }
+
+    FrameStats runFrame(NesControlDeck &nes) {
+        Cpu2a03 &cpu = nes.cpu;
+        Ppu2C02 &ppu = nes.ppu;
+        cpu.catchUpPpu();
+        uint64_t frame = ppu.getFrameCount();
+        uint64_t startCycle = cpu.getCycle();
+        uint64_t startInstructions = getInstructionsExecuted(nes);
+        uint64_t startControllerReads = cpu.controllerReads;
+
+        if (ppu.disabled) {
+            // nothing to wait for, just a frame's worth
+            runCycles(nes, cpuCyclesForPpuCycles(ppu.getCyclesUntilFrameEnd()));
+        }
+        // Half the way to the end of the frame at a time, measured again from where the PPU got to since the extra
+        // reads the addressing modes make let it run ahead of the cpu cycle count.  The last stretch an instruction at
+        // a time, so an NMI raised with vblank isn't taken on the way.
+        while (ppu.getFrameCount() == frame && !ppu.disabled) {
+            uint32_t cpuCycles = ppu.getCyclesUntilFrameEnd() * CpuVariant::cpuClocks / CpuVariant::ppuClocks / 2;
+            runCycles(nes, cpuCycles > 16 ? cpuCycles : 1);
+            cpu.catchUpPpu();
         }
 
-        return dbgState;
+        FrameStats stats;
+        stats.frame = ppu.getFrameCount();
+        stats.cycles = (uint32_t)(cpu.getCycle() - startCycle);
+        stats.instructions = getInstructionsExecuted(nes) - startInstructions;
+        stats.lag = cpu.controllerReads == startControllerReads;
+        return stats;
     }
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::BlockCache;
+using NES::Cartridge;
+
+class BlockCacheTest : public CPUTest {
+protected:
+    virtual void SetUp() {
+        CPUTest::SetUp();
+        ppu.disabled = true;
+    }
+
+    void loadCountingLoop(Cpu2a03 &target) {
+        uint8_t program[] = {
+            0xa2, 0x00,     // $0200 LDX #$00
+            0xe8,           // $0202 INX
+            0xe0, 0x05,     // $0203 CPX #$05
+            0xd0, 0xfb,     // $0205 BNE $0202
+            0xa9, 0x42,     // $0207 LDA #$42
+            0x85, 0x10,     // $0209 STA $10
+        };
+        memcpy(&target.ram.ram[0x200], program, sizeof(program));
+        target.registers.programCounter = 0x200;
+    }
+};
+
+TEST_F(BlockCacheTest, cachedExecutionMatchesInterpreter) {
+    Cpu2a03 uncached = cpu;
+    loadCountingLoop(uncached);
+    loadCountingLoop(cpu);
+    cpu.blockCacheEnabled = true;
+
+    while (uncached.registers.programCounter != 0x20b) {
+        NES::DebugState expected = uncached.processInstruction();
+        NES::DebugState actual = cpu.processInstruction();
+        ASSERT_EQ(uncached.registers.programCounter, cpu.registers.programCounter);
+        EXPECT_EQ(uncached.registers.acc, cpu.registers.acc);
+        EXPECT_EQ(uncached.registers.x, cpu.registers.x);
+        EXPECT_EQ(uncached.registers.statusRegister, cpu.registers.statusRegister);
+        EXPECT_EQ(uncached.systemBus.addressBus, cpu.systemBus.addressBus);
+        EXPECT_EQ(uncached.systemBus.dataBus, cpu.systemBus.dataBus);
+        EXPECT_EQ(expected.opCode, actual.opCode);
+        EXPECT_EQ(expected.getCyclesExecuted(), actual.getCyclesExecuted());
+    }
+
+    EXPECT_EQ(5, cpu.registers.x);
+    EXPECT_EQ(0x42, cpu.ram.ram[0x10]);
+    EXPECT_GT(cpu.blockCache.hits, 0u);
+}
+
+TEST_F(BlockCacheTest, ramWriteInvalidatesDecodedCode) {
+    uint8_t program[] = {
+        0xa9, 0xca,         // $0300 LDA #$ca (DEX)
+        0x8d, 0x05, 0x03,   // $0302 STA $0305
+        0xe8,               // $0305 INX - replaced by the store above
+    };
+    memcpy(&cpu.ram.ram[0x300], program, sizeof(program));
+    cpu.registers.programCounter = 0x300;
+    cpu.registers.x = 0x10;
+    cpu.blockCacheEnabled = true;
+
+    cpu.processInstruction();
+    cpu.processInstruction();
+    EXPECT_EQ(1u, cpu.blockCache.invalidations);
+    cpu.processInstruction();
+
+    EXPECT_EQ(0x0f, cpu.registers.x);
+    EXPECT_EQ(0x306, cpu.registers.programCounter);
+}
+
+TEST_F(BlockCacheTest, bankSwitchFlushesCache) {
+    BankedRomMmc mmc;
+    memset(mmc.banks, 0, sizeof(mmc.banks));
+    mmc.banks[0][0] = 0xe8;     // INX
+    mmc.banks[1][0] = 0xca;     // DEX
+    Cartridge cart{};
+    cart.mmc = &mmc;
+    cpu.cartridge = &cart;
+    cpu.blockCacheEnabled = true;
+
+    cpu.registers.x = 0x10;
+    cpu.registers.programCounter = 0x8000;
+    cpu.processInstruction();
+    EXPECT_EQ(0x11, cpu.registers.x);
+
+    mmc.prgBankState = 1;
+    cpu.registers.programCounter = 0x8000;
+    cpu.processInstruction();
+    EXPECT_EQ(0x10, cpu.registers.x);
+
+    // Decoded again from the new bank
+    cpu.registers.programCounter = 0x8000;
+    cpu.processInstruction();
+    EXPECT_EQ(0x0f, cpu.registers.x);
+    EXPECT_EQ(2u, cpu.blockCache.misses);
+}
+
+TEST_F(BlockCacheTest, onlyRamAndPrgRomAreCacheable) {
+    EXPECT_TRUE(BlockCache::isCacheableAddress(0x0000));
+    EXPECT_TRUE(BlockCache::isCacheableAddress(0x1fff));
+    EXPECT_FALSE(BlockCache::isCacheableAddress(0x2002));
+    EXPECT_FALSE(BlockCache::isCacheableAddress(0x4016));
+    EXPECT_FALSE(BlockCache::isCacheableAddress(0x6000));
+    EXPECT_TRUE(BlockCache::isCacheableAddress(0x8000));
+    EXPECT_TRUE(BlockCache::isCacheableAddress(0xffff));
+}
@@ -71,4 +71,41 @@ TEST_F(CPU2A03Test, testSystemMemWrap) {
     for (uint16_t i = 0; i < 0x2000; i++) {
         EXPECT_EQ(GOOD_BYTE, cpu.readFromAddress(i));
     }
-}
\ No newline at end of file
+}
+TEST_F(CPU2A03Test, zeroPageOperationMatchesMemoryOperation) {
+    ppu.disabled = false;
+    getSequentialMemory();
+    for (uint16_t address : { 0x0000, 0x0080, 0x00ff, 0x0100, 0x01ff }) {
+        uint32_t ppuCycle = ppu.getCycle();
+        EXPECT_EQ(cpu.readFromAddress(address), cpu.readFromZeroPage(address));
+        // PAL runs 3.2 PPU cycles a bus cycle, so the two together come to 6 or 7 depending on the clock phase
+        EXPECT_GE(ppu.getCycle() - ppuCycle, 2 * NES::CpuVariant::ppuClocks / NES::CpuVariant::cpuClocks) << "a bus cycle each";
+        EXPECT_LE(ppu.getCycle() - ppuCycle, (2 * NES::CpuVariant::ppuClocks + NES::CpuVariant::cpuClocks - 1) / NES::CpuVariant::cpuClocks) << "a bus cycle each";
+
+        cpu.systemBus.addressBus = address;
+        cpu.systemBus.dataBus = 0xa5;
+        cpu.systemBus.read = false;
+        cpu.doZeroPageOperation();
+        EXPECT_EQ(0xa5, cpu.readFromAddress(address + 0x800)) << "not written to the RAM mirrors";
+    }
+}
+
+TEST_F(CPU2A03Test, stackPushInvalidatesDecodedCode) {
+    cpu.ram.ram[0x1f0] = 0xe8;  // INX
+    cpu.ram.ram[0x1f1] = 0xe8;  // INX
+    cpu.ram.ram[0x1f2] = 0x4c;  // JMP $01f0
+    cpu.ram.ram[0x1f3] = 0xf0;
+    cpu.ram.ram[0x1f4] = 0x01;
+    cpu.registers.programCounter = 0x1f0;
+    cpu.registers.stackPointer = 0xf1;
+    cpu.blockCacheEnabled = true;
+
+    cpu.processInstruction();
+    cpu.systemBus.dataBus = 0xca;   // DEX
+    cpu.pushDataBusToStack();
+    EXPECT_EQ(1u, cpu.blockCache.invalidations);
+
+    cpu.registers.x = 5;
+    cpu.processInstruction();
+    EXPECT_EQ(4, cpu.registers.x);
+}
@@ -4,6 +4,7 @@
 #include <ControlDeck/CPU/AddressingMode.h>
 #include <ControlDeck/CPU/cpu2A03.h>
 #include <ControlDeck/PPU/PPU2C02.h>
+#include "FixedRomMmc.h"
 
 using NES::SystemBus;
 using NES::SystemRam;
@@ -12,6 +13,9 @@ using NES::DMAData;
 using NES::Ppu2C02;
 using NES::Cpu2a03;
 
+// CPU cycles in a frame of the region the library is built for (CpuVariant), rounded down
+static const uint32_t cpuCyclesPerFrame = NES::CpuVariant::scanLines * 341 * NES::CpuVariant::cpuClocks / NES::CpuVariant::ppuClocks;
+
 class CPUTest : public testing::Test {
 protected:
     static const uint8_t GOOD_BYTE = 0x12;
@@ -19,6 +23,7 @@ protected:
     virtual void SetUp() {
         cpu = Cpu2a03();
         cpu.ppu = &ppu;
+        ppu.interrupts = &cpu.interrupts;
     }
 
     virtual void TearDown() {
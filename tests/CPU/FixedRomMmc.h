@@ -0,0 +1,62 @@
+#pragma once
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/PPU/PPU2C02.h>
+#include <ControlDeck/cartridge.h>
+
+// Cartridge the CPU tests and benchmarks run their programs from.  Kept free of gtest so the benchmarks can use it.
+
+// 32kb of PRG-ROM at $8000 with no bank switching, no CHR.  Counts writes to mapper space.
+class FixedRomMmc : public NES::MemoryManagementController {
+public:
+    void doMemoryOperation(NES::SystemBus &bus, NES::Cartridge &cart) override {
+        if (bus.read) {
+            bus.dataBus = rom[bus.addressBus - 0x8000];
+        } else {
+            writes++;
+            lastWrite = bus.dataBus;
+        }
+    }
+
+    uint8_t doCHRMemoryOperationOperation(NES::Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
+        return 0;
+    }
+
+    // vector is $fffa (NMI), $fffc (reset) or $fffe (IRQ)
+    void setVector(uint16_t vector, uint16_t address) {
+        rom[vector - 0x8000] = address & 0xff;
+        rom[vector - 0x8000 + 1] = address >> 8;
+    }
+
+    uint8_t rom[0x8000]{};
+    int writes{ 0 };
+    uint8_t lastWrite{ 0 };
+};
+
+// Minimal switchable mapper: $8000-$ffff maps the whole of one of two 32kb banks, bank 1 for odd prgBankStates so
+// tests can make as many distinct bank layouts as they like.  Writes are ignored.
+class BankedRomMmc : public NES::MemoryManagementController {
+public:
+    void doMemoryOperation(NES::SystemBus &bus, NES::Cartridge &cart) override {
+        if (bus.read) {
+            bus.dataBus = banks[prgBankState & 1][bus.addressBus - 0x8000];
+        }
+    }
+
+    uint8_t doCHRMemoryOperationOperation(NES::Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
+        return 0;
+    }
+
+    uint8_t banks[2][0x8000]{};
+};
+
+// Connects cpu and ppu to each other and to cart (whose mmc is set already) and starts the CPU at $8000 with the
+// stack pointer and flags reset leaves.
+inline void setUpFixedRom(NES::Cpu2a03 &cpu, NES::Ppu2C02 &ppu, NES::Cartridge &cart) {
+    ppu.cartridge = &cart;
+    cpu.ppu = &ppu;
+    ppu.interrupts = &cpu.interrupts;
+    cpu.cartridge = &cart;
+    cpu.registers.programCounter = 0x8000;
+    cpu.registers.stackPointer = 0xfd;
+    cpu.registers.statusRegister = 0x24;
+}
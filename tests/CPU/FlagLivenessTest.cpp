@@ -0,0 +1,179 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+using NES::FlagLiveness;
+using NES::ProcessorStatus;
+
+static const uint8_t carry = 1 << ProcessorStatus::CarryFlag;
+static const uint8_t zero = 1 << ProcessorStatus::ZeroFlag;
+
+// Adds in a loop where only the compare's carry and the decrement's zero are ever read
+static const uint8_t resetProgram[] = {
+    0xa2, 0x08,         // $8000 LDX #$08
+    0xa9, 0x40,         // $8002 LDA #$40
+    0x18,               // $8004 CLC
+    0x69, 0x41,         // $8005 ADC #$41     V and C dead
+    0xc9, 0x40,         // $8007 CMP #$40     C read by BCS
+    0xb0, 0x02,         // $8009 BCS $800d
+    0x0a,               // $800b ASL A        C dead
+    0xa8,               // $800c TAY
+    0xca,               // $800d DEX
+    0xd0, 0xf4,         // $800e BNE $8004
+    0x85, 0x10,         // $8010 STA $10
+    0x4c, 0x12, 0x80,   // $8012 JMP $8012
+};
+
+class FlagLivenessTest : public CPUTest {
+protected:
+    virtual void SetUp() {
+        CPUTest::SetUp();
+        ppu.disabled = true;
+        cart.mmc = &mmc;
+        cpu.cartridge = &cart;
+
+        for (int bank = 0; bank < 2; bank++) {
+            memcpy(mmc.banks[bank], resetProgram, sizeof(resetProgram));
+            mmc.banks[bank][0x7ffc] = 0x00;
+            mmc.banks[bank][0x7ffd] = 0x80;
+            mmc.banks[bank][0x7ffa] = 0x40;
+            mmc.banks[bank][0x7ffb] = 0x80;
+            mmc.banks[bank][0x7ffe] = 0x40;
+            mmc.banks[bank][0x7fff] = 0x80;
+        }
+        // bank 0 NMI/IRQ handler doesn't look at P
+        mmc.banks[0][0x40] = 0x40;  // $8040 RTI
+        // bank 1 handler pushes it
+        mmc.banks[1][0x40] = 0x08;  // $8040 PHP
+        mmc.banks[1][0x41] = 0x68;  // $8041 PLA
+        mmc.banks[1][0x42] = 0x40;  // $8042 RTI
+
+        cpu.registers.programCounter = 0x8000;
+        cpu.registers.stackPointer = 0xfd;
+    }
+
+    BankedRomMmc mmc;
+    Cartridge cart{};
+};
+
+TEST_F(FlagLivenessTest, liveFlagsAfterEachInstruction) {
+    FlagLiveness liveness;
+    EXPECT_EQ(0, liveness.getLiveFlags(cpu, 0x8000));
+    EXPECT_EQ(carry, liveness.getLiveFlags(cpu, 0x8004));   // ADC adds it in
+    EXPECT_EQ(0, liveness.getLiveFlags(cpu, 0x8005));
+    EXPECT_EQ(carry, liveness.getLiveFlags(cpu, 0x8007));
+    EXPECT_EQ(0, liveness.getLiveFlags(cpu, 0x800b));
+    EXPECT_EQ(zero, liveness.getLiveFlags(cpu, 0x800d));
+    EXPECT_EQ(0, liveness.getLiveFlags(cpu, 0x8012));
+    EXPECT_EQ(1u, liveness.analyses);
+
+    // RTI can return anywhere
+    EXPECT_EQ(FlagLiveness::allFlags, liveness.getLiveFlags(cpu, 0x8040));
+    // operand bytes and unreached ROM
+    EXPECT_EQ(FlagLiveness::allFlags, liveness.getLiveFlags(cpu, 0x8006));
+    EXPECT_EQ(FlagLiveness::allFlags, liveness.getLiveFlags(cpu, 0x9000));
+    // code in RAM isn't analysed
+    EXPECT_EQ(FlagLiveness::allFlags, liveness.getLiveFlags(cpu, 0x0300));
+}
+
+TEST_F(FlagLivenessTest, interruptHandlerReadsFlags) {
+    FlagLiveness liveness;
+    mmc.prgBankState = 1;
+    // the handler can run after any instruction
+    EXPECT_EQ(FlagLiveness::allFlags, liveness.getLiveFlags(cpu, 0x8005));
+    EXPECT_EQ(FlagLiveness::allFlags, liveness.getLiveFlags(cpu, 0x800b));
+}
+
+TEST_F(FlagLivenessTest, rebuiltOnBankSwitch) {
+    FlagLiveness liveness;
+    EXPECT_EQ(0, liveness.getLiveFlags(cpu, 0x8005));
+
+    mmc.prgBankState = 1;
+    EXPECT_EQ(FlagLiveness::allFlags, liveness.getLiveFlags(cpu, 0x8005));
+    EXPECT_EQ(2u, liveness.analyses);
+
+    // switching back reuses the first analysis
+    mmc.prgBankState = 0;
+    EXPECT_EQ(0, liveness.getLiveFlags(cpu, 0x8005));
+    EXPECT_EQ(2u, liveness.analyses);
+}
+
+TEST_F(FlagLivenessTest, leastRecentlyUsedLayoutDropped) {
+    FlagLiveness liveness;
+    const uint32_t maxBankStates = FlagLiveness::maxBankStates;
+    for (uint32_t bankState = 0; bankState < maxBankStates; bankState++) {
+        mmc.prgBankState = bankState;
+        liveness.getLiveFlags(cpu, 0x8005);
+    }
+    // touch layout 0 so layout 1 is the oldest
+    mmc.prgBankState = 0;
+    liveness.getLiveFlags(cpu, 0x8005);
+    EXPECT_EQ(maxBankStates, liveness.analyses);
+
+    mmc.prgBankState = maxBankStates;
+    EXPECT_EQ(0, liveness.getLiveFlags(cpu, 0x8005));
+    EXPECT_EQ(maxBankStates + 1, liveness.analyses);
+
+    // the rest are kept
+    mmc.prgBankState = 0;
+    liveness.getLiveFlags(cpu, 0x8005);
+    mmc.prgBankState = 2;
+    liveness.getLiveFlags(cpu, 0x8005);
+    EXPECT_EQ(maxBankStates + 1, liveness.analyses);
+
+    mmc.prgBankState = 1;
+    EXPECT_EQ(FlagLiveness::allFlags, liveness.getLiveFlags(cpu, 0x8005));
+    EXPECT_EQ(maxBankStates + 2, liveness.analyses);
+}
+
+TEST_F(FlagLivenessTest, copyKeepsBitmaps) {
+    Cpu2a03 copy = cpu;
+    {
+        FlagLiveness liveness;
+        EXPECT_EQ(0, liveness.getLiveFlags(cpu, 0x8005));
+        copy.flagLiveness = liveness;
+    }
+    EXPECT_EQ(0, copy.flagLiveness.getLiveFlags(copy, 0x8005));
+    EXPECT_EQ(1u, copy.flagLiveness.analyses);
+}
+
+TEST_F(FlagLivenessTest, deadFlagsSkipped) {
+    Cpu2a03 reference = cpu;
+    cpu.flagLivenessEnabled = true;
+
+    // through ADC $40 + $41, which overflows
+    for (int i = 0; i < 4; i++) {
+        reference.processInstruction();
+        cpu.processInstruction();
+    }
+    EXPECT_EQ(0x81, cpu.registers.acc);
+    EXPECT_TRUE(reference.registers.flagSet(ProcessorStatus::OverflowFlag));
+    EXPECT_FALSE(cpu.registers.flagSet(ProcessorStatus::OverflowFlag));
+}
+
+TEST_F(FlagLivenessTest, executionMatchesWithoutLiveness) {
+    Cpu2a03 reference = cpu;
+    cpu.flagLivenessEnabled = true;
+    Cpu2a03 cached = cpu;
+    cached.blockCacheEnabled = true;
+    cached.superInstructionsEnabled = true;
+
+    while (reference.registers.programCounter != 0x8012) {
+        reference.processInstruction();
+        cpu.processInstruction();
+        ASSERT_EQ(reference.registers.programCounter, cpu.registers.programCounter);
+        EXPECT_EQ(reference.registers.acc, cpu.registers.acc);
+        EXPECT_EQ(reference.registers.x, cpu.registers.x);
+        EXPECT_EQ(reference.registers.y, cpu.registers.y);
+        EXPECT_EQ(reference.getCycle(), cpu.getCycle());
+    }
+    while (cached.registers.programCounter != 0x8012) {
+        cached.processInstruction();
+    }
+    EXPECT_EQ(reference.ram.ram[0x10], cpu.ram.ram[0x10]);
+    EXPECT_EQ(reference.ram.ram[0x10], cached.ram.ram[0x10]);
+    EXPECT_EQ(reference.registers.y, cached.registers.y);
+    EXPECT_EQ(reference.getCycle(), cached.getCycle());
+}
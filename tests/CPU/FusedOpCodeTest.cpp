@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+using NES::MemoryManagementController;
+using NES::OpCode;
+
+// Read only PRG-ROM filled with a pattern, gives BRK a vector to load
+class PatternRomMmc : public MemoryManagementController {
+public:
+    void doMemoryOperation(SystemBus &bus, Cartridge &cart) override {
+        if (bus.read) {
+            bus.dataBus = (uint8_t)(bus.addressBus * 7);
+        }
+    }
+
+    uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
+        return 0;
+    }
+};
+
+class FusedOpCodeTest : public CPUTest {
+protected:
+    virtual void SetUp() {
+        CPUTest::SetUp();
+        ppu.disabled = true;
+        cart.mmc = &mmc;
+        cpu.cartridge = &cart;
+
+        // Keep every pointer and absolute operand inside system RAM so no PPU/APU registers are touched
+        for (int i = 0; i < SystemRam::systemRAMBytes; i++) {
+            cpu.ram.ram[i] = i < 0x100 ? (uint8_t)((i * 13) & 0x07) : (uint8_t)(i * 31);
+        }
+        cpu.registers.stackPointer = 0xfd;
+        cpu.registers.programCounter = 0x300;
+    }
+
+    void loadInstruction(Cpu2a03 &target, const OpCode &opCode) {
+        target.ram.ram[0x300] = opCode.opCode;
+        target.ram.ram[0x301] = 0xf4;     // page crossing with the index registers below
+        target.ram.ram[0x302] = 0x05;
+    }
+
+    PatternRomMmc mmc;
+    Cartridge cart{};
+};
+
+TEST_F(FusedOpCodeTest, everyOpCodeMatchesTableDispatch) {
+    const uint8_t registerValues[][4] = {
+        // a, x, y, p
+        { 0x00, 0x00, 0x00, 0x24 },
+        { 0x80, 0x10, 0x20, 0x01 },
+        { 0x7f, 0xff, 0x0c, 0xc3 },
+        { 0x01, 0x0b, 0xff, 0x82 },
+    };
+
+    int opCodesChecked = 0;
+    for (int op = 0; op < 256; op++) {
+        const OpCode &opCode = NES::InstructionSet::opCodes[op];
+        if (opCode.instruction == NES::Instruction::UNK) {
+            continue;
+        }
+        opCodesChecked++;
+
+        for (const uint8_t *values : registerValues) {
+            cpu.registers.acc = values[0];
+            cpu.registers.x = values[1];
+            cpu.registers.y = values[2];
+            cpu.registers.statusRegister = values[3];
+            cpu.registers.programCounter = 0x300;
+
+            Cpu2a03 table = cpu;
+            Cpu2a03 fused = cpu;
+            fused.fusedDispatchEnabled = true;
+            loadInstruction(table, opCode);
+            loadInstruction(fused, opCode);
+
+            NES::DebugState expected = table.processInstruction();
+            NES::DebugState actual = fused.processInstruction();
+            SCOPED_TRACE(testing::Message() << "op code " << std::hex << op);
+
+            ASSERT_EQ(table.registers.programCounter, fused.registers.programCounter);
+            EXPECT_EQ(table.registers.acc, fused.registers.acc);
+            EXPECT_EQ(table.registers.x, fused.registers.x);
+            EXPECT_EQ(table.registers.y, fused.registers.y);
+            EXPECT_EQ(table.registers.stackPointer, fused.registers.stackPointer);
+            EXPECT_EQ(table.registers.statusRegister, fused.registers.statusRegister);
+            EXPECT_EQ(table.systemBus.addressBus, fused.systemBus.addressBus);
+            EXPECT_EQ(table.systemBus.dataBus, fused.systemBus.dataBus);
+            EXPECT_EQ(expected.opCodeArgs.pagingCycles, actual.opCodeArgs.pagingCycles);
+            EXPECT_EQ(expected.opCodeArgs.numArgs, actual.opCodeArgs.numArgs);
+            EXPECT_EQ(0, memcmp(table.ram.ram, fused.ram.ram, SystemRam::systemRAMBytes));
+        }
+    }
+    EXPECT_EQ(151, opCodesChecked);
+}
+
+TEST_F(FusedOpCodeTest, fusedDispatchWithBlockCache) {
+    uint8_t program[] = {
+        0xa2, 0x00,     // $0200 LDX #$00
+        0xe8,           // $0202 INX
+        0x0a,           // $0203 ASL A
+        0x7d, 0x10, 0x00, // $0204 ADC $0010,X
+        0xe0, 0x05,     // $0207 CPX #$05
+        0xd0, 0xf7,     // $0209 BNE $0202
+    };
+    memcpy(&cpu.ram.ram[0x200], program, sizeof(program));
+    cpu.registers.programCounter = 0x200;
+
+    Cpu2a03 table = cpu;
+    cpu.fusedDispatchEnabled = true;
+    cpu.blockCacheEnabled = true;
+    while (table.registers.programCounter != 0x20b) {
+        table.processInstruction();
+        cpu.processInstruction();
+        ASSERT_EQ(table.registers.programCounter, cpu.registers.programCounter);
+        EXPECT_EQ(table.registers.acc, cpu.registers.acc);
+        EXPECT_EQ(table.registers.statusRegister, cpu.registers.statusRegister);
+    }
+    EXPECT_GT(cpu.blockCache.hits, 0u);
+}
@@ -0,0 +1,110 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+
+// Polls for the first vblank, waits for the NMI handler to bump a counter a few times, then spins on JMP *
+static const uint8_t waitProgram[] = {
+    0xad, 0x02, 0x20,   // $8000 LDA $2002
+    0x10, 0xfb,         // $8003 BPL $8000      wait for vblank
+    0xa9, 0x80,         // $8005 LDA #$80
+    0x8d, 0x00, 0x20,   // $8007 STA $2000      NMI on vblank
+    0xa9, 0x00,         // $800a LDA #$00
+    0x85, 0x10,         // $800c STA $10
+    0xa5, 0x10,         // $800e LDA $10
+    0xf0, 0xfc,         // $8010 BEQ $800e      wait for the NMI handler
+    0xa5, 0x11,         // $8012 LDA $11
+    0xc9, 0x04,         // $8014 CMP #$04
+    0x90, 0xf2,         // $8016 BCC $800a
+    0x4c, 0x1b, 0x80,   // $8018 JMP $801b
+    0x4c, 0x1b, 0x80,   // $801b JMP $801b
+};
+
+// NMI handler at $8040
+static const uint8_t nmiHandler[] = {
+    0xe6, 0x10,         // $8040 INC $10
+    0xe6, 0x11,         // $8042 INC $11
+    0x40,               // $8044 RTI
+};
+
+class IdleLoopTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        cart.mmc = &mmc;
+        memcpy(mmc.rom, waitProgram, sizeof(waitProgram));
+        memcpy(&mmc.rom[0x40], nmiHandler, sizeof(nmiHandler));
+        mmc.setVector(0xfffa, 0x8040);
+
+        setUpFixedRom(interpreted, interpretedPpu, cart);
+        setUpFixedRom(skipping, skippingPpu, cart);
+        skipping.blockCacheEnabled = true;
+        skipping.idleLoopSkipEnabled = true;
+    }
+
+    FixedRomMmc mmc;
+    Cartridge cart{};
+    Ppu2C02 interpretedPpu;
+    Ppu2C02 skippingPpu;
+    Cpu2a03 interpreted;
+    Cpu2a03 skipping;
+};
+
+TEST_F(IdleLoopTest, skipsLandOnInterpreterState) {
+    // a bit over six frames
+    while (skipping.getCycle() < 6 * cpuCyclesPerFrame + 1000) {
+        NES::DebugState state = skipping.processInstruction();
+        for (uint32_t i = 0; i < state.instructionCount; i++) {
+            interpreted.processInstruction();
+        }
+
+        ASSERT_EQ(interpreted.registers.programCounter, skipping.registers.programCounter);
+        ASSERT_EQ(interpreted.getCycle(), skipping.getCycle());
+        ASSERT_EQ(interpretedPpu.getCycle(), skippingPpu.getCycle());
+        EXPECT_EQ(interpreted.registers.acc, skipping.registers.acc);
+        EXPECT_EQ(interpreted.registers.statusRegister, skipping.registers.statusRegister);
+        EXPECT_EQ(interpreted.registers.stackPointer, skipping.registers.stackPointer);
+        EXPECT_EQ(interpreted.systemBus.addressBus, skipping.systemBus.addressBus);
+        EXPECT_EQ(interpreted.systemBus.dataBus, skipping.systemBus.dataBus);
+        EXPECT_EQ(interpretedPpu.ppuMemory.memoryMappedRegisters.status, skippingPpu.ppuMemory.memoryMappedRegisters.status);
+        ASSERT_EQ(0, memcmp(interpreted.ram.ram, skipping.ram.ram, SystemRam::systemRAMBytes));
+    }
+
+    // every frame's NMI was still taken
+    EXPECT_GE(skipping.ram.ram[0x11], 6);
+    EXPECT_EQ(0x801b, skipping.registers.programCounter);
+    // RAM wait, vblank poll and JMP *
+    EXPECT_EQ(3u, skipping.idleLoopStats.loopsDetected);
+    EXPECT_GT(skipping.idleLoopStats.fastForwards, 0u);
+    // most of the run is waiting
+    EXPECT_GT(skipping.idleLoopStats.cyclesSkipped, skipping.getCycle() / 2);
+}
+
+TEST_F(IdleLoopTest, loopsWithSideEffectsAreNotIdle) {
+    const uint8_t program[] = {
+        0xe6, 0x10,         // $8000 INC $10
+        0xa5, 0x10,         // $8002 LDA $10
+        0xd0, 0xfa,         // $8004 BNE $8000
+        0xad, 0x02, 0x20,   // $8006 LDA $2002
+        0x29, 0x80,         // $8009 AND #$80
+        0xf0, 0xf9,         // $800b BEQ $8006      status read isn't right before a BPL
+    };
+    memcpy(mmc.rom, program, sizeof(program));
+
+    while (skipping.getCycle() < 20000) {
+        skipping.processInstruction();
+    }
+    EXPECT_EQ(0u, skipping.idleLoopStats.loopsDetected);
+    EXPECT_EQ(0u, skipping.idleLoopStats.cyclesSkipped);
+}
+
+TEST_F(IdleLoopTest, nothingToWaitForWithPpuDisabled) {
+    skippingPpu.disabled = true;
+    skipping.registers.programCounter = 0x801b;
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(1u, skipping.processInstruction().instructionCount);
+    }
+    EXPECT_EQ(30u, skipping.getCycle());
+    EXPECT_EQ(0u, skipping.idleLoopStats.fastForwards);
+}
@@ -173,4 +173,48 @@ TEST_F(InstructionTest, plpTest) {
     EXPECT_EQ(0xcf, cpu.ram.ram[NES::stackBaseAddress + 0xfd]);
     EXPECT_EQ(0xcf, cpu.registers.statusRegister);    
     EXPECT_EQ(0xfd, cpu.registers.stackPointer);
-}
\ No newline at end of file
+}
+TEST_F(InstructionTest, adcDecimalModeTest) {
+    cpu.registers.setFlag(ProcessorStatus::DecimalMode);
+    cpu.registers.acc = 0x19;
+    cpu.systemBus.dataBus = 0x28;
+    ADC(opCodes[0x69], cpu);
+    if (NES::CpuVariant::decimalMode) {
+        EXPECT_EQ(0x47, cpu.registers.acc);
+    } else {
+        // the 2A03 ignores D
+        EXPECT_EQ(0x41, cpu.registers.acc);
+    }
+
+    cpu.registers.acc = 0x58;
+    cpu.systemBus.dataBus = 0x46;
+    cpu.registers.setFlag(ProcessorStatus::CarryFlag);
+    ADC(opCodes[0x69], cpu);
+    if (NES::CpuVariant::decimalMode) {
+        EXPECT_EQ(0x05, cpu.registers.acc);
+        EXPECT_TRUE(cpu.registers.flagSet(ProcessorStatus::CarryFlag));
+    } else {
+        EXPECT_EQ(0x9f, cpu.registers.acc);
+    }
+}
+
+TEST_F(InstructionTest, sbcDecimalModeTest) {
+    cpu.registers.setFlag(ProcessorStatus::DecimalMode);
+    cpu.registers.setFlag(ProcessorStatus::CarryFlag);
+    cpu.registers.acc = 0x40;
+    cpu.systemBus.dataBus = 0x01;
+    SBC(opCodes[0xe9], cpu);
+    if (NES::CpuVariant::decimalMode) {
+        EXPECT_EQ(0x39, cpu.registers.acc);
+        EXPECT_TRUE(cpu.registers.flagSet(ProcessorStatus::CarryFlag));
+
+        // borrow out of the high digit
+        cpu.registers.acc = 0x12;
+        cpu.systemBus.dataBus = 0x21;
+        SBC(opCodes[0xe9], cpu);
+        EXPECT_EQ(0x91, cpu.registers.acc);
+        EXPECT_FALSE(cpu.registers.flagSet(ProcessorStatus::CarryFlag));
+    } else {
+        EXPECT_EQ(0x3f, cpu.registers.acc);
+    }
+}
@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/CPU/InterruptController.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+using NES::InterruptController;
+using NES::InterruptType;
+
+static const uint8_t cliProgram[] = {
+    0xea,               // $8000 NOP
+    0xea,               // $8001 NOP
+    0x58,               // $8002 CLI
+    0x4c, 0x03, 0x80,   // $8003 JMP $8003
+};
+
+// IRQ handler at $8040, NMI handler at $8050
+static const uint8_t handlers[] = {
+    0xe6, 0x10,         // $8040 INC $10
+    0x40,               // $8042 RTI
+};
+
+static const uint8_t nmiHandler[] = {
+    0xe6, 0x11,         // $8050 INC $11
+    0x40,               // $8052 RTI
+};
+
+class InterruptControllerTest : public CPUTest {
+protected:
+    virtual void SetUp() {
+        CPUTest::SetUp();
+        cart.mmc = &mmc;
+        memcpy(mmc.rom, cliProgram, sizeof(cliProgram));
+        memcpy(&mmc.rom[0x40], handlers, sizeof(handlers));
+        memcpy(&mmc.rom[0x50], nmiHandler, sizeof(nmiHandler));
+        mmc.setVector(0xfffa, 0x8050);
+        mmc.setVector(0xfffe, 0x8040);
+        setUpFixedRom(cpu, ppu, cart);
+    }
+
+    FixedRomMmc mmc;
+    Cartridge cart{};
+};
+
+TEST_F(InterruptControllerTest, nmiLatchesOnRisingEdgeOnly) {
+    InterruptController interrupts;
+    EXPECT_FALSE(interrupts.isPending());
+
+    interrupts.setNmiLine(true);
+    interrupts.setNmiLine(true);
+    EXPECT_TRUE(interrupts.isNmiPending());
+    EXPECT_EQ(InterruptType::INT_NMI, interrupts.acknowledge(true));
+    EXPECT_FALSE(interrupts.isPending());
+
+    // held high isn't another edge
+    interrupts.setNmiLine(true);
+    EXPECT_FALSE(interrupts.isPending());
+
+    // and dropping the line doesn't take back a latched NMI
+    interrupts.setNmiLine(false);
+    interrupts.setNmiLine(true);
+    interrupts.setNmiLine(false);
+    EXPECT_EQ(InterruptType::INT_NMI, interrupts.acknowledge(false));
+    EXPECT_EQ(InterruptType::INT_NONE, interrupts.acknowledge(false));
+}
+
+TEST_F(InterruptControllerTest, irqIsHeldUntilEverySourceReleases) {
+    InterruptController interrupts;
+    interrupts.assertIrq(NES::IRQ_APU_FRAME_COUNTER);
+    interrupts.assertIrq(NES::IRQ_MAPPER);
+    EXPECT_EQ(NES::IRQ_APU_FRAME_COUNTER | NES::IRQ_MAPPER, interrupts.getIrqSources());
+
+    // taking it doesn't acknowledge the device
+    EXPECT_EQ(InterruptType::INT_IRQ, interrupts.acknowledge(false));
+    EXPECT_EQ(InterruptType::INT_IRQ, interrupts.acknowledge(false));
+
+    interrupts.releaseIrq(NES::IRQ_APU_FRAME_COUNTER);
+    EXPECT_TRUE(interrupts.isPending());
+    interrupts.releaseIrq(NES::IRQ_MAPPER);
+    EXPECT_FALSE(interrupts.isPending());
+    EXPECT_EQ(InterruptType::INT_NONE, interrupts.acknowledge(false));
+}
+
+TEST_F(InterruptControllerTest, priorityIsResetNmiIrq) {
+    InterruptController interrupts;
+    interrupts.assertIrq(NES::IRQ_DMC);
+    interrupts.raiseNmi();
+    interrupts.raiseReset();
+    EXPECT_EQ(InterruptType::INT_RESET, interrupts.acknowledge(false));
+    EXPECT_EQ(InterruptType::INT_NMI, interrupts.acknowledge(false));
+    // masked IRQ stays pending
+    EXPECT_EQ(InterruptType::INT_NONE, interrupts.acknowledge(true));
+    EXPECT_TRUE(interrupts.isPending());
+    EXPECT_EQ(InterruptType::INT_IRQ, interrupts.acknowledge(false));
+}
+
+TEST_F(InterruptControllerTest, maskedIrqIsTakenAfterCli) {
+    cpu.setIrq(NES::IRQ_MAPPER);
+    cpu.processInstruction();   // NOP
+    cpu.processInstruction();   // NOP
+    EXPECT_EQ(0x8002, cpu.registers.programCounter);
+    cpu.processInstruction();   // CLI
+    EXPECT_TRUE(cpu.interrupts.isPending());
+
+    cpu.processInstruction();   // IRQ
+    EXPECT_EQ(0x8040, cpu.registers.programCounter);
+    EXPECT_TRUE(cpu.registers.flagSet(NES::ProcessorStatus::InterruptDisable));
+    cpu.processInstruction();   // INC $10
+    cpu.processInstruction();   // RTI
+
+    // the source still holds the line, so it comes straight back
+    cpu.processInstruction();
+    EXPECT_EQ(0x8040, cpu.registers.programCounter);
+    cpu.processInstruction();
+    cpu.processInstruction();
+    EXPECT_EQ(2, cpu.ram.ram[0x10]);
+
+    cpu.clearIrq(NES::IRQ_MAPPER);
+    for (int i = 0; i < 10; i++) {
+        cpu.processInstruction();
+    }
+    EXPECT_EQ(0x8003, cpu.registers.programCounter);
+    EXPECT_EQ(2, cpu.ram.ram[0x10]);
+}
+
+TEST_F(InterruptControllerTest, enablingNmiDuringVblankRaisesIt) {
+    ppu.ppuMemory.memoryMappedRegisters.setVBlank(true);
+    EXPECT_FALSE(cpu.interrupts.isPending());
+
+    ppu.writeRegister(NES::PPURegister::PPUCTRL, 0x80);
+    EXPECT_TRUE(cpu.interrupts.isNmiPending());
+    cpu.processInstruction();
+    EXPECT_EQ(0x8050, cpu.registers.programCounter);
+
+    // reading status drops vblank and the line, enabling again outside vblank does nothing
+    ppu.readRegister(NES::PPURegister::STATUS);
+    ppu.writeRegister(NES::PPURegister::PPUCTRL, 0x00);
+    ppu.writeRegister(NES::PPURegister::PPUCTRL, 0x80);
+    EXPECT_FALSE(cpu.interrupts.isPending());
+}
+
+TEST_F(InterruptControllerTest, oneNmiPerFrame) {
+    cpu.registers.programCounter = 0x8003;
+    ppu.writeRegister(NES::PPURegister::PPUCTRL, 0x80);
+    // two vblanks
+    while (cpu.getCycle() < 60000) {
+        cpu.processInstruction();
+    }
+    EXPECT_EQ(2, cpu.ram.ram[0x11]);
+}
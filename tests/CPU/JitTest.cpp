@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/CPU/Jit.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+using NES::Jit;
+
+class JitTest : public CPUTest {
+protected:
+    virtual void SetUp() {
+        CPUTest::SetUp();
+        ppu.disabled = true;
+        cart.mmc = &mmc;
+        setUpFixedRom(cpu, ppu, cart);
+    }
+
+    void load(const uint8_t *program, size_t size) {
+        memcpy(mmc.rom, program, size);
+        cpu.registers.programCounter = 0x8000;
+    }
+
+    // Run until the program counter reaches end, returns instructions executed
+    uint64_t runUntil(Jit &jit, uint16_t end) {
+        int steps = 0;
+        while (cpu.registers.programCounter != end && steps++ < 100000) {
+            jit.step();
+        }
+        EXPECT_EQ(end, cpu.registers.programCounter);
+        return jit.instructionsExecuted;
+    }
+
+    FixedRomMmc mmc;
+    Cartridge cart{};
+};
+
+// Fill $0200-$02ff with a pattern, sum it up with shifts and compares along the way
+static const uint8_t loopProgram[] = {
+    0xa2, 0x00,         // $8000 LDX #$00
+    0xa0, 0x10,         // $8002 LDY #$10
+    0x8a,               // $8004 TXA
+    0x49, 0x5a,         // $8005 EOR #$5a
+    0x9d, 0x00, 0x02,   // $8007 STA $0200,X
+    0x0a,               // $800a ASL A
+    0x2a,               // $800b ROL A
+    0x29, 0x3f,         // $800c AND #$3f
+    0x09, 0x40,         // $800e ORA #$40
+    0x85, 0x10,         // $8010 STA $10
+    0xe6, 0x11,         // $8012 INC $11
+    0xc9, 0x50,         // $8014 CMP #$50
+    0x24, 0x10,         // $8016 BIT $10
+    0xbd, 0x00, 0x02,   // $8018 LDA $0200,X
+    0xcd, 0x00, 0x80,   // $801b CMP $8000
+    0x88,               // $801e DEY
+    0xe8,               // $801f INX
+    0xd0, 0xe2,         // $8020 BNE $8004
+    0x4c, 0x30, 0x80,   // $8022 JMP $8030
+};
+
+TEST_F(JitTest, loopMatchesInterpreter) {
+    load(loopProgram, sizeof(loopProgram));
+
+    Cpu2a03 interpreted;
+    interpreted.ram = cpu.ram;
+    interpreted.registers = cpu.registers;
+    interpreted.cartridge = &cart;
+    interpreted.ppu = &ppu;
+    while (interpreted.registers.programCounter != 0x8030) {
+        interpreted.processInstruction();
+    }
+
+    Jit jit(cpu);
+    jit.differential = true;
+    runUntil(jit, 0x8030);
+
+    EXPECT_EQ(0u, jit.differentialMismatches);
+    EXPECT_EQ(interpreted.registers.acc, cpu.registers.acc);
+    EXPECT_EQ(interpreted.registers.x, cpu.registers.x);
+    EXPECT_EQ(interpreted.registers.y, cpu.registers.y);
+    EXPECT_EQ(interpreted.registers.statusRegister, cpu.registers.statusRegister);
+    EXPECT_EQ(0, memcmp(interpreted.ram.ram, cpu.ram.ram, NES::SystemRam::systemRAMBytes));
+    EXPECT_EQ(0, cpu.ram.ram[0x11]);    // 256 increments
+    if (Jit::isSupported()) {
+        EXPECT_GT(jit.blocksCompiled, 0u);
+        EXPECT_GT(jit.jitInstructions, 0u);
+    }
+}
+
+TEST_F(JitTest, mapperWritesGoThroughDoMemoryOperation) {
+    const uint8_t program[] = {
+        0xa2, 0x08,         // $8000 LDX #$08
+        0xa9, 0x07,         // $8002 LDA #$07
+        0x8d, 0x00, 0x80,   // $8004 STA $8000 (mapper register)
+        0xca,               // $8007 DEX
+        0xd0, 0xf8,         // $8008 BNE $8002
+        0x4c, 0x20, 0x80,   // $800a JMP $8020
+    };
+    load(program, sizeof(program));
+
+    Jit jit(cpu);
+    runUntil(jit, 0x8020);
+
+    EXPECT_EQ(8, mmc.writes);
+    EXPECT_EQ(7, mmc.lastWrite);
+    EXPECT_EQ(0, cpu.registers.x);
+}
+
+TEST_F(JitTest, differentialModeWritesTheMapperOnce) {
+    const uint8_t program[] = {
+        0xa2, 0x40,         // $8000 LDX #$40
+        0xa9, 0x07,         // $8002 LDA #$07
+        0x8d, 0x00, 0x80,   // $8004 STA $8000 (mapper register)
+        0xca,               // $8007 DEX
+        0xd0, 0xf8,         // $8008 BNE $8002
+        0x4c, 0x20, 0x80,   // $800a JMP $8020
+    };
+    load(program, sizeof(program));
+
+    Jit jit(cpu);
+    jit.differential = true;
+    uint32_t storeBlocks = 0;
+    for (int steps = 0; cpu.registers.programCounter != 0x8020 && steps < 100000; steps++) {
+        uint16_t start = cpu.registers.programCounter;
+        uint32_t blocksRun = jit.blocksRun;
+        int writes = mmc.writes;
+        jit.step();
+        if (start == 0x8002 && jit.blocksRun != blocksRun) {
+            // the interpreter's check gets the write from the log, it doesn't make it again
+            EXPECT_EQ(writes + 1, mmc.writes);
+            storeBlocks++;
+        }
+    }
+
+    EXPECT_EQ(0x40, mmc.writes);
+    EXPECT_EQ(7, mmc.lastWrite);
+    EXPECT_EQ(0u, jit.differentialMismatches);
+    if (Jit::isSupported()) {
+        EXPECT_GT(storeBlocks, 0u);
+    }
+}
+
+TEST_F(JitTest, unsupportedInstructionsFallBackToInterpreter) {
+    const uint8_t program[] = {
+        0xa2, 0x20,         // $8000 LDX #$20
+        0x18,               // $8002 CLC
+        0x69, 0x01,         // $8003 ADC #$01 (interpreter only)
+        0xca,               // $8005 DEX
+        0xd0, 0xfa,         // $8006 BNE $8002
+        0x4c, 0x20, 0x80,   // $8008 JMP $8020
+    };
+    load(program, sizeof(program));
+    cpu.registers.acc = 0;
+
+    Jit jit(cpu);
+    jit.differential = true;
+    uint64_t instructions = runUntil(jit, 0x8020);
+
+    EXPECT_EQ(0x20, cpu.registers.acc);
+    EXPECT_EQ(0u, jit.differentialMismatches);
+    EXPECT_EQ(1u + 4 * 0x20 + 1, instructions);
+    EXPECT_LT(jit.jitInstructions, instructions);
+}
+
+TEST_F(JitTest, disabledJitOnlyInterprets) {
+    load(loopProgram, sizeof(loopProgram));
+
+    Jit jit(cpu);
+    jit.enabled = false;
+    runUntil(jit, 0x8030);
+
+    EXPECT_EQ(0u, jit.blocksCompiled);
+    EXPECT_EQ(0u, jit.jitInstructions);
+    EXPECT_EQ(0, cpu.ram.ram[0x11]);
+}
@@ -0,0 +1,132 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+using NES::MemoryManagementController;
+using NES::MemoryPage;
+using NES::NRom;
+using NES::PrgRom;
+
+// Two 32kb banks at $8000 picked by any write there, and 8kb of PRG-RAM at $6000.  Counts the accesses it sees.
+class PagedMmc : public MemoryManagementController {
+public:
+    void doMemoryOperation(SystemBus &bus, Cartridge &cart) override {
+        accesses++;
+        if (bus.addressBus < 0x8000) {
+            // I/O or expansion, nothing there
+        } else if (bus.read) {
+            bus.dataBus = banks[bank][bus.addressBus - 0x8000];
+        } else {
+            bank = bus.dataBus & 1;
+            prgBankState = bank;
+            mapPrgPages(cart);
+        }
+    }
+
+    uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
+        return 0;
+    }
+
+    void mapPrgPages(Cartridge &cart) override {
+        for (size_t i = 0; i < sizeof(prgRam) >> MemoryPage::pageBits; i++) {
+            prgReadPages[(0x6000 >> MemoryPage::pageBits) + i] = &prgRam[i << MemoryPage::pageBits];
+            prgWritePages[(0x6000 >> MemoryPage::pageBits) + i] = &prgRam[i << MemoryPage::pageBits];
+        }
+        for (size_t i = 0; i < sizeof(banks[0]) >> MemoryPage::pageBits; i++) {
+            prgReadPages[(0x8000 >> MemoryPage::pageBits) + i] = &banks[bank][i << MemoryPage::pageBits];
+        }
+    }
+
+    uint8_t banks[2][0x8000]{};
+    uint8_t prgRam[0x2000]{};
+    uint8_t bank{ 0 };
+    uint32_t accesses{ 0 };
+};
+
+class MemoryMapTest : public CPUTest {
+protected:
+    virtual void SetUp() {
+        CPUTest::SetUp();
+        ppu.disabled = true;
+        cart.mmc = &mmc;
+        cpu.cartridge = &cart;
+        for (int i = 0; i < 0x8000; i++) {
+            mmc.banks[0][i] = (uint8_t)i;
+            mmc.banks[1][i] = (uint8_t)~i;
+        }
+    }
+
+    void write(uint16_t address, uint8_t value) {
+        cpu.systemBus.addressBus = address;
+        cpu.systemBus.dataBus = value;
+        cpu.systemBus.read = false;
+        cpu.doMemoryOperation();
+    }
+
+    PagedMmc mmc;
+    Cartridge cart{};
+};
+
+TEST_F(MemoryMapTest, directPrgRomReads) {
+    // the first access maps the cartridge in
+    EXPECT_EQ(0x34, cpu.readFromAddress(0x9234));
+    EXPECT_EQ(1u, mmc.accesses);
+
+    EXPECT_EQ(0x34, cpu.readFromAddress(0x9234));
+    EXPECT_EQ(0xff, cpu.readFromAddress(0xffff));
+    EXPECT_EQ(0x00, cpu.readFromAddress(0x8000));
+    EXPECT_EQ(1u, mmc.accesses);
+}
+
+TEST_F(MemoryMapTest, directPrgRamReadsAndWrites) {
+    cpu.readFromAddress(0x8000);
+    write(0x6000, 0x5a);
+    write(0x7fff, 0xa5);
+    EXPECT_EQ(0x5a, mmc.prgRam[0]);
+    EXPECT_EQ(0xa5, mmc.prgRam[0x1fff]);
+    EXPECT_EQ(0x5a, cpu.readFromAddress(0x6000));
+    EXPECT_EQ(1u, mmc.accesses);
+
+    // no direct pages for expansion space, or $4020 sharing a page with the I/O registers
+    cpu.readFromAddress(0x5000);
+    cpu.readFromAddress(0x4020);
+    EXPECT_EQ(3u, mmc.accesses);
+}
+
+TEST_F(MemoryMapTest, bankSwitchRemapsPages) {
+    EXPECT_EQ(0x34, cpu.readFromAddress(0x9234));
+    write(0x8000, 1);
+    EXPECT_EQ(0xcb, cpu.readFromAddress(0x9234));
+    EXPECT_EQ(0xcb, cpu.peekCodeByte(0x9234));
+    write(0x8000, 0);
+    EXPECT_EQ(0x34, cpu.readFromAddress(0x9234));
+    EXPECT_EQ(3u, mmc.accesses);
+}
+
+TEST_F(MemoryMapTest, ramMirrorsAndIo) {
+    write(0x1801, 0x77);
+    EXPECT_EQ(0x77, cpu.ram.ram[1]);
+    EXPECT_EQ(0x77, cpu.readFromAddress(0x0801));
+
+    write(0x4014, 0x02);
+    EXPECT_TRUE(cpu.dmaData.isActive);
+    EXPECT_EQ(0x02, cpu.dmaData.baseAddress);
+    EXPECT_EQ(0u, mmc.accesses);
+}
+
+TEST_F(MemoryMapTest, nromMirrorsFirstBank) {
+    PrgRom prgRom[1];
+    for (int i = 0; i < NES::prgRomBankSize; i++) {
+        prgRom[0].rom[i] = (uint8_t)(i >> 8);
+    }
+    NRom nrom(false);
+    cart.prgRom = prgRom;
+    cart.mmc = &nrom;
+    cpu.mapCartridge();
+
+    EXPECT_EQ(0x12, cpu.readFromAddress(0x9234));
+    EXPECT_EQ(0x12, cpu.readFromAddress(0xd234));
+    EXPECT_EQ(0x3f, cpu.readFromAddress(0xffff));
+}
@@ -0,0 +1,154 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+
+// Turns on rendering and the vblank NMI and copies a page to OAM mid-frame, then keeps changing the page while the
+// NMI handler copies it again every vblank
+static const uint8_t frameProgram[] = {
+    0xa9, 0x1e,         // $8000 LDA #$1e
+    0x8d, 0x01, 0x20,   // $8002 STA $2001      show background and sprites
+    0xa9, 0x80,         // $8005 LDA #$80
+    0x8d, 0x00, 0x20,   // $8007 STA $2000      NMI on vblank
+    0xa9, 0x02,         // $800a LDA #$02
+    0x8d, 0x14, 0x40,   // $800c STA $4014      OAM DMA from $0200 while rendering
+    0xfe, 0x00, 0x02,   // $800f INC $0200,X
+    0xe8,               // $8012 INX
+    0x4c, 0x0f, 0x80,   // $8013 JMP $800f
+};
+
+// NMI handler at $8040
+static const uint8_t nmiHandler[] = {
+    0xa9, 0x02,         // $8040 LDA #$02       source page, patched by the tests
+    0x8d, 0x14, 0x40,   // $8042 STA $4014
+    0xe6, 0x11,         // $8045 INC $11
+    0x40,               // $8047 RTI
+};
+
+const uint16_t bulkDmaCycles = 513;
+
+class OamDmaTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        cart.mmc = &mmc;
+        memcpy(mmc.rom, frameProgram, sizeof(frameProgram));
+        memcpy(&mmc.rom[0x40], nmiHandler, sizeof(nmiHandler));
+        mmc.setVector(0xfffa, 0x8040);
+        for (int i = 0; i < 0x100; i++) {
+            mmc.rom[0x100 + i] = (uint8_t)(0xff - i);
+        }
+
+        setUp(perCyclePpu, perCycle);
+        setUp(bulkPpu, bulk);
+        bulk.bulkOamDmaEnabled = true;
+    }
+
+    void setUp(Ppu2C02 &ppu, Cpu2a03 &cpu) {
+        setUpFixedRom(cpu, ppu, cart);
+        for (int i = 0; i < 0x100; i++) {
+            cpu.ram.ram[0x200 + i] = (uint8_t)i;
+        }
+    }
+
+    // Runs both CPUs up to cycles, the per-cycle one catching up after every bulk call.  Returns how many
+    // transfers took the bulk path.
+    uint32_t runInLockstep(uint32_t cycles) {
+        uint32_t bulkTransfers = 0;
+        while (bulk.getCycle() < cycles) {
+            uint32_t start = bulk.getCycle();
+            bulk.processInstruction();
+            if (bulk.getCycle() - start >= bulkDmaCycles) {
+                bulkTransfers++;
+            }
+            do {
+                perCycle.processInstruction();
+            } while (perCycle.getCycle() < bulk.getCycle());
+            expectSameState();
+        }
+        return bulkTransfers;
+    }
+
+    void expectSameState() {
+        ASSERT_EQ(perCycle.getCycle(), bulk.getCycle());
+        ASSERT_EQ(perCycle.registers.programCounter, bulk.registers.programCounter);
+        ASSERT_EQ(perCyclePpu.getCycle(), bulkPpu.getCycle());
+        EXPECT_EQ(perCycle.registers.acc, bulk.registers.acc);
+        EXPECT_EQ(perCycle.registers.x, bulk.registers.x);
+        EXPECT_EQ(perCycle.dmaData.isActive, bulk.dmaData.isActive);
+        EXPECT_EQ(perCyclePpu.ppuMemory.memoryMappedRegisters.oamAddr, bulkPpu.ppuMemory.memoryMappedRegisters.oamAddr);
+        EXPECT_EQ(perCyclePpu.ppuMemory.memoryMappedRegisters.oamData, bulkPpu.ppuMemory.memoryMappedRegisters.oamData);
+        ASSERT_EQ(0, memcmp(perCyclePpu.spriteMemory.primaryOAM, bulkPpu.spriteMemory.primaryOAM, sizeof(bulkPpu.spriteMemory.primaryOAM)));
+    }
+
+    FixedRomMmc mmc;
+    Cartridge cart{};
+    Ppu2C02 perCyclePpu;
+    Ppu2C02 bulkPpu;
+    Cpu2a03 perCycle;
+    Cpu2a03 bulk;
+};
+
+TEST_F(OamDmaTest, vblankTransfersFromRam) {
+    // four frames
+    uint32_t bulkTransfers = runInLockstep(4 * cpuCyclesPerFrame);
+
+    // the first transfer is mid-frame and stays per-cycle
+    EXPECT_GE(bulk.ram.ram[0x11], 3);
+    EXPECT_EQ(bulk.ram.ram[0x11], bulkTransfers);
+    EXPECT_EQ(0, memcmp(perCyclePpu.renderBuffer.renderBuffer, bulkPpu.renderBuffer.renderBuffer, sizeof(bulkPpu.renderBuffer.renderBuffer)));
+}
+
+TEST_F(OamDmaTest, vblankTransfersFromPrgRom) {
+    mmc.rom[0x41] = 0x81;
+    uint32_t bulkTransfers = runInLockstep(4 * cpuCyclesPerFrame);
+
+    EXPECT_GE(bulkTransfers, 3u);
+    const uint8_t *oam = reinterpret_cast<const uint8_t *>(bulkPpu.spriteMemory.primaryOAM);
+    for (int i = 0; i < 0x100; i++) {
+        EXPECT_EQ(0xff - i, oam[i]);
+    }
+}
+
+TEST_F(OamDmaTest, ioSourceStaysPerCycle) {
+    // $4000 reads go through the APU/IO registers
+    mmc.rom[0x41] = 0x40;
+    EXPECT_EQ(0u, runInLockstep(60000));
+}
+
+TEST_F(OamDmaTest, oddAndEvenStartCycles) {
+    // STA $4014 from RAM, after a 3 cycle LDA $00 the first time round (odd start, then even)
+    const uint8_t program[] = { 0xa5, 0x00, 0xa9, 0x02, 0x8d, 0x14, 0x40 };
+    for (Cpu2a03 *cpu : { &perCycle, &bulk }) {
+        cpu->ppu->disabled = true;
+        memcpy(&cpu->ram.ram[0x300], program, sizeof(program));
+    }
+
+    for (int skipLoad = 0; skipLoad < 2; skipLoad++) {
+        perCycle.registers.programCounter = bulk.registers.programCounter = 0x300 + skipLoad * 2;
+        for (int i = skipLoad; i < 3; i++) {
+            perCycle.processInstruction();
+            bulk.processInstruction();
+        }
+        ASSERT_TRUE(bulk.dmaData.isActive);
+
+        // the write is the last cycle of the STA, the transfer waits an extra cycle if the next one is odd
+        uint32_t start = bulk.getCycle();
+        uint32_t expected = bulkDmaCycles + ((start + 1) & 1);
+        EXPECT_EQ(skipLoad ? bulkDmaCycles + 1 : bulkDmaCycles, expected);
+        bulk.processInstruction();
+        EXPECT_EQ(expected, bulk.getCycle() - start);
+
+        uint32_t perCycleCalls = 0;
+        while (perCycle.dmaData.isActive) {
+            perCycle.processInstruction();
+            perCycleCalls++;
+        }
+        EXPECT_EQ(expected, perCycleCalls);
+        expectSameState();
+        EXPECT_EQ(256, bulk.dmaData.bytesWritten);
+        EXPECT_EQ(0x2004, bulk.systemBus.addressBus);
+        EXPECT_EQ(0xff, bulk.systemBus.dataBus);
+    }
+}
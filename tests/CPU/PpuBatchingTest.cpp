@@ -0,0 +1,154 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+
+// Turns on rendering and the vblank NMI, copies a page to OAM, then keeps polling the status register while the NMI
+// handler counts frames
+static const uint8_t frameProgram[] = {
+    0xa9, 0x1e,         // $8000 LDA #$1e
+    0x8d, 0x01, 0x20,   // $8002 STA $2001      show background and sprites
+    0xa9, 0x80,         // $8005 LDA #$80
+    0x8d, 0x00, 0x20,   // $8007 STA $2000      NMI on vblank
+    0xa9, 0x02,         // $800a LDA #$02
+    0x8d, 0x14, 0x40,   // $800c STA $4014      OAM DMA from $0200
+    0xe6, 0x12,         // $800f INC $12
+    0x2c, 0x02, 0x20,   // $8011 BIT $2002
+    0x10, 0xf9,         // $8014 BPL $800f
+    0xa5, 0x12,         // $8016 LDA $12
+    0x9d, 0x00, 0x02,   // $8018 STA $0200,X
+    0xe8,               // $801b INX
+    0x4c, 0x0f, 0x80,   // $801c JMP $800f
+};
+
+// NMI handler at $8040
+static const uint8_t nmiHandler[] = {
+    0xe6, 0x11,         // $8040 INC $11
+    0x40,               // $8042 RTI
+};
+
+class PpuBatchingTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        cart.mmc = &mmc;
+        memcpy(mmc.rom, frameProgram, sizeof(frameProgram));
+        memcpy(&mmc.rom[0x40], nmiHandler, sizeof(nmiHandler));
+        mmc.setVector(0xfffa, 0x8040);
+
+        setUpFixedRom(inlinePpuCpu, inlinePpu, cart);
+        setUpFixedRom(batched, batchedPpu, cart);
+        batched.ppuBatchingEnabled = true;
+    }
+
+    void expectSameCpuState() {
+        ASSERT_EQ(inlinePpuCpu.registers.programCounter, batched.registers.programCounter);
+        ASSERT_EQ(inlinePpuCpu.getCycle(), batched.getCycle());
+        EXPECT_EQ(inlinePpuCpu.registers.acc, batched.registers.acc);
+        EXPECT_EQ(inlinePpuCpu.registers.x, batched.registers.x);
+        EXPECT_EQ(inlinePpuCpu.registers.statusRegister, batched.registers.statusRegister);
+        EXPECT_EQ(inlinePpuCpu.registers.stackPointer, batched.registers.stackPointer);
+        ASSERT_EQ(0, memcmp(inlinePpuCpu.ram.ram, batched.ram.ram, SystemRam::systemRAMBytes));
+    }
+
+    void expectSameState() {
+        expectSameCpuState();
+        ASSERT_EQ(inlinePpu.getCycle(), batchedPpu.getCycle());
+        EXPECT_EQ(inlinePpu.ppuMemory.memoryMappedRegisters.status, batchedPpu.ppuMemory.memoryMappedRegisters.status);
+        EXPECT_EQ(inlinePpu.ppuMemory.memoryMappedRegisters.oamAddr, batchedPpu.ppuMemory.memoryMappedRegisters.oamAddr);
+    }
+
+    // The CPU has to match at every instruction, the PPU once it's caught up.  Returns the instructions after which
+    // the PPU was still behind.
+    uint32_t runLazy(uint32_t cycles) {
+        batched.lazyPpuEnabled = true;
+        uint32_t lagging = 0;
+        while (batched.getCycle() < cycles) {
+            NES::DebugState state = batched.processInstruction();
+            NES::DebugState inlineState = inlinePpuCpu.processInstruction();
+            EXPECT_EQ(inlineState.instructionCount, state.instructionCount);
+            expectSameCpuState();
+            if (batchedPpu.getCycle() != inlinePpu.getCycle()) {
+                lagging++;
+            }
+        }
+        batched.catchUpPpu();
+        expectSameState();
+        EXPECT_EQ(0, memcmp(inlinePpu.spriteMemory.primaryOAM, batchedPpu.spriteMemory.primaryOAM, sizeof(inlinePpu.spriteMemory.primaryOAM)));
+        EXPECT_EQ(0, memcmp(inlinePpu.renderBuffer.renderBuffer, batchedPpu.renderBuffer.renderBuffer, sizeof(inlinePpu.renderBuffer.renderBuffer)));
+        return lagging;
+    }
+
+    FixedRomMmc mmc;
+    Cartridge cart{};
+    Ppu2C02 inlinePpu;
+    Ppu2C02 batchedPpu;
+    Cpu2a03 inlinePpuCpu;
+    Cpu2a03 batched;
+};
+
+TEST_F(PpuBatchingTest, processInstructionMatchesInlinePpu) {
+    // a bit over three frames
+    while (batched.getCycle() < 90000) {
+        batched.processInstruction();
+        inlinePpuCpu.processInstruction();
+        expectSameState();
+    }
+
+    EXPECT_GE(batched.ram.ram[0x11], 3);
+    EXPECT_EQ(0, memcmp(inlinePpu.spriteMemory.primaryOAM, batchedPpu.spriteMemory.primaryOAM, sizeof(inlinePpu.spriteMemory.primaryOAM)));
+    EXPECT_EQ(0, memcmp(inlinePpu.renderBuffer.renderBuffer, batchedPpu.renderBuffer.renderBuffer, sizeof(inlinePpu.renderBuffer.renderBuffer)));
+}
+
+TEST_F(PpuBatchingTest, runCyclesMatchesInlinePpu) {
+    while (batched.getCycle() < 90000) {
+        batched.runCycles(1000);
+        inlinePpuCpu.runCycles(1000);
+        expectSameState();
+    }
+    EXPECT_GE(batched.ram.ram[0x11], 3);
+}
+
+TEST_F(PpuBatchingTest, recompilerPathsMatchInlinePpu) {
+    for (Cpu2a03 *cpu : { &inlinePpuCpu, &batched }) {
+        cpu->blockCacheEnabled = true;
+        cpu->fusedDispatchEnabled = true;
+        cpu->superInstructionsEnabled = true;
+        cpu->idleLoopSkipEnabled = true;
+    }
+    while (batched.getCycle() < 90000) {
+        NES::DebugState state = batched.processInstruction();
+        NES::DebugState inlineState = inlinePpuCpu.processInstruction();
+        ASSERT_EQ(inlineState.instructionCount, state.instructionCount);
+        expectSameState();
+    }
+}
+
+TEST_F(PpuBatchingTest, lazyPpuMatchesInlinePpu) {
+    EXPECT_GT(runLazy(90000), 0u);
+    EXPECT_GE(batched.ram.ram[0x11], 3);
+}
+
+TEST_F(PpuBatchingTest, lazyPpuRecompilerPathsMatchInlinePpu) {
+    for (Cpu2a03 *cpu : { &inlinePpuCpu, &batched }) {
+        cpu->blockCacheEnabled = true;
+        cpu->fusedDispatchEnabled = true;
+        cpu->superInstructionsEnabled = true;
+        cpu->idleLoopSkipEnabled = true;
+        cpu->bulkOamDmaEnabled = true;
+    }
+    runLazy(90000);
+    EXPECT_GE(batched.ram.ram[0x11], 3);
+}
+
+TEST_F(PpuBatchingTest, lazyPpuThenRunCycles) {
+    runLazy(40000);
+    // runCycles takes over with the PPU and the scheduler where processInstruction left them
+    while (batched.getCycle() < 90000) {
+        batched.runCycles(1000);
+        inlinePpuCpu.runCycles(1000);
+        expectSameState();
+    }
+    EXPECT_GE(batched.ram.ram[0x11], 3);
+}
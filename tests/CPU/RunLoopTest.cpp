@@ -0,0 +1,113 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+
+// Mixes instructions runCycles does inline with ones it hands to the op code handlers
+static const uint8_t mixedProgram[] = {
+    0xa2, 0x00,         // $8000 LDX #$00
+    0xa0, 0x08,         // $8002 LDY #$08
+    0x8a,               // $8004 TXA
+    0x69, 0x13,         // $8005 ADC #$13       (handler)
+    0x9d, 0x00, 0x03,   // $8007 STA $0300,X
+    0x95, 0x40,         // $800a STA $40,X      (handler)
+    0x0a,               // $800c ASL A
+    0x6a,               // $800d ROR A          (handler)
+    0x2a,               // $800e ROL A
+    0x4a,               // $800f LSR A
+    0x48,               // $8010 PHA
+    0x08,               // $8011 PHP            (handler)
+    0x28,               // $8012 PLP            (handler)
+    0x68,               // $8013 PLA
+    0x91, 0x20,         // $8014 STA ($20),Y    (handler)
+    0xe6, 0x10,         // $8016 INC $10
+    0xce, 0x11, 0x00,   // $8018 DEC $0011
+    0x24, 0x10,         // $801b BIT $10
+    0xdd, 0xf8, 0x02,   // $801d CMP $02f8,X
+    0xb9, 0xff, 0x02,   // $8020 LDA $02ff,Y
+    0x8d, 0x00, 0x90,   // $8023 STA $9000      (mapper write)
+    0x38,               // $8026 SEC
+    0xb0, 0x00,         // $8027 BCS $8029
+    0x88,               // $8029 DEY
+    0xe8,               // $802a INX
+    0xd0, 0xd7,         // $802b BNE $8004
+    0x4c, 0x00, 0x80,   // $802d JMP $8000
+};
+
+class RunLoopTest : public CPUTest {
+protected:
+    virtual void SetUp() {
+        CPUTest::SetUp();
+        ppu.disabled = true;
+        cart.mmc = &mmc;
+        setUpFixedRom(cpu, ppu, cart);
+
+        memcpy(mmc.rom, mixedProgram, sizeof(mixedProgram));
+        cpu.ram.ram[0x20] = 0x00;
+        cpu.ram.ram[0x21] = 0x04;
+    }
+
+    void expectSameState(Cpu2a03 &expected, Cpu2a03 &actual) {
+        EXPECT_EQ(expected.registers.programCounter, actual.registers.programCounter);
+        EXPECT_EQ(expected.registers.acc, actual.registers.acc);
+        EXPECT_EQ(expected.registers.x, actual.registers.x);
+        EXPECT_EQ(expected.registers.y, actual.registers.y);
+        EXPECT_EQ(expected.registers.stackPointer, actual.registers.stackPointer);
+        EXPECT_EQ(expected.registers.statusRegister, actual.registers.statusRegister);
+        EXPECT_EQ(expected.getCycle(), actual.getCycle());
+        EXPECT_EQ(0, memcmp(expected.ram.ram, actual.ram.ram, SystemRam::systemRAMBytes));
+    }
+
+    FixedRomMmc mmc;
+    Cartridge cart{};
+};
+
+TEST_F(RunLoopTest, matchesProcessInstruction) {
+    Cpu2a03 interpreted = cpu;
+    const uint32_t budget = 5000;
+    while (interpreted.getCycle() < budget) {
+        interpreted.processInstruction();
+    }
+    int interpretedWrites = mmc.writes;
+    mmc.writes = 0;
+
+    uint32_t cycles = cpu.runCycles(budget);
+
+    EXPECT_EQ(interpreted.getCycle(), cycles);
+    EXPECT_GE(cycles, budget);
+    expectSameState(interpreted, cpu);
+    EXPECT_EQ(interpretedWrites, mmc.writes);
+    EXPECT_GT(mmc.writes, 0);
+}
+
+TEST_F(RunLoopTest, budgetSplitAcrossCalls) {
+    Cpu2a03 whole = cpu;
+    uint32_t wholeCycles = whole.runCycles(3000);
+
+    uint32_t splitCycles = 0;
+    while (splitCycles < 3000) {
+        splitCycles += cpu.runCycles(7);
+    }
+    EXPECT_EQ(wholeCycles, splitCycles);
+    expectSameState(whole, cpu);
+}
+
+TEST_F(RunLoopTest, interruptsGoThroughProcessInstruction) {
+    // NMI vector points at RTI
+    mmc.setVector(0xfffa, 0x8040);
+    mmc.rom[0x0040] = 0x40;
+
+    Cpu2a03 interpreted = cpu;
+    interpreted.setNmi();
+    interpreted.processInstruction();
+    EXPECT_EQ(0x8040, interpreted.registers.programCounter);
+    while (interpreted.getCycle() < 100) {
+        interpreted.processInstruction();
+    }
+
+    cpu.setNmi();
+    cpu.runCycles(100);
+    expectSameState(interpreted, cpu);
+}
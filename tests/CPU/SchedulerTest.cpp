@@ -0,0 +1,146 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/Scheduler.h>
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+using NES::Scheduler;
+using NES::SchedulerEvent;
+
+TEST(SchedulerTest, popsInDeadlineOrder) {
+    Scheduler scheduler;
+    EXPECT_EQ(Scheduler::never, scheduler.getNextDeadline());
+    EXPECT_EQ(SchedulerEvent::Count, scheduler.popDue(Scheduler::never));
+
+    scheduler.schedule(SchedulerEvent::Nmi, 300);
+    scheduler.schedule(SchedulerEvent::RunEnd, 500);
+    scheduler.schedule(SchedulerEvent::Poll, 100);
+    scheduler.schedule(SchedulerEvent::Dma, 200);
+    EXPECT_EQ(100u, scheduler.getNextDeadline());
+
+    EXPECT_EQ(SchedulerEvent::Count, scheduler.popDue(99));
+    EXPECT_EQ(SchedulerEvent::Poll, scheduler.popDue(250));
+    EXPECT_EQ(SchedulerEvent::Dma, scheduler.popDue(250));
+    EXPECT_EQ(SchedulerEvent::Count, scheduler.popDue(250));
+    EXPECT_EQ(SchedulerEvent::Nmi, scheduler.popDue(1000));
+    EXPECT_EQ(SchedulerEvent::RunEnd, scheduler.popDue(1000));
+    EXPECT_EQ(Scheduler::never, scheduler.getNextDeadline());
+}
+
+TEST(SchedulerTest, rescheduleAndCancel) {
+    Scheduler scheduler;
+    scheduler.schedule(SchedulerEvent::Nmi, 300);
+    scheduler.schedule(SchedulerEvent::RunEnd, 500);
+    scheduler.schedule(SchedulerEvent::Poll, 400);
+
+    // one deadline per event, scheduling again moves it
+    scheduler.schedule(SchedulerEvent::RunEnd, 100);
+    EXPECT_EQ(100u, scheduler.getNextDeadline());
+    scheduler.schedule(SchedulerEvent::RunEnd, 1000);
+    EXPECT_EQ(300u, scheduler.getNextDeadline());
+    EXPECT_EQ(1000u, scheduler.getDeadline(SchedulerEvent::RunEnd));
+
+    scheduler.cancel(SchedulerEvent::Nmi);
+    scheduler.cancel(SchedulerEvent::Dma);
+    EXPECT_EQ(Scheduler::never, scheduler.getDeadline(SchedulerEvent::Nmi));
+    EXPECT_EQ(400u, scheduler.getNextDeadline());
+    EXPECT_EQ(SchedulerEvent::Poll, scheduler.popDue(2000));
+    EXPECT_EQ(SchedulerEvent::RunEnd, scheduler.popDue(2000));
+    EXPECT_EQ(SchedulerEvent::Count, scheduler.popDue(2000));
+}
+
+TEST(SchedulerTest, timestampsPastThirtyTwoBits) {
+    Scheduler scheduler;
+    uint64_t late = 0x100000000ull * 12 + 5;
+    scheduler.schedule(SchedulerEvent::Nmi, late);
+    scheduler.schedule(SchedulerEvent::Poll, late - 1);
+    EXPECT_EQ(SchedulerEvent::Count, scheduler.popDue(5));
+    EXPECT_EQ(SchedulerEvent::Poll, scheduler.popDue(late));
+    EXPECT_EQ(SchedulerEvent::Nmi, scheduler.popDue(late));
+}
+
+// NMI on, then a busy loop in RAM with a masked IRQ let through once per pass
+static const uint8_t frameProgram[] = {
+    0xa9, 0x80,         // $8000 LDA #$80
+    0x8d, 0x00, 0x20,   // $8002 STA $2000      NMI on vblank
+    0x78,               // $8005 SEI
+    0xe6, 0x30,         // $8006 INC $30
+    0xa5, 0x30,         // $8008 LDA $30
+    0xd0, 0xfa,         // $800a BNE $8006
+    0x58,               // $800c CLI            the pending IRQ is taken here
+    0x4c, 0x05, 0x80,   // $800d JMP $8005
+};
+
+// NMI handler at $8040
+static const uint8_t handlers[] = {
+    0xe6, 0x11,         // $8040 INC $11
+    0x40,               // $8042 RTI
+};
+
+// The IRQ line is never released, so the handler returns with I set
+static const uint8_t irqHandler[] = {
+    0x68,               // $8050 PLA
+    0x09, 0x04,         // $8051 ORA #$04
+    0x48,               // $8053 PHA
+    0xe6, 0x12,         // $8054 INC $12
+    0x40,               // $8056 RTI
+};
+
+class SchedulerRunTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        cart.mmc = &mmc;
+        memcpy(mmc.rom, frameProgram, sizeof(frameProgram));
+        memcpy(&mmc.rom[0x40], handlers, sizeof(handlers));
+        memcpy(&mmc.rom[0x50], irqHandler, sizeof(irqHandler));
+        mmc.setVector(0xfffa, 0x8040);
+        mmc.setVector(0xfffe, 0x8050);
+
+        setUpFixedRom(interpreted, interpretedPpu, cart);
+        setUpFixedRom(run, runPpu, cart);
+    }
+
+    FixedRomMmc mmc;
+    Cartridge cart{};
+    Ppu2C02 interpretedPpu;
+    Ppu2C02 runPpu;
+    Cpu2a03 interpreted;
+    Cpu2a03 run;
+};
+
+TEST_F(SchedulerRunTest, deadlinesMatchProcessInstruction) {
+    for (Cpu2a03 *cpu : { &interpreted, &run }) {
+        cpu->setIrq();
+    }
+
+    for (int i = 0; i < 30; i++) {
+        uint64_t target = run.getCycle() + 4000;
+        run.runCycles(4000);
+        while (interpreted.getCycle() < target) {
+            interpreted.processInstruction();
+        }
+
+        ASSERT_EQ(interpreted.getCycle(), run.getCycle());
+        ASSERT_EQ(interpreted.registers.programCounter, run.registers.programCounter);
+        EXPECT_EQ(interpretedPpu.getCycle(), runPpu.getCycle());
+        EXPECT_EQ(interpreted.ram.ram[0x11], run.ram.ram[0x11]);
+        EXPECT_EQ(interpreted.ram.ram[0x12], run.ram.ram[0x12]);
+        EXPECT_EQ(interpreted.ram.ram[0x30], run.ram.ram[0x30]);
+    }
+    EXPECT_GE(run.ram.ram[0x11], 3);
+    EXPECT_GE(run.ram.ram[0x12], 3);
+    EXPECT_GE(run.ram.ram[0x30], 1);
+}
+
+TEST_F(SchedulerRunTest, batchedPpuMatches) {
+    run.ppuBatchingEnabled = true;
+    run.runCycles(120000);
+    while (interpreted.getCycle() < run.getCycle()) {
+        interpreted.processInstruction();
+    }
+    EXPECT_EQ(interpreted.getCycle(), run.getCycle());
+    EXPECT_EQ(interpretedPpu.getCycle(), runPpu.getCycle());
+    EXPECT_EQ(interpreted.ram.ram[0x11], run.ram.ram[0x11]);
+    EXPECT_GE(run.ram.ram[0x11], 3);
+}
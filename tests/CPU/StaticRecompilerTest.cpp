@@ -0,0 +1,173 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/CPU/StaticRecompiler.h>
+#include <ControlDeck/cartridge.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+using NES::ControlFlowGraph;
+using NES::RecompiledProgram;
+
+static const uint8_t resetProgram[] = {
+    0xa2, 0x05,         // $8000 LDX #$05
+    0xa9, 0x00,         // $8002 LDA #$00
+    0xe6, 0x10,         // $8004 INC $10
+    0xca,               // $8006 DEX
+    0xd0, 0xfb,         // $8007 BNE $8004
+    0x20, 0x10, 0x80,   // $8009 JSR $8010
+    0x6c, 0x00, 0x02,   // $800c JMP ($0200)
+    0x00,               // $800f (data)
+    0xa0, 0x07,         // $8010 LDY #$07
+    0x60,               // $8012 RTS
+};
+
+// writeRecompiledSource output for the ROM built in StaticRecompilerTest::SetUp, checked byte for byte by
+// emitsCheckedInProgram so what runs here is what the recompiler writes.  Regenerate it if the emitter changes.
+#include "StaticRecompilerTestProgram.inc"
+static const char *testProgramFile = "StaticRecompilerTestProgram.inc";
+
+class StaticRecompilerTest : public CPUTest {
+protected:
+    virtual void SetUp() {
+        CPUTest::SetUp();
+        ppu.disabled = true;
+        cart.mmc = &mmc;
+        setUpFixedRom(cpu, ppu, cart);
+
+        memcpy(mmc.rom, resetProgram, sizeof(resetProgram));
+        mmc.rom[0x0020] = 0x40;     // $8020 RTI (NMI)
+        mmc.rom[0x0030] = 0x6c;     // $8030 JMP ($8040) (IRQ)
+        mmc.rom[0x0031] = 0x40;
+        mmc.rom[0x0032] = 0x80;
+        mmc.rom[0x0040] = 0x50;     // $8040 .dw $8050
+        mmc.rom[0x0041] = 0x80;
+        mmc.rom[0x0050] = 0x40;     // $8050 RTI
+        mmc.rom[0x1000] = 0xea;     // $9000 NOP
+        mmc.setVector(0xfffa, 0x8020);
+        mmc.setVector(0xfffc, 0x8000);
+        mmc.setVector(0xfffe, 0x8030);
+
+        // JMP ($0200) goes to $9000 which isn't reachable from the vectors
+        cpu.ram.ram[0x200] = 0x00;
+        cpu.ram.ram[0x201] = 0x90;
+    }
+
+    // writeRecompiledSource output for the ROM
+    std::string recompile() {
+        ControlFlowGraph graph;
+        graph.build(cpu);
+
+        FILE *out = tmpfile();
+        EXPECT_NE(nullptr, out);
+        NES::writeRecompiledSource(graph, out, "testProgram");
+        std::string source;
+        rewind(out);
+        for (int c = fgetc(out); c != EOF; c = fgetc(out)) {
+            source += (char)c;
+        }
+        fclose(out);
+        return source;
+    }
+
+    FixedRomMmc mmc;
+    Cartridge cart{};
+};
+
+TEST_F(StaticRecompilerTest, walksFromVectors) {
+    ControlFlowGraph graph;
+    graph.build(cpu);
+
+    ASSERT_EQ(3u, graph.entryPoints.size());
+    EXPECT_EQ(0x8000, graph.entryPoints[0]);
+    EXPECT_EQ(0x8020, graph.entryPoints[1]);
+    EXPECT_EQ(0x8030, graph.entryPoints[2]);
+
+    EXPECT_EQ(12u, graph.instructions.size());
+    EXPECT_TRUE(graph.contains(0x8004));
+    EXPECT_TRUE(graph.contains(0x8012));    // subroutine
+    EXPECT_TRUE(graph.contains(0x8050));    // JMP through a pointer in ROM
+    EXPECT_FALSE(graph.contains(0x800f));
+    EXPECT_FALSE(graph.contains(0x9000));
+
+    EXPECT_EQ(1u, graph.blockStarts.count(0x8004));
+    EXPECT_EQ(1u, graph.blockStarts.count(0x8009));
+    ASSERT_EQ(1u, graph.indirectJumps.size());
+    EXPECT_EQ(0x800c, graph.indirectJumps[0]);
+}
+
+TEST_F(StaticRecompilerTest, writesSwitchOnProgramCounter) {
+    std::string source = recompile();
+    EXPECT_NE(std::string::npos, source.find("uint32_t testProgram(NES::Cpu2a03 &cpu, uint32_t maxInstructions)"));
+    EXPECT_NE(std::string::npos, source.find("case 0x8004:"));
+    EXPECT_NE(std::string::npos, source.find("cpu.executeFusedOpCode<0xe6>(0x10, 0x00);"));
+    EXPECT_NE(std::string::npos, source.find("if (cpu.registers.programCounter != 0x8009) continue;\n            // fall through\n"));
+    EXPECT_EQ(std::string::npos, source.find("case 0x9000:"));
+}
+
+TEST_F(StaticRecompilerTest, emitsCheckedInProgram) {
+    // next to this file
+    std::string path = __FILE__;
+    size_t slash = path.find_last_of("/\\");
+    path = (slash == std::string::npos ? std::string() : path.substr(0, slash + 1)) + testProgramFile;
+    std::ifstream file(path, std::ios::binary);
+    ASSERT_TRUE(file.good()) << path;
+    std::stringstream checkedIn;
+    checkedIn << file.rdbuf();
+
+    EXPECT_EQ(checkedIn.str(), recompile());
+}
+
+TEST_F(StaticRecompilerTest, recompiledCodeMatchesInterpreter) {
+    Cpu2a03 interpreted;
+    interpreted.ram = cpu.ram;
+    interpreted.registers = cpu.registers;
+    interpreted.cartridge = &cart;
+    interpreted.ppu = &ppu;
+    while (interpreted.registers.programCounter != 0x9000) {
+        interpreted.processInstruction();
+    }
+
+    RecompiledProgram program(cpu);
+    program.code = &testProgram;
+    program.step();
+
+    // Leaves through the indirect jump and hands over to the interpreter
+    EXPECT_EQ(0x9000, cpu.registers.programCounter);
+    EXPECT_EQ(21u, program.lastInstructionCount);
+    EXPECT_EQ(21u, program.recompiledInstructions);
+    EXPECT_EQ(0u, program.interpreterFallbacks);
+
+    EXPECT_EQ(interpreted.registers.acc, cpu.registers.acc);
+    EXPECT_EQ(interpreted.registers.x, cpu.registers.x);
+    EXPECT_EQ(interpreted.registers.y, cpu.registers.y);
+    EXPECT_EQ(interpreted.registers.stackPointer, cpu.registers.stackPointer);
+    EXPECT_EQ(interpreted.registers.statusRegister, cpu.registers.statusRegister);
+    EXPECT_EQ(0, memcmp(interpreted.ram.ram, cpu.ram.ram, NES::SystemRam::systemRAMBytes));
+    EXPECT_EQ(5, cpu.ram.ram[0x10]);
+
+    program.step();
+    EXPECT_EQ(0x9001, cpu.registers.programCounter);
+    EXPECT_EQ(1u, program.lastInstructionCount);
+    EXPECT_EQ(1u, program.interpreterFallbacks);
+}
+
+TEST_F(StaticRecompilerTest, stopsAtInstructionBudgetAndInterrupts) {
+    RecompiledProgram program(cpu);
+    program.code = &testProgram;
+    program.maxInstructions = 3;
+    program.step();
+    EXPECT_EQ(3u, program.lastInstructionCount);
+    EXPECT_EQ(0x8006, cpu.registers.programCounter);
+
+    // Pending interrupts are left to the interpreter
+    cpu.interrupts.raiseReset();
+    EXPECT_FALSE(NES::canRunRecompiled(cpu));
+    EXPECT_EQ(0u, testProgram(cpu, 3));
+    cpu.interrupts = NES::InterruptController();
+
+    cpu.dmaData.isActive = true;
+    EXPECT_FALSE(NES::canRunRecompiled(cpu));
+}
@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/CPU/cpu2A03.h>
+#include <ControlDeck/cartridge.h>
+#include "CPUTestCommon.h"
+
+using NES::Cartridge;
+
+// Every recognized idiom, polling the PPU with NMIs enabled
+static const uint8_t idiomProgram[] = {
+    0xa9, 0x80,         // $8000 LDA #$80
+    0x8d, 0x00, 0x20,   // $8002 STA $2000      NMI on vblank
+    0xad, 0x02, 0x20,   // $8005 LDA $2002
+    0x10, 0xfb,         // $8008 BPL $8005
+    0xe6, 0x10,         // $800a INC $10
+    0xa5, 0x10,         // $800c LDA $10
+    0xc9, 0x03,         // $800e CMP #$03
+    0xf0, 0x07,         // $8010 BEQ $8019
+    0xa2, 0x40,         // $8012 LDX #$40
+    0xca,               // $8014 DEX
+    0xd0, 0xfd,         // $8015 BNE $8014
+    0xf0, 0xec,         // $8017 BEQ $8005
+    0xa9, 0x00,         // $8019 LDA #$00
+    0x85, 0x10,         // $801b STA $10
+    0x2c, 0x02, 0x20,   // $801d BIT $2002
+    0x30, 0xfb,         // $8020 BMI $801d
+    0x4c, 0x05, 0x80,   // $8022 JMP $8005
+};
+
+// NMI handler at $8040
+static const uint8_t nmiHandler[] = {
+    0xe6, 0x11,         // $8040 INC $11
+    0x40,               // $8042 RTI
+};
+
+class SuperInstructionTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        cart.mmc = &mmc;
+        memcpy(mmc.rom, idiomProgram, sizeof(idiomProgram));
+        memcpy(&mmc.rom[0x40], nmiHandler, sizeof(nmiHandler));
+        mmc.setVector(0xfffa, 0x8040);
+
+        setUpFixedRom(interpreted, interpretedPpu, cart);
+        setUpFixedRom(fused, fusedPpu, cart);
+        fused.blockCacheEnabled = true;
+        fused.superInstructionsEnabled = true;
+    }
+
+    FixedRomMmc mmc;
+    Cartridge cart{};
+    Ppu2C02 interpretedPpu;
+    Ppu2C02 fusedPpu;
+    Cpu2a03 interpreted;
+    Cpu2a03 fused;
+};
+
+TEST_F(SuperInstructionTest, matchesInterpreterInstructionByInstruction) {
+    int superInstructionSteps = 0;
+    // a few frames worth
+    while (fused.getCycle() < 100000) {
+        NES::DebugState state = fused.processInstruction();
+        for (int i = 0; i < state.instructionCount; i++) {
+            interpreted.processInstruction();
+        }
+        if (state.instructionCount > 1) {
+            superInstructionSteps++;
+        }
+
+        ASSERT_EQ(interpreted.registers.programCounter, fused.registers.programCounter);
+        ASSERT_EQ(interpreted.getCycle(), fused.getCycle());
+        EXPECT_EQ(interpreted.registers.acc, fused.registers.acc);
+        EXPECT_EQ(interpreted.registers.x, fused.registers.x);
+        EXPECT_EQ(interpreted.registers.statusRegister, fused.registers.statusRegister);
+        EXPECT_EQ(interpreted.registers.stackPointer, fused.registers.stackPointer);
+        EXPECT_EQ(interpreted.systemBus.addressBus, fused.systemBus.addressBus);
+        EXPECT_EQ(interpreted.systemBus.dataBus, fused.systemBus.dataBus);
+        ASSERT_EQ(0, memcmp(interpreted.ram.ram, fused.ram.ram, SystemRam::systemRAMBytes));
+    }
+
+    EXPECT_GT(superInstructionSteps, 0);
+    EXPECT_EQ(interpreted.ppu->ppuMemory.memoryMappedRegisters.status, fused.ppu->ppuMemory.memoryMappedRegisters.status);
+    // NMIs were taken, so sequences had to stop at the right instruction boundary
+    EXPECT_GT(fused.ram.ram[0x11], 1);
+}
+
+TEST_F(SuperInstructionTest, delayLoopRunsAsPairs) {
+    fused.registers.programCounter = 0x8012;
+    fused.processInstruction();     // LDX #$40
+
+    NES::DebugState state = fused.processInstruction();
+    EXPECT_EQ(2, state.instructionCount);
+    EXPECT_EQ(0x3f, fused.registers.x);
+    EXPECT_EQ(0x8014, fused.registers.programCounter);
+    // DEX + taken BNE
+    EXPECT_EQ(2u + 2u + 3u, fused.getCycle());
+}
+
+TEST_F(SuperInstructionTest, disabledWithoutFlag) {
+    fused.superInstructionsEnabled = false;
+    fused.registers.programCounter = 0x800a;
+    NES::DebugState state = fused.processInstruction();
+    EXPECT_EQ(1, state.instructionCount);
+    EXPECT_EQ(0x800c, fused.registers.programCounter);
+    EXPECT_EQ(0u, fused.blockCache.superInstructions);
+}
@@ -97,6 +97,35 @@ TEST(RegistersTest, setFlagIfNegativeTest) {
     EXPECT_TRUE(reg.flagSet(ProcessorStatus::NegativeFlag));
 }
 
+TEST(RegistersTest, lazyFlagsReadBackAsByte) {
+    NES::Registers reg;
+    reg.statusRegister = 0x25;
+    reg.setFlagIfZero(0);
+    reg.setFlagIfNegative(0x90);
+    EXPECT_EQ(0xa7, reg.statusRegister);
+
+    reg.setFlagIfZero(0x90);
+    EXPECT_EQ(0xa5, reg.statusRegister);
+
+    // N and Z together, as PLP/BIT can leave them
+    reg.statusRegister = 0x82;
+    EXPECT_TRUE(reg.flagSet(ProcessorStatus::ZeroFlag));
+    EXPECT_TRUE(reg.flagSet(ProcessorStatus::NegativeFlag));
+    reg.statusRegister &= 0x7f;
+    EXPECT_EQ(0x02, reg.statusRegister);
+    reg.statusRegister |= 0x01;
+    EXPECT_EQ(0x03, reg.statusRegister);
+
+    // debug views edit a copy of the byte and write it back, N and Z included
+    uint8_t p = reg.statusRegister;
+    p |= 0x80;
+    p &= 0xfd;
+    reg.statusRegister = p;
+    EXPECT_TRUE(reg.flagSet(ProcessorStatus::NegativeFlag));
+    EXPECT_FALSE(reg.flagSet(ProcessorStatus::ZeroFlag));
+    EXPECT_EQ(0x81, reg.statusRegister);
+}
+
 
 TEST(SystemBusTest, setAddressBusTest) {
     SystemBus bus;
@@ -57,3 +57,47 @@ TEST(Cartridge_Test, testNROMPPURomLoad) {
     cart.chrRom[0].rom[0] = 'a';
     EXPECT_EQ('a', nrom.doCHRMemoryOperationOperation(cart, 0x0, 0, true));
 }
+
+// Not one of the MapperType mappers
+class CountingMmc : public MemoryManagementController {
+public:
+    void doMemoryOperation(SystemBus &bus, Cartridge &cart) override {
+        bus.dataBus = 'c';
+        calls++;
+    }
+
+    uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
+        calls++;
+        return 'd';
+    }
+
+    int calls{ 0 };
+};
+
+TEST(Cartridge_Test, testMapperDispatch) {
+    NRom nrom(false);
+    EXPECT_EQ(MapperType::NRom, nrom.type);
+
+    Cartridge cart;
+    cart.mmc = &nrom;
+    cart.prgRom = new PrgRom[1]();
+    cart.prgRom[0].rom[0x10] = 'a';
+    cart.chrRom = new ChrRom[1]();
+    cart.chrRom[0].rom[0x20] = 'b';
+
+    SystemBus bus;
+    bus.addressBus = 0xc010;
+    bus.read = true;
+    mapperMemoryOperation(bus, cart);
+    EXPECT_EQ('a', bus.dataBus);
+    EXPECT_EQ('b', mapperChrMemoryOperation(cart, 0x20, 0));
+
+    // unknown mappers go through the vtable
+    CountingMmc counting;
+    EXPECT_EQ(MapperType::Other, counting.type);
+    cart.mmc = &counting;
+    mapperMemoryOperation(bus, cart);
+    EXPECT_EQ('c', bus.dataBus);
+    EXPECT_EQ('d', mapperChrMemoryOperation(cart, 0x20, 0));
+    EXPECT_EQ(2, counting.calls);
+}
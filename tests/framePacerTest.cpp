@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/FramePacer.h>
+#include <ControlDeck/CPU/CpuVariant.h>
+using namespace NES;
+
+typedef FramePacer::Clock Clock;
+
+// Made up time points, nothing here waits
+class FramePacerTest : public testing::Test {
+protected:
+    Clock::duration period(double factor = 1.0) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / (FramePacer::getFrameRate() * factor)));
+    }
+
+    FramePacer pacer;
+    Clock::time_point now{ std::chrono::seconds(100) };
+};
+
+TEST_F(FramePacerTest, frameRate) {
+    if (CpuVariant::scanLines == 262) {
+        EXPECT_NEAR(60.0988, FramePacer::getFrameRate(), 0.0001);
+    } else {
+        EXPECT_NEAR(50.0070, FramePacer::getFrameRate(), 0.01);
+    }
+}
+
+TEST_F(FramePacerTest, realTimeWaitsOutTheFrame) {
+    // a frame that took no time waits a whole period
+    Clock::duration wait = pacer.frameDone(now);
+    EXPECT_NEAR(period().count(), wait.count(), 1);
+
+    // one that took half of it waits the rest
+    now += wait + period() / 2;
+    wait = pacer.frameDone(now);
+    EXPECT_NEAR((period() / 2).count(), wait.count(), 2);
+}
+
+TEST_F(FramePacerTest, deadlinesDontDrift) {
+    Clock::time_point start = now;
+    // late by a bit each frame, the next frame's shorter wait makes it up
+    for (int i = 0; i < 600; i++) {
+        now += pacer.frameDone(now) + std::chrono::microseconds(300);
+    }
+    double seconds = std::chrono::duration<double>(now - start).count();
+    EXPECT_NEAR(600 / FramePacer::getFrameRate(), seconds, 0.001);
+}
+
+TEST_F(FramePacerTest, fastForward) {
+    pacer.setMode(PacingMode::FastForward, 4.0);
+    EXPECT_NEAR(period(4.0).count(), pacer.frameDone(now).count(), 1);
+    EXPECT_EQ(4.0, pacer.getFastForwardFactor());
+
+    // the factor only applies to fast-forward
+    pacer.setMode(PacingMode::RealTime, 4.0);
+    EXPECT_EQ(1.0, pacer.getFastForwardFactor());
+    EXPECT_NEAR(period().count(), pacer.frameDone(now).count(), 1);
+}
+
+TEST_F(FramePacerTest, uncappedNeverWaits) {
+    pacer.setMode(PacingMode::Uncapped);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(Clock::duration::zero(), pacer.frameDone(now));
+        now += std::chrono::microseconds(100);
+    }
+}
+
+TEST_F(FramePacerTest, fallingBehindStartsOver) {
+    pacer.frameDone(now);
+    // a few frames late is caught up on
+    now += period() * 4;
+    EXPECT_EQ(Clock::duration::zero(), pacer.frameDone(now));
+    EXPECT_EQ(Clock::duration::zero(), pacer.frameDone(now));
+
+    // stopped for a second, the frames missed aren't run back to back
+    now += std::chrono::seconds(1);
+    EXPECT_EQ(Clock::duration::zero(), pacer.frameDone(now));
+    EXPECT_NEAR(period().count(), pacer.frameDone(now).count(), 1);
+}
+
+TEST_F(FramePacerTest, speed) {
+    EXPECT_EQ(0.0, pacer.getSpeed());
+
+    // keeping up
+    for (int i = 0; i < 120; i++) {
+        now += pacer.frameDone(now);
+    }
+    EXPECT_NEAR(100.0, pacer.getSpeed(), 0.5);
+
+    // frames taking twice as long as they should
+    pacer.setMode(PacingMode::Uncapped);
+    for (int i = 0; i < 120; i++) {
+        pacer.frameDone(now);
+        now += period() * 2;
+    }
+    EXPECT_NEAR(50.0, pacer.getSpeed(), 0.5);
+
+    // and four times as fast
+    for (int i = 0; i < 240; i++) {
+        pacer.frameDone(now);
+        now += period() / 4;
+    }
+    EXPECT_NEAR(400.0, pacer.getSpeed(), 2.0);
+}
@@ -0,0 +1,98 @@
+#include "gtest/gtest.h"
+#include <ControlDeck/nes.h>
+#include "CPU/FixedRomMmc.h"
+using namespace NES;
+
+// NMI on, then count in a loop
+static const uint8_t resetProgram[] = {
+    0xa9, 0x80,         // $8000 LDA #$80
+    0x8d, 0x00, 0x20,   // $8002 STA $2000
+    0xe6, 0x12,         // $8005 INC $12
+    0x4c, 0x05, 0x80,   // $8007 JMP $8005
+};
+
+// Reads the controller every other NMI
+static const uint8_t nmiHandler[] = {
+    0xe6, 0x11,         // $8040 INC $11
+    0xa5, 0x11,         // $8042 LDA $11
+    0x29, 0x01,         // $8044 AND #$01
+    0xf0, 0x03,         // $8046 BEQ $804b
+    0xad, 0x16, 0x40,   // $8048 LDA $4016
+    0x40,               // $804b RTI
+};
+
+const uint32_t ppuCyclesPerFrame = CpuVariant::scanLines * 341;
+// longest instruction, and the operand read it isn't charged a cycle for
+const uint32_t maxOvershoot = 8;
+
+class RunFrameTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        memcpy(mmc.rom, resetProgram, sizeof(resetProgram));
+        memcpy(&mmc.rom[0x40], nmiHandler, sizeof(nmiHandler));
+        mmc.setVector(0xfffa, 0x8040);
+        setUp(nes);
+        setUp(reference);
+    }
+
+    void setUp(NesControlDeck &controlDeck) {
+        controlDeck.cart.mmc = &mmc;
+        setUpFixedRom(controlDeck.cpu, controlDeck.ppu, controlDeck.cart);
+    }
+
+    FixedRomMmc mmc;
+    NesControlDeck nes;
+    NesControlDeck reference;
+};
+
+TEST_F(RunFrameTest, returnsWhenFrameFinishes) {
+    uint64_t cycles = 0;
+    for (uint64_t frame = 1; frame <= 5; frame++) {
+        FrameStats stats = runFrame(nes);
+        cycles += stats.cycles;
+        EXPECT_EQ(frame, stats.frame);
+        EXPECT_EQ(frame, nes.ppu.getFrameCount());
+        EXPECT_TRUE(nes.ppu.ppuMemory.memoryMappedRegisters.getVBlank());
+        // stopped at the first instruction boundary
+        EXPECT_LE(ppuCyclesPerFrame - nes.ppu.getCyclesUntilFrameEnd(), ppuCyclesForCpuCycles(maxOvershoot));
+    }
+    EXPECT_EQ(nes.cpu.getCycle(), cycles);
+}
+
+TEST_F(RunFrameTest, overshootCarriedIntoNextFrame) {
+    runFrame(nes);
+    uint32_t frameCycles = ppuCyclesPerFrame * CpuVariant::cpuClocks / CpuVariant::ppuClocks;
+    for (int i = 0; i < 20; i++) {
+        FrameStats stats = runFrame(nes);
+        // reads the cpu isn't charged for move the PPU along a little faster
+        EXPECT_GE(stats.cycles, frameCycles - frameCycles / 100);
+        EXPECT_LE(stats.cycles, frameCycles + maxOvershoot);
+        // still right behind the end of the frame, the overshoots don't add up
+        EXPECT_LE(ppuCyclesPerFrame - nes.ppu.getCyclesUntilFrameEnd(), ppuCyclesForCpuCycles(maxOvershoot));
+    }
+}
+
+TEST_F(RunFrameTest, lagFrames) {
+    // no NMI before the first frame ends, then the handler reads the controller on odd NMIs
+    EXPECT_TRUE(runFrame(nes).lag);
+    EXPECT_FALSE(runFrame(nes).lag);
+    EXPECT_TRUE(runFrame(nes).lag);
+    EXPECT_FALSE(runFrame(nes).lag);
+    EXPECT_EQ(3, nes.cpu.ram.ram[0x11]);
+}
+
+TEST_F(RunFrameTest, sameFramesThroughBlockCache) {
+    reference.cpu.blockCacheEnabled = true;
+    reference.cpu.superInstructionsEnabled = true;
+    for (int i = 0; i < 5; i++) {
+        FrameStats stats = runFrame(nes);
+        FrameStats referenceStats = runFrame(reference);
+        EXPECT_EQ(referenceStats.frame, stats.frame);
+        EXPECT_EQ(referenceStats.cycles, stats.cycles);
+        EXPECT_EQ(referenceStats.instructions, stats.instructions);
+        EXPECT_EQ(referenceStats.lag, stats.lag);
+        EXPECT_EQ(reference.cpu.registers.programCounter, nes.cpu.registers.programCounter);
+    }
+    EXPECT_EQ(reference.cpu.instructionsExecuted, nes.cpu.instructionsExecuted);
+    EXPECT_EQ(0, memcmp(reference.cpu.ram.ram, nes.cpu.ram.ram, SystemRam::systemRAMBytes));
+}
@@ -0,0 +1,135 @@
+#include "gtest/gtest.h"
+
+#include <ControlDeck/PPU/PPUComponents.h>
+#include <ControlDeck/PPU/PPU2C02.h>
+#include <ControlDeck/CPU/CpuVariant.h>
+#include <ControlDeck/cartridge.h>
+
+using NES::Cartridge;
+using NES::ChrTileCache;
+using NES::CpuVariant;
+using NES::MemoryManagementController;
+using NES::PPUMirroring;
+using NES::PPURegister;
+using NES::Ppu2C02;
+using NES::SystemBus;
+
+// Two 8kb CHR-RAM banks, switched by bank, counting the PPU's reads
+class BankedChrRamMmc : public MemoryManagementController {
+public:
+    void doMemoryOperation(SystemBus &bus, Cartridge &cart) override {}
+
+    uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
+        uint8_t val = chr[bank][address];
+        if (isRead) {
+            reads++;
+        } else {
+            chr[bank][address] = write;
+        }
+        return val;
+    }
+
+    void switchBank(int bank) {
+        this->bank = bank;
+        chrBankState = bank;
+    }
+
+    uint8_t chr[2][0x2000]{};
+    int bank{ 0 };
+    uint32_t reads{ 0 };
+};
+
+// rows 0 and 7 of tile $01 in the $1000 table: colour indices 0 1 2 3 3 2 1 0 and all 3
+static const uint8_t tileAddress = 0x10;
+static const uint8_t planes[16] = {
+    0x5a, 0, 0, 0, 0, 0, 0, 0xff,     // bit 0: 01011010
+    0x3c, 0, 0, 0, 0, 0, 0, 0xff,     // bit 1: 00111100
+};
+
+class ChrTileCacheTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        cart = Cartridge();
+        cart.mmc = &mmc;
+        cart.mirroring = PPUMirroring::PPU_VERTICAL;
+        ppu.cartridge = &cart;
+        memcpy(&mmc.chr[0][0x1000 + tileAddress], planes, sizeof(planes));
+    }
+
+    void expectRow(const uint8_t *expected, const uint8_t *row) {
+        for (int x = 0; x < 8; x++) {
+            EXPECT_EQ(expected[x], row[x]) << "pixel " << x;
+        }
+    }
+
+    BankedChrRamMmc mmc;
+    Cartridge cart;
+    Ppu2C02 ppu;
+};
+
+TEST_F(ChrTileCacheTest, decode) {
+    ChrTileCache::DecodedTile tile;
+    ChrTileCache::decode(planes, tile);
+    const uint8_t row0[8] = { 0, 1, 2, 3, 3, 2, 1, 0 };
+    const uint8_t row7[8] = { 3, 3, 3, 3, 3, 3, 3, 3 };
+    const uint8_t blank[8] = {};
+    expectRow(row0, tile.rows[0]);
+    expectRow(row7, tile.rows[7]);
+    expectRow(blank, tile.rows[3]);
+
+    // an asymmetric row
+    const uint8_t asymmetric[16] = { 0x80, 0, 0, 0, 0, 0, 0, 0, 0x01 };
+    ChrTileCache::decode(asymmetric, tile);
+    const uint8_t left[8] = { 1, 0, 0, 0, 0, 0, 0, 2 };
+    const uint8_t flipped[8] = { 2, 0, 0, 0, 0, 0, 0, 1 };
+    expectRow(left, tile.rows[0]);
+    expectRow(flipped, tile.flippedRows[0]);
+}
+
+TEST_F(ChrTileCacheTest, decodedOnceThroughTheMapper) {
+    const uint8_t row0[8] = { 0, 1, 2, 3, 3, 2, 1, 0 };
+    expectRow(row0, ppu.getDecodedTileRow(1, 1, 0));
+    EXPECT_EQ(16u, mmc.reads);
+
+    // every row, either way round, comes from the same decode
+    expectRow(row0, ppu.getDecodedTileRow(1, 1, 0, true));
+    ppu.getDecodedTileRow(1, 1, 7);
+    EXPECT_EQ(16u, mmc.reads);
+
+    // the same tile number in the other table is another tile
+    const uint8_t blank[8] = {};
+    expectRow(blank, ppu.getDecodedTileRow(0, 1, 0));
+    EXPECT_EQ(32u, mmc.reads);
+}
+
+TEST_F(ChrTileCacheTest, chrRamWriteDropsTile) {
+    ppu.getDecodedTileRow(1, 1, 0);
+    ppu.getDecodedTileRow(1, 2, 0);
+
+    // DATA write in vblank, queued then flushed by the next register access
+    ppu.advance(CpuVariant::vblankScanLine * 341 + 10);
+    ppu.renderingRegisters.vramAddress = 0x1000 + tileAddress + 8;
+    ppu.writeRegister(PPURegister::DATA, 0xff);
+    ppu.flushDataWrites();
+
+    mmc.reads = 0;
+    const uint8_t row0[8] = { 2, 3, 2, 3, 3, 2, 3, 2 };
+    expectRow(row0, ppu.getDecodedTileRow(1, 1, 0));
+    EXPECT_EQ(16u, mmc.reads);
+    // the tile next to it is still decoded
+    ppu.getDecodedTileRow(1, 2, 0);
+    EXPECT_EQ(16u, mmc.reads);
+}
+
+TEST_F(ChrTileCacheTest, bankSwitchDropsTiles) {
+    const uint8_t row0[8] = { 0, 1, 2, 3, 3, 2, 1, 0 };
+    expectRow(row0, ppu.getDecodedTileRow(1, 1, 0));
+
+    mmc.switchBank(1);
+    const uint8_t blank[8] = {};
+    expectRow(blank, ppu.getDecodedTileRow(1, 1, 0));
+
+    mmc.switchBank(0);
+    expectRow(row0, ppu.getDecodedTileRow(1, 1, 0));
+    EXPECT_EQ(48u, mmc.reads);
+}
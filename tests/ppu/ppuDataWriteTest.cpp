@@ -0,0 +1,167 @@
+#include "gtest/gtest.h"
+
+#include <ControlDeck/PPU/PPUComponents.h>
+#include <ControlDeck/PPU/PPU2C02.h>
+#include <ControlDeck/cartridge.h>
+#include <ControlDeck/common.h>
+#include <ControlDeck/CPU/CpuVariant.h>
+
+using NES::Cartridge;
+using NES::CpuVariant;
+using NES::MemoryManagementController;
+using NES::PPUMirroring;
+using NES::PPURegister;
+using NES::Ppu2C02;
+using NES::SystemBus;
+
+// 8kb of CHR-RAM, nothing on the CPU side
+class ChrRamMmc : public MemoryManagementController {
+public:
+    void doMemoryOperation(SystemBus &bus, Cartridge &cart) override {}
+
+    uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
+        uint8_t val = chr[address];
+        if (!isRead) {
+            chr[address] = write;
+        }
+        return val;
+    }
+
+    uint8_t chr[0x2000]{};
+};
+
+const uint32_t cyclesPerScanLine = 341;
+
+class PPUDataWriteTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        cart = Cartridge();
+        cart.mmc = &mmc;
+        cart.mirroring = PPUMirroring::PPU_VERTICAL;
+        ppu.cartridge = &cart;
+    }
+
+    // first vblank scan line
+    void runToVBlank() {
+        ppu.advance(CpuVariant::vblankScanLine * cyclesPerScanLine);
+    }
+
+    void setAddress(uint16_t address) {
+        ppu.flushDataWrites();
+        ppu.renderingRegisters.vramAddress = address;
+    }
+
+    ChrRamMmc mmc;
+    Cartridge cart;
+    Ppu2C02 ppu;
+};
+
+TEST_F(PPUDataWriteTest, nameTableUpload) {
+    runToVBlank();
+    setAddress(0x2400);
+    for (int i = 0; i < 0x400; i++) {
+        ppu.writeRegister(PPURegister::DATA, (uint8_t)(i * 7));
+    }
+    ppu.flushDataWrites();
+
+    for (int i = 0; i < 32 * 30; i++) {
+        EXPECT_EQ((uint8_t)(i * 7), ppu.ppuMemory.nameTables[1].nameTable[i]);
+    }
+    for (int i = 0; i < 64; i++) {
+        EXPECT_EQ((uint8_t)((32 * 30 + i) * 7), ppu.ppuMemory.nameTables[1].attributeTable.tileGroup[i]);
+    }
+    EXPECT_EQ(0, ppu.ppuMemory.nameTables[0].nameTable[0]);
+    EXPECT_EQ(0x2800, ppu.renderingRegisters.vramAddress);
+}
+
+TEST_F(PPUDataWriteTest, incrementBy32) {
+    runToVBlank();
+    ppu.writeRegister(PPURegister::PPUCTRL, 0x04);
+    setAddress(0x2005);
+    for (int i = 0; i < 30; i++) {
+        ppu.writeRegister(PPURegister::DATA, (uint8_t)(i + 1));
+    }
+    ppu.flushDataWrites();
+
+    for (int i = 0; i < 30; i++) {
+        EXPECT_EQ(i + 1, ppu.getByte(0x2005 + i * 32));
+        EXPECT_EQ(0, ppu.getByte(0x2004 + i * 32));
+        EXPECT_EQ(0, ppu.getByte(0x2006 + i * 32));
+    }
+    EXPECT_EQ(0x2005 + 30 * 32, ppu.renderingRegisters.vramAddress);
+}
+
+TEST_F(PPUDataWriteTest, uploadAcrossMemoryRegions) {
+    runToVBlank();
+    // CHR-RAM through the mapper
+    setAddress(0x1ffe);
+    for (int i = 0; i < 4; i++) {
+        ppu.writeRegister(PPURegister::DATA, (uint8_t)(0x10 + i));
+    }
+    // end of the $3000 name table mirror into the palettes
+    setAddress(0x3efe);
+    for (int i = 0; i < 4; i++) {
+        ppu.writeRegister(PPURegister::DATA, (uint8_t)(0x20 + i));
+    }
+    ppu.flushDataWrites();
+
+    EXPECT_EQ(0x10, mmc.chr[0x1ffe]);
+    EXPECT_EQ(0x11, mmc.chr[0x1fff]);
+    EXPECT_EQ(0x12, ppu.getByte(0x2000));
+    EXPECT_EQ(0x13, ppu.getByte(0x2001));
+    EXPECT_EQ(0x20, ppu.getByte(0x2efe));
+    EXPECT_EQ(0x21, ppu.getByte(0x2eff));
+    EXPECT_EQ(0x22, ppu.ppuMemory.colorPalette.universalBackgroundColor);
+    EXPECT_EQ(0x23, ppu.ppuMemory.colorPalette.backgroundPalettes[0].colorIndex[0]);
+}
+
+TEST_F(PPUDataWriteTest, flushedBeforeRendering) {
+    runToVBlank();
+    setAddress(0x2123);
+    ppu.writeRegister(PPURegister::DATA, 0x5a);
+    // still queued while the PPU is in vblank
+    ppu.advance((CpuVariant::scanLines - CpuVariant::vblankScanLine - 1) * cyclesPerScanLine);
+    EXPECT_EQ(0, ppu.getByte(0x2123));
+
+    // the pre-render scan line fetches from vram
+    ppu.advance(cyclesPerScanLine + 1);
+    EXPECT_EQ(0x5a, ppu.getByte(0x2123));
+}
+
+TEST_F(PPUDataWriteTest, readAfterQueuedWrites) {
+    runToVBlank();
+    setAddress(0x2200);
+    ppu.writeRegister(PPURegister::DATA, 0x11);
+    ppu.writeRegister(PPURegister::DATA, 0x22);
+
+    setAddress(0x2200);
+    ppu.readRegister(PPURegister::DATA);    // buffered read
+    EXPECT_EQ(0x11, ppu.readRegister(PPURegister::DATA));
+    EXPECT_EQ(0x22, ppu.readRegister(PPURegister::DATA));
+}
+
+TEST_F(PPUDataWriteTest, renderingEnabledInVBlank) {
+    runToVBlank();
+    ppu.writeRegister(PPURegister::PPUMASK, 0x18);
+    setAddress(0x2000);
+    ppu.writeRegister(PPURegister::DATA, 0x01);
+    ppu.writeRegister(PPURegister::DATA, 0x02);
+    ppu.flushDataWrites();
+
+    // vblank isn't rendering, so PPUCTRL's increment applies
+    EXPECT_EQ(0x2002, ppu.renderingRegisters.vramAddress);
+    EXPECT_EQ(0x01, ppu.getByte(0x2000));
+    EXPECT_EQ(0x02, ppu.getByte(0x2001));
+}
+
+TEST_F(PPUDataWriteTest, writeDuringRendering) {
+    ppu.advance(10 * cyclesPerScanLine);
+    ppu.writeRegister(PPURegister::PPUMASK, 0x18);
+    ppu.writeRegister(PPURegister::PPUCTRL, 0x04);
+    setAddress(0x2000);
+    ppu.writeRegister(PPURegister::DATA, 0x77);
+
+    // written straight away, and the vram address takes the coarse X increment instead of PPUCTRL's 32
+    EXPECT_EQ(0x77, ppu.getByte(0x2000));
+    EXPECT_EQ(0x2001, ppu.renderingRegisters.vramAddress);
+}
@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+#include <ControlDeck/PPU/PPUComponents.h>
+#include <ControlDeck/PPU/PPU2C02.h>
+#include <ControlDeck/CPU/CpuVariant.h>
+#include <ControlDeck/cartridge.h>
+
+using NES::Cartridge;
+using NES::CpuVariant;
+using NES::MemoryManagementController;
+using NES::PPUMirroring;
+using NES::Ppu2C02;
+using NES::SystemBus;
+
+// Patterned CHR which keeps a log of the addresses read
+class LoggingChrMmc : public MemoryManagementController {
+public:
+    LoggingChrMmc() {
+        for (uint32_t i = 0; i < sizeof(chr); i++) {
+            chr[i] = (uint8_t)(i * 7 + (i >> 4));
+        }
+    }
+
+    void doMemoryOperation(SystemBus &bus, Cartridge &cart) override {}
+
+    uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
+        reads.push_back(address);
+        return chr[address];
+    }
+
+    uint8_t chr[0x2000];
+    std::vector<uint16_t> reads;
+};
+
+const uint32_t cyclesPerScanLine = 341;
+const uint32_t cyclesPerFrame = CpuVariant::scanLines * cyclesPerScanLine;
+
+// Attribute bytes whose 2 bit fields are all 0 or 1
+static const uint8_t attributes[] = { 0x00, 0x01, 0x11, 0x55, 0x04, 0x40 };
+
+// advance draws whole visible lines with renderScanLine, doPpuCycle always goes dot by dot
+class PPUScanLineTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        setUp(ppu, cart, mmc);
+        setUp(reference, referenceCart, referenceMmc);
+    }
+
+    void setUp(Ppu2C02 &p, Cartridge &c, LoggingChrMmc &m) {
+        c = Cartridge();
+        c.mmc = &m;
+        c.mirroring = PPUMirroring::PPU_VERTICAL;
+        p.cartridge = &c;
+
+        for (int table = 0; table < 2; table++) {
+            uint8_t *nameTable = reinterpret_cast<uint8_t *>(&p.ppuMemory.nameTables[table]);
+            for (int i = 0; i < 0x3c0; i++) {
+                nameTable[i] = (uint8_t)(i * 13 + table);
+            }
+            for (int i = 0x3c0; i < 0x400; i++) {
+                nameTable[i] = attributes[(i + table) % sizeof(attributes)];
+            }
+        }
+        p.ppuMemory.colorPalette.universalBackgroundColor = 0x0f;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 3; j++) {
+                p.ppuMemory.colorPalette.backgroundPalettes[i].colorIndex[j] = (uint8_t)(0x11 + i * 0x10 + j);
+                p.ppuMemory.colorPalette.spritePalette[i].colorIndex[j] = (uint8_t)(0x06 + i * 0x10 + j);
+            }
+        }
+    }
+
+    void run(uint32_t cycles) {
+        ppu.advance(cycles);
+        for (uint32_t i = 0; i < cycles; i++) {
+            reference.doPpuCycle();
+        }
+    }
+
+    // a raster effect, moving the attribute table address
+    void setVramAddress(uint16_t address) {
+        ppu.renderingRegisters.vramAddress = address;
+        reference.renderingRegisters.vramAddress = address;
+    }
+
+    void expectSame() {
+        EXPECT_EQ(reference.getCycle(), ppu.getCycle());
+        EXPECT_EQ(reference.getFrameCount(), ppu.getFrameCount());
+        EXPECT_EQ(reference.ppuMemory.memoryMappedRegisters.oamAddr, ppu.ppuMemory.memoryMappedRegisters.oamAddr);
+        EXPECT_TRUE(referenceMmc.reads == mmc.reads);
+        EXPECT_EQ(0, memcmp(reference.renderBuffer.renderBuffer, ppu.renderBuffer.renderBuffer, sizeof(ppu.renderBuffer.renderBuffer)));
+    }
+
+    LoggingChrMmc mmc;
+    LoggingChrMmc referenceMmc;
+    Cartridge cart;
+    Cartridge referenceCart;
+    Ppu2C02 ppu;
+    Ppu2C02 reference;
+};
+
+TEST_F(PPUScanLineTest, framesMatchDotByDot) {
+    // the picture changes every line
+    for (uint32_t line = 0; line < 2 * CpuVariant::scanLines; line++) {
+        setVramAddress((uint16_t)(line * 0x47));
+        run(cyclesPerScanLine);
+    }
+    expectSame();
+    // two pattern table reads for each of the 34 tiles fetched on a visible line
+    EXPECT_EQ(2u * 240 * 34 * 2, mmc.reads.size());
+}
+
+TEST_F(PPUScanLineTest, wholeFrameBatch) {
+    setVramAddress(0x0c63);
+    run(cyclesPerFrame + 1000);
+    expectSame();
+    setVramAddress(0x0421);
+    run(3 * cyclesPerFrame);
+    expectSame();
+}
+
+TEST_F(PPUScanLineTest, midLineWritesFallBackToDots) {
+    run(20 * cyclesPerScanLine);
+    for (uint32_t line = 20; line < 200; line += 2) {
+        // the line with the write is split, the next one starts a batch on a line boundary again
+        run(100 + line % 50);
+        setVramAddress((uint16_t)(line * 0x123));
+        run(2 * cyclesPerScanLine - 100 - line % 50);
+    }
+    run(cyclesPerFrame);
+    expectSame();
+}
+
+TEST_F(PPUScanLineTest, queuedDataWritesLandFirst) {
+    // in vblank, so the DATA write is queued until the next rendering line
+    run(CpuVariant::vblankScanLine * cyclesPerScanLine + 10);
+    for (Ppu2C02 *p : { &ppu, &reference }) {
+        p->renderingRegisters.vramAddress = 0x23c0;
+        p->writeRegister(NES::PPURegister::DATA, 0x55);
+        p->renderingRegisters.vramAddress = 0;
+    }
+    run(cyclesPerFrame);
+    expectSame();
+}
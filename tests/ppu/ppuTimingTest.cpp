@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+
+#include <ControlDeck/PPU/PPUComponents.h>
+#include <ControlDeck/PPU/PPU2C02.h>
+#include <ControlDeck/CPU/CpuVariant.h>
+#include <ControlDeck/cartridge.h>
+
+using NES::Cartridge;
+using NES::CpuVariant;
+using NES::MemoryManagementController;
+using NES::Ppu2C02;
+using NES::SystemBus;
+
+// Blank CHR, nothing on the CPU side
+class BlankChrMmc : public MemoryManagementController {
+public:
+    void doMemoryOperation(SystemBus &bus, Cartridge &cart) override {}
+
+    uint8_t doCHRMemoryOperationOperation(Cartridge &cart, uint16_t address, uint8_t write, bool isRead = true) override {
+        return 0;
+    }
+};
+
+const uint32_t cyclesPerScanLine = 341;
+const uint32_t cyclesPerFrame = CpuVariant::scanLines * cyclesPerScanLine;
+// cycle 1 of the first vblank line, where doPpuCycle sets vblank
+const uint32_t vblankCycle = CpuVariant::vblankScanLine * cyclesPerScanLine + 1;
+
+// Frame timing comes from CpuVariant, so these hold for whichever region the library is built for
+class PPUTimingTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        cart = Cartridge();
+        cart.mmc = &mmc;
+        ppu.cartridge = &cart;
+    }
+
+    bool inVBlank() {
+        return ppu.ppuMemory.memoryMappedRegisters.getVBlank();
+    }
+
+    BlankChrMmc mmc;
+    Cartridge cart;
+    Ppu2C02 ppu;
+};
+
+TEST_F(PPUTimingTest, vblankStartsOnVariantScanLine) {
+    ppu.advance(vblankCycle);
+    EXPECT_FALSE(inVBlank());
+    ppu.advance(1);
+    EXPECT_TRUE(inVBlank());
+
+    // held through the vblank lines, cleared on cycle 2 of the pre-render line
+    ppu.advance(cyclesPerFrame - vblankCycle);
+    EXPECT_TRUE(inVBlank());
+    ppu.advance(1);
+    EXPECT_TRUE(inVBlank());
+    ppu.advance(1);
+    EXPECT_FALSE(inVBlank());
+}
+
+TEST_F(PPUTimingTest, frameLength) {
+    ppu.advance(vblankCycle + 1);
+    ASSERT_TRUE(inVBlank());
+
+    ppu.advance(cyclesPerFrame - 1);
+    EXPECT_FALSE(inVBlank());
+    ppu.advance(1);
+    EXPECT_TRUE(inVBlank());
+    EXPECT_EQ(cyclesPerFrame + vblankCycle + 1, ppu.getCycle());
+}
+
+TEST_F(PPUTimingTest, advanceMatchesCycleByCycle) {
+    Ppu2C02 reference = ppu;
+    for (uint32_t i = 0; i < cyclesPerFrame + vblankCycle + 5; i++) {
+        reference.doPpuCycle();
+    }
+    ppu.advance(cyclesPerFrame + vblankCycle + 5);
+    EXPECT_EQ(reference.getCycle(), ppu.getCycle());
+    EXPECT_EQ(reference.getCyclesUntilNmiEvent(), ppu.getCyclesUntilNmiEvent());
+    EXPECT_EQ(reference.getOamIdleCycles(), ppu.getOamIdleCycles());
+    EXPECT_TRUE(inVBlank());
+}
+
+TEST_F(PPUTimingTest, nmiEventNeverLate) {
+    // vblank can't change within the cycles getCyclesUntilNmiEvent allows, from anywhere in the frame
+    for (uint32_t start = 0; start < cyclesPerFrame + cyclesPerScanLine; start += 97) {
+        uint32_t cycles = ppu.getCyclesUntilNmiEvent();
+        Ppu2C02 ahead = ppu;
+        ahead.advance(cycles);
+        ASSERT_EQ(inVBlank(), ahead.ppuMemory.memoryMappedRegisters.getVBlank()) << "from cycle " << start;
+        ppu.advance(97);
+    }
+}
+
+TEST_F(PPUTimingTest, variantPalette) {
+    ppu.ppuMemory.colorPalette.universalBackgroundColor = 0x21;
+    ppu.advance(vblankCycle);
+
+    // an empty background is drawn in the backdrop colour
+    NES::Pixel backdrop = CpuVariant::palette()[0x21];
+    const uint8_t *pixel = &ppu.renderBuffer.renderBuffer[3 * (100 * NES::screen_w + 100)];
+    EXPECT_EQ(backdrop.r, pixel[0]);
+    EXPECT_EQ(backdrop.g, pixel[1]);
+    EXPECT_EQ(backdrop.b, pixel[2]);
+}